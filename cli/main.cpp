@@ -1,33 +1,65 @@
 #include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <print>
 #include <span>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "bnk.h"
+#include "bundle.h"
+#include "file_sink.h"
+#include "manifest.h"
+#include "mapped_file.h"
+#include "media_index.h"
+#include "pack.h"
+#include "parallel.h"
+#include "pipeline.h"
+#include "scan.h"
+#include "w3sc.h"
 #include "ww2ogg/ww2ogg.h"
 #include "wwtools/wwtools.h"
 #include <rang.hpp>
 
 namespace fs = std::filesystem;
 
+// Writes `bytes` to outpath through one preallocated, buffered file write.
+void WriteOutput(const fs::path& outpath, const std::span<const std::byte> bytes)
+{
+    wwtools::FileSink out(outpath);
+    out.Reserve(bytes.size());
+    out.Write(bytes);
+    out.Close();
+}
+
 // Converts WEM data to OGG and writes the result to outpath.
 void Convert(const std::string_view indata, const fs::path& outpath)
 {
-    const auto outdata = wwtools::Wem2Ogg(std::string{indata});
+    wwtools::Wem2OggFile(indata, outpath);
+}
 
-    std::ofstream fout(outpath, std::ios::binary);
-    if (!fout)
-    {
-        throw std::runtime_error("failed to open output file");
-    }
-    fout << outdata;
+// Converts as much of a WEM as there is, such as the prefetch stub of a streamed one, to OGG and
+// writes it to outpath.  Returns the samples per channel it covers.
+std::uint64_t ConvertPrefix(const std::string_view indata, const fs::path& outpath)
+{
+    const auto partial = wwtools::Wem2OggPrefix(indata);
+    WriteOutput(outpath, std::as_bytes(std::span(partial.ogg)));
+    return partial.samples;
 }
 
 void PrintHelp(const std::string_view extra_message = {},
@@ -38,11 +70,36 @@ void PrintHelp(const std::string_view extra_message = {},
         std::cout << rang::fg::red << extra_message << rang::fg::reset << "\n\n";
     }
     std::println("Please use the command in one of the following ways:");
-    std::println("  {} wem [input.wem] (--info)", filename);
-    std::println("  {} bnk [event|extract] (input.bnk) (event ID) (--info) (--no-convert)",
+    std::println("  {} wem [input.wem] (--info) (--json) (--incremental)", filename);
+    std::println("  {} bnk [event|extract] (input.bnk) (event ID) (--info) (--json) (--no-convert) "
+                 "(--incremental)",
+                 filename);
+    std::println("  {} bnk extract [directory|glob|input.bnk...] (--no-convert) (--threads=<n>) "
+                 "(--max-memory=<MiB>) (--pack=<file>)",
+                 filename);
+    std::println("  {} bnk replace [input.bnk] (directory of <id>.wem files)", filename);
+    std::println("  {} cache [list|extract|convert] (input.cache) (--threads=<n>)", filename);
+    std::println("  {} bundle [list|extract|convert] (input.bundle) (--threads=<n>)", filename);
+    std::println("  {} pack [list|extract|convert] (input.wwpack) (--threads=<n>)", filename);
+    std::println("  {} index [directory] (--binary) (--output=<file>) (--threads=<n>)", filename);
+    std::println("  {} xref [directory] (--wem=<id>,...) (--index=<file>) (--output=<file>) "
+                 "(--threads=<n>)",
+                 filename);
+    std::println("  {} revorb [directory] (--threads=<n>)", filename);
+    std::println("  {} verify [directory] (--threads=<n>)", filename);
+    std::println("  {} ogg [input.ogg|directory] (--granules) (--standard-packets) (--rifx) "
+                 "(--threads=<n>)",
                  filename);
     std::println(
         "Or run it without arguments to find and convert all WEMs in the current directory.");
+    std::println("--incremental skips inputs unchanged since the last run, tracked in "
+                 ".wwtools-manifest next to the input (or --manifest=<file>).");
+    std::println("--prefetch makes bnk extract convert streamed WEMs from the prefetch data in the "
+                 "bank alone, as previews, without reading the streamed files.");
+    std::println("--media-root=<directory> (repeatable) makes bnk extract find streamed WEMs in "
+                 "those trees instead of next to the bank.");
+    std::println("--pack=<file> makes bnk extract write all its outputs into one indexed pack "
+                 "file, read back with the pack command.");
 }
 
 struct ParsedFlags
@@ -84,6 +141,63 @@ struct ParsedFlags
     return std::ranges::contains(flags, wanted_flag);
 }
 
+// Returns the value of a "--name=value" flag, or an empty view when it is absent.
+[[nodiscard]] std::string_view GetFlagValue(const std::vector<std::string>& flags,
+                                            const std::string_view name)
+{
+    for (const std::string_view flag : flags)
+    {
+        if (flag.size() > name.size() && flag.starts_with(name) && flag[name.size()] == '=')
+        {
+            return flag.substr(name.size() + 1);
+        }
+    }
+    return {};
+}
+
+// Returns every value of a repeatable "--name=value" flag, in order.
+[[nodiscard]] std::vector<std::string_view> GetFlagValues(const std::vector<std::string>& flags,
+                                                          const std::string_view name)
+{
+    std::vector<std::string_view> values;
+    for (const std::string_view flag : flags)
+    {
+        if (flag.size() > name.size() && flag.starts_with(name) && flag[name.size()] == '=')
+        {
+            values.push_back(flag.substr(name.size() + 1));
+        }
+    }
+    return values;
+}
+
+// Parses --threads=<n>; 0 (one worker per hardware thread) when absent or invalid.
+[[nodiscard]] unsigned int GetThreadCount(const std::vector<std::string>& flags)
+{
+    const auto value = GetFlagValue(flags, "threads");
+    unsigned int threads = 0;
+    std::from_chars(value.data(), value.data() + value.size(), threads);
+    return threads;
+}
+
+// Parses a comma-separated list of IDs (e.g. --wem=123,456); nullopt if any of them is invalid.
+[[nodiscard]] std::optional<std::vector<std::uint32_t>> ParseIds(std::string_view list)
+{
+    std::vector<std::uint32_t> ids;
+    while (!list.empty())
+    {
+        const auto field = list.substr(0, list.find(','));
+        std::uint32_t id = 0;
+        const auto [end, ec] = std::from_chars(field.data(), field.data() + field.size(), id);
+        if (ec != std::errc{} || end != field.data() + field.size())
+        {
+            return std::nullopt;
+        }
+        ids.push_back(id);
+        list.remove_prefix(std::min(list.size(), field.size() + 1));
+    }
+    return ids;
+}
+
 [[nodiscard]] std::string ReadFile(const fs::path& path)
 {
     std::ifstream file(path, std::ios::binary);
@@ -96,6 +210,145 @@ struct ParsedFlags
     return buffer.str();
 }
 
+// Maps an input file, or reports it as unreadable and returns nullopt when it cannot be opened or
+// is empty, so callers can move on to the next input as they did with ReadFile.
+[[nodiscard]] std::optional<wwtools::MappedFile> MapFile(const fs::path& path)
+{
+    try
+    {
+        wwtools::MappedFile file(path);
+        if (file.Size() != 0)
+        {
+            return file;
+        }
+    }
+    catch (const std::system_error&)
+    {
+        // Reported below, as an empty file is
+    }
+    std::println(stderr, "Failed to read {}", path.string());
+    return std::nullopt;
+}
+
+// How an output was made, recorded with it so that, say, a preview converted from a prefetch stub
+// is never taken for the full conversion of the streamed file that lands on the same path.
+constexpr std::string_view g_mode_convert = "convert";
+constexpr std::string_view g_mode_prefetch = "prefetch";
+constexpr std::string_view g_mode_extract = "extract";
+
+// --incremental support: remembers what each input was converted to and skips it while the input
+// bytes, the output name and mode, the tool version and the codebook library all stay the same.
+// Does nothing when incremental mode is off.  The manifest is saved when this goes out of scope.
+class Incremental
+{
+    std::optional<wwtools::manifest::Manifest> m_manifest;
+    fs::path m_base; // manifest keys are paths relative to this directory
+
+    [[nodiscard]] std::string Key(const fs::path& path) const
+    {
+        return fs::proximate(path, m_base).generic_string();
+    }
+
+public:
+    Incremental(const std::vector<std::string>& flags, const fs::path& default_dir)
+    {
+        if (!HasFlag(flags, "incremental"))
+        {
+            return;
+        }
+
+        const auto custom = GetFlagValue(flags, "manifest");
+        const auto path = custom.empty() ? default_dir / ".wwtools-manifest" : fs::path(custom);
+        m_base = fs::absolute(path).parent_path();
+        m_manifest.emplace(path);
+    }
+
+    ~Incremental()
+    {
+        try
+        {
+            if (m_manifest)
+            {
+                m_manifest->Save();
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::println(stderr, "Failed to save manifest: {}", e.what());
+        }
+    }
+
+    Incremental(const Incremental&) = delete;
+    Incremental& operator=(const Incremental&) = delete;
+    Incremental(Incremental&&) = delete;
+    Incremental& operator=(Incremental&&) = delete;
+
+    // A loose file, keyed by its path.
+    [[nodiscard]] wwtools::manifest::Input FileInput(const fs::path& path,
+                                                     const std::span<const std::byte> data) const
+    {
+        if (!m_manifest)
+        {
+            return {};
+        }
+        return {.key = Key(path),
+                .size = data.size(),
+                .mtime = wwtools::manifest::ModificationTime(path),
+                .data = data};
+    }
+
+    // A WEM embedded in a bank, keyed as "<bank path>#<id>".
+    [[nodiscard]] wwtools::manifest::Input EntryInput(const fs::path& bnk_path,
+                                                      const std::int64_t bnk_mtime,
+                                                      const std::uint32_t id,
+                                                      const std::string_view data) const
+    {
+        if (!m_manifest)
+        {
+            return {};
+        }
+        return {.key = std::format("{}#{}", Key(bnk_path), id),
+                .size = data.size(),
+                .mtime = bnk_mtime,
+                .data = std::as_bytes(std::span(data))};
+    }
+
+    [[nodiscard]] bool Skip(const wwtools::manifest::Input& input, const fs::path& outpath,
+                            const std::string_view mode)
+    {
+        return m_manifest && fs::exists(outpath) &&
+               m_manifest->Unchanged(input, Key(outpath), mode);
+    }
+
+    void Done(const wwtools::manifest::Input& input, const fs::path& outpath,
+              const std::string_view mode)
+    {
+        if (m_manifest)
+        {
+            m_manifest->Update(input, Key(outpath), mode);
+        }
+    }
+};
+
+// Writes `data` to a temporary file next to `path`, then renames it over `path`, so an interrupted
+// run never leaves a partially written file behind.
+void ReplaceFile(const fs::path& path, const std::string_view data)
+{
+    auto temp_path = path;
+    temp_path += ".tmp";
+    try
+    {
+        WriteOutput(temp_path, std::as_bytes(std::span(data)));
+    }
+    catch (const std::exception&)
+    {
+        std::error_code ec;
+        fs::remove(temp_path, ec);
+        throw;
+    }
+    fs::rename(temp_path, path);
+}
+
 [[nodiscard]] fs::path ReplaceExtension(const fs::path& path, const std::string_view new_ext)
 {
     auto result = path;
@@ -103,6 +356,361 @@ struct ParsedFlags
     return result;
 }
 
+// Turns an archive entry name (which may use backslashes) into a relative output path, refusing
+// names that would escape the output directory.
+[[nodiscard]] fs::path SafeRelativePath(const std::string_view name)
+{
+    std::string generic{name};
+    std::ranges::replace(generic, '\\', '/');
+
+    const auto path = fs::path(generic).lexically_normal();
+    if (path.empty() || path.has_root_path() || *path.begin() == "..")
+    {
+        throw std::runtime_error(std::format("unsafe entry name {}", name));
+    }
+    return path;
+}
+
+// Extracts or converts every entry of an archive (sound cache or bundle), spread over worker
+// threads. `load(entry, scratch)` returns an entry's payload, decompressing into `scratch` when
+// needed, so one worker can be decompressing while others convert. Converting turns .wem entries
+// into .ogg files and the embedded WEMs of .bnk entries into <bank>_<id>.ogg files; other entries
+// are skipped.
+template <typename EntryT, typename Load>
+[[nodiscard]] int ProcessArchive(const fs::path& archive_path,
+                                 const std::span<const EntryT> entries, const Load& load,
+                                 const bool convert, const unsigned int threads)
+{
+    const auto outdir = ReplaceExtension(archive_path, "");
+
+    std::mutex output_mutex;
+    std::atomic<std::size_t> done{0};
+    std::atomic<std::size_t> failures{0};
+
+    const auto report = [&](const std::string_view action, const fs::path& path) {
+        const std::scoped_lock lock(output_mutex);
+        std::cout << rang::fg::cyan << "[" << ++done << "/" << entries.size() << "] "
+                  << rang::fg::reset << action << " " << path.string() << "...\n";
+    };
+
+    wwtools::parallel::ForEachIndex(
+        entries.size(),
+        [&](const std::size_t i) {
+            const auto& entry = entries[i];
+            try
+            {
+                const auto outpath = outdir / SafeRelativePath(entry.name);
+                const auto ext = outpath.extension();
+                if (convert && ext != ".wem" && ext != ".bnk")
+                {
+                    return;
+                }
+
+                std::string scratch;
+                const std::string_view data = load(entry, scratch);
+                fs::create_directories(outpath.parent_path());
+
+                if (!convert)
+                {
+                    report("Extracting", outpath);
+                    WriteOutput(outpath, std::as_bytes(std::span(data)));
+                }
+                else if (ext == ".wem")
+                {
+                    report("Converting", ReplaceExtension(outpath, ".ogg"));
+                    Convert(data, ReplaceExtension(outpath, ".ogg"));
+                }
+                else
+                {
+                    const auto wems = wwtools::BnkExtract(data);
+                    const auto stem = outpath.stem().string();
+                    for (const auto& wem : wems)
+                    {
+                        if (wem.streamed)
+                        {
+                            continue;
+                        }
+                        const auto name = (wems.size() == 1)
+                                              ? std::format("{}.ogg", stem)
+                                              : std::format("{}_{}.ogg", stem, wem.id);
+                        report("Converting", outpath.parent_path() / name);
+                        Convert(wem.data, outpath.parent_path() / name);
+                    }
+                }
+            }
+            catch (const std::exception& e)
+            {
+                const std::scoped_lock lock(output_mutex);
+                std::println(stderr, "Failed to process {}: {}", entry.name, e.what());
+                ++failures;
+            }
+        },
+        threads);
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Indexes the --media-root directories once for every bank of the run; nullopt without any.
+[[nodiscard]] std::optional<wwtools::media::MediaIndex> GetMediaIndex(
+    const std::vector<std::string>& flags)
+{
+    const auto values = GetFlagValues(flags, "media-root");
+    if (values.empty())
+    {
+        return std::nullopt;
+    }
+    const std::vector<fs::path> roots(values.begin(), values.end());
+    wwtools::media::MediaIndex media(roots, GetThreadCount(flags));
+    std::println(stderr, "Indexed {} streamed WEM(s) under {} media root(s)", media.Size(),
+                 roots.size());
+    return media;
+}
+
+// The loose file of streamed WEM `id`: looked up in `media` when --media-root was given, else
+// probed next to the bank.  Prints why and returns nullopt when there is none.
+[[nodiscard]] std::optional<fs::path> FindStreamedWem(
+    const std::optional<wwtools::media::MediaIndex>& media, const fs::path& bank_dir,
+    const std::uint32_t id)
+{
+    if (media)
+    {
+        if (const auto* path = media->Find(id))
+        {
+            return *path;
+        }
+        std::println(stderr, "WEM {} is streamed but not found under the media roots", id);
+        return std::nullopt;
+    }
+
+    auto path = bank_dir / std::format("{}.wem", id);
+    if (!fs::exists(path))
+    {
+        std::println(stderr, "WEM {} is streamed but {} not found", id, path.string());
+        return std::nullopt;
+    }
+    return path;
+}
+
+// Budget for WEM and OGG bytes in flight when extracting several banks, see ExtractBanks
+constexpr std::size_t g_default_memory_budget_mib = 512;
+
+// Parses --max-memory=<MiB>; the default budget when absent or invalid.
+[[nodiscard]] std::size_t GetMemoryBudget(const std::vector<std::string>& flags)
+{
+    const auto value = GetFlagValue(flags, "max-memory");
+    std::size_t mib = g_default_memory_budget_mib;
+    std::from_chars(value.data(), value.data() + value.size(), mib);
+    return std::max<std::size_t>(mib, 1) * 1024 * 1024;
+}
+
+// One WEM on its way from a mapped bank (or, for a streamed one, the mapped .wem next to it) to
+// its output file.  Jobs share the mapping, which is released with the last job pointing into it.
+struct BankJob
+{
+    std::shared_ptr<const wwtools::MappedFile> source;
+    std::span<const std::byte> wem;
+    std::uint32_t id = 0;
+    fs::path outpath;
+    fs::path name;         // outpath relative to the bank's input root, as stored in a pack
+    std::string ogg;       // filled in by the conversion stage
+    std::string error;     // conversion failure
+    bool prefetch = false; // `wem` is a prefetch stub to convert as far as it goes
+};
+
+// A bank to extract, and the directory its outputs are named relative to in a pack: the directory
+// given on the command line that it was found under, or else its own.
+struct BankInput
+{
+    fs::path path;
+    fs::path root;
+};
+
+// Extracts or converts the embedded WEMs of many banks, as `bnk extract` does for one, through a
+// pipeline: one thread maps each bank and walks its DIDX, a bounded queue feeds `threads`
+// converters, and the calling thread writes the results.  The reader only queues a WEM once it
+// fits in `memory_budget` along with every WEM and OGG still queued, converting or waiting to be
+// written, so memory stays near the budget however large the banks are.  With a `pack`, the
+// outputs are appended to it instead of written as files of their own.
+[[nodiscard]] int ExtractBanks(const std::span<const BankInput> banks, const bool convert,
+                               const unsigned int threads, const std::size_t memory_budget,
+                               const bool prefetch,
+                               const std::optional<wwtools::media::MediaIndex>& media,
+                               wwtools::pack::PackWriter* const pack)
+{
+    const auto workers = wwtools::parallel::ResolveThreadCount(threads);
+    wwtools::pipeline::ByteBudget budget(memory_budget);
+    wwtools::pipeline::BoundedQueue<BankJob> convert_queue(2 * static_cast<std::size_t>(workers));
+    wwtools::pipeline::BoundedQueue<BankJob> write_queue(2 * static_cast<std::size_t>(workers));
+
+    std::mutex output_mutex;
+    std::atomic<std::size_t> failures{0};
+    const auto fail = [&](const fs::path& path, const std::string_view what) {
+        const std::scoped_lock lock(output_mutex);
+        std::println(stderr, "Failed to process {}: {}", path.string(), what);
+        ++failures;
+    };
+
+    // Read and index.  A bank that cannot be read is skipped; after that, an entry that fails only
+    // costs itself.
+    const std::jthread reader([&] {
+        for (const auto& [bank_path, root] : banks)
+        {
+            std::shared_ptr<const wwtools::MappedFile> bank;
+            std::vector<wwtools::bnk::DataIndexEntry> entries;
+            std::vector<std::uint32_t> streamed;
+            try
+            {
+                bank = std::make_shared<const wwtools::MappedFile>(bank_path);
+                entries = wwtools::bnk::GetDataIndex(bank->View());
+                if (convert)
+                {
+                    streamed = wwtools::bnk::GetStreamedWemIds(bank->View());
+                }
+                if (!convert && !entries.empty() && pack == nullptr)
+                {
+                    fs::create_directory(ReplaceExtension(bank_path, ""));
+                }
+            }
+            catch (const std::exception& e)
+            {
+                fail(bank_path, e.what());
+                continue;
+            }
+
+            const auto bank_dir = bank_path.parent_path();
+            const auto stem = bank_path.stem().string();
+            for (const auto& entry : entries)
+            {
+                BankJob job{.source = bank,
+                            .wem = bank->Bytes().subspan(entry.offset, entry.size),
+                            .id = entry.id,
+                            .outpath = {},
+                            .name = {},
+                            .ogg = {},
+                            .error = {},
+                            .prefetch = false};
+                try
+                {
+                    if (!convert)
+                    {
+                        job.outpath =
+                            ReplaceExtension(bank_path, "") / std::format("{}.wem", entry.id);
+                    }
+                    else
+                    {
+                        job.outpath = bank_dir / (entries.size() == 1
+                                                      ? std::format("{}.ogg", stem)
+                                                      : std::format("{}_{}.ogg", stem, entry.id));
+                        if (std::ranges::contains(streamed, entry.id) && prefetch)
+                        {
+                            job.prefetch = true;
+                        }
+                        else if (std::ranges::contains(streamed, entry.id))
+                        {
+                            std::optional<fs::path> external;
+                            {
+                                // FindStreamedWem has said why when it finds nothing
+                                const std::scoped_lock lock(output_mutex);
+                                external = FindStreamedWem(media, bank_dir, entry.id);
+                                if (!external)
+                                {
+                                    ++failures;
+                                    continue;
+                                }
+                            }
+                            job.source = std::make_shared<const wwtools::MappedFile>(*external);
+                            job.wem = job.source->Bytes();
+                        }
+                    }
+                    job.name = job.outpath.lexically_relative(root);
+                }
+                catch (const std::exception& e)
+                {
+                    fail(job.outpath.empty() ? bank_path : job.outpath, e.what());
+                    continue;
+                }
+
+                budget.Acquire(job.wem.size());
+                convert_queue.Push(std::move(job));
+            }
+        }
+        convert_queue.Close();
+    });
+
+    // Convert; the last converter to finish ends the write stage
+    std::atomic<unsigned int> converting{workers};
+    std::vector<std::jthread> converters;
+    converters.reserve(workers);
+    for (unsigned int i = 0; i < workers; ++i)
+    {
+        converters.emplace_back([&] {
+            while (auto job = convert_queue.Pop())
+            {
+                if (convert)
+                {
+                    try
+                    {
+                        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+                        const std::string_view wem(reinterpret_cast<const char*>(job->wem.data()),
+                                                   job->wem.size());
+                        job->ogg = job->prefetch ? wwtools::Wem2OggPrefix(wem).ogg
+                                                 : wwtools::Wem2Ogg(wem);
+                        budget.Charge(job->ogg.size());
+                    }
+                    catch (const std::exception& e)
+                    {
+                        job->error = e.what();
+                    }
+                    budget.Release(job->wem.size());
+                    job->wem = {};
+                    job->source.reset();
+                }
+                write_queue.Push(std::move(*job));
+            }
+            if (--converting == 0)
+            {
+                write_queue.Close();
+            }
+        });
+    }
+
+    // Write
+    std::size_t written = 0;
+    while (auto job = write_queue.Pop())
+    {
+        const auto& outpath = job->outpath;
+        const auto bytes = convert ? std::as_bytes(std::span(job->ogg)) : job->wem;
+        try
+        {
+            if (!job->error.empty())
+            {
+                throw std::runtime_error(job->error);
+            }
+            if (pack != nullptr)
+            {
+                pack->Add(job->id, job->name.generic_string(), bytes);
+            }
+            else
+            {
+                WriteOutput(outpath, bytes);
+            }
+            ++written;
+            const std::scoped_lock lock(output_mutex);
+            std::println("{} {}", convert ? "Converted" : "Extracted",
+                         pack != nullptr ? job->name.generic_string() : outpath.string());
+        }
+        catch (const std::exception& e)
+        {
+            fail(outpath, e.what());
+        }
+        budget.Release(bytes.size());
+    }
+
+    std::println(stderr, "{} {} WEM(s) from {} bank(s), {} failed",
+                 convert ? "Converted" : "Extracted", written, banks.size(), failures.load());
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 // NOLINTNEXTLINE(bugprone-exception-escape)
 int main(const int argc, char* argv[])
 try
@@ -126,6 +734,7 @@ try
     {
         // If there is no input file, convert all WEM files in the current directory
         bool wem_exists = false;
+        Incremental incremental(flags, fs::current_path());
 
         for (const auto& entry : fs::directory_iterator(fs::current_path()))
         {
@@ -135,20 +744,28 @@ try
             }
 
             wem_exists = true;
-            std::println("Converting {}...", entry.path().string());
 
-            const auto indata = ReadFile(entry.path());
-            if (indata.empty())
+            const auto mapped = MapFile(entry.path());
+            if (!mapped)
             {
-                std::println(stderr, "Failed to read {}", entry.path().string());
                 return EXIT_FAILURE;
             }
+            const auto& indata = *mapped;
 
             const auto outpath = ReplaceExtension(entry.path(), ".ogg");
+            const auto input = incremental.FileInput(entry.path(), indata.Bytes());
+            if (incremental.Skip(input, outpath, g_mode_convert))
+            {
+                std::println("Skipping {} (unchanged)", entry.path().string());
+                continue;
+            }
+
+            std::println("Converting {}...", entry.path().string());
 
             try
             {
-                Convert(indata, outpath);
+                Convert(indata.View(), outpath);
+                incremental.Done(input, outpath, g_mode_convert);
             }
             catch (const std::exception& e)
             {
@@ -176,19 +793,26 @@ try
     if (command == "wem")
     {
         const fs::path path = args[2];
-        const auto indata = ReadFile(path);
-
-        if (indata.empty())
+        const auto mapped = MapFile(path);
+        if (!mapped)
         {
-            std::println(stderr, "Failed to read {}", path.string());
             return EXIT_FAILURE;
         }
+        const auto& indata = *mapped;
 
         if (HasFlag(flags, "info"))
         {
             try
             {
-                std::print("{}", ww2ogg::WemInfo(indata));
+                const auto info = ww2ogg::ParseWemInfo(std::string{indata.View()});
+                if (HasFlag(flags, "json"))
+                {
+                    ww2ogg::WriteInfoJson(info, std::cout);
+                }
+                else
+                {
+                    ww2ogg::WriteInfo(info, std::cout);
+                }
             }
             catch (const std::exception& e)
             {
@@ -199,11 +823,21 @@ try
         }
 
         const auto outpath = ReplaceExtension(path, ".ogg");
+
+        Incremental incremental(flags, path.parent_path());
+        const auto input = incremental.FileInput(path, indata.Bytes());
+        if (incremental.Skip(input, outpath, g_mode_convert))
+        {
+            std::println("Skipping {} (unchanged)", path.string());
+            return EXIT_SUCCESS;
+        }
+
         std::println("Converting {}...", outpath.string());
 
         try
         {
-            Convert(indata, outpath);
+            Convert(indata.View(), outpath);
+            incremental.Done(input, outpath, g_mode_convert);
         }
         catch (const std::exception& e)
         {
@@ -216,8 +850,12 @@ try
     // BNK command handling
     if (command == "bnk")
     {
+        // Flags come last, so the positional arguments are the rest
+        const auto positional = args.size() - flags.size();
+        const bool json = HasFlag(flags, "json");
+
         // --info only needs the BNK path, no subcommand required
-        if (argc == 3 && HasFlag(flags, "info"))
+        if (positional == 3 && HasFlag(flags, "info"))
         {
             const fs::path bnk_path = args[2];
             const auto indata = ReadFile(bnk_path);
@@ -226,11 +864,19 @@ try
                 std::println(stderr, "Failed to read {}", bnk_path.string());
                 return EXIT_FAILURE;
             }
-            std::print("{}", wwtools::bnk::GetInfo(indata));
+            const auto info = wwtools::bnk::GetBankInfo(indata);
+            if (json)
+            {
+                wwtools::bnk::WriteBankInfoJson(info, std::cout);
+            }
+            else
+            {
+                wwtools::bnk::WriteBankInfo(info, std::cout);
+            }
             return EXIT_SUCCESS;
         }
 
-        if (argc < 4)
+        if (positional < 4)
         {
             PrintHelp("You must specify whether to extract or find an event as well as the input!",
                       args[0]);
@@ -240,6 +886,92 @@ try
         const std::string_view subcommand = args[2];
         const fs::path bnk_path = args[3];
 
+        // Several banks at once (more than one input, a directory or a glob pattern), or outputs
+        // gathered in a pack
+        const std::string_view first_input = args[3];
+        const fs::path pack_path = GetFlagValue(flags, "pack");
+        if (subcommand == "extract" &&
+            (positional > 4 || !pack_path.empty() || fs::is_directory(bnk_path) ||
+             first_input.find_first_of("*?") != std::string_view::npos))
+        {
+            std::vector<BankInput> banks;
+            for (std::size_t i = 3; i < positional; ++i)
+            {
+                const fs::path input = args[i];
+                if (fs::is_directory(input))
+                {
+                    for (auto& path : wwtools::scan::FindFiles(input, {".bnk"}))
+                    {
+                        banks.push_back({.path = std::move(path), .root = input});
+                    }
+                }
+                else if (input.filename().string().find_first_of("*?") != std::string::npos)
+                {
+                    for (auto& path : wwtools::scan::ExpandGlob(input))
+                    {
+                        banks.push_back({.path = std::move(path), .root = input.parent_path()});
+                    }
+                }
+                else
+                {
+                    banks.push_back({.path = input, .root = input.parent_path()});
+                }
+            }
+            const bool convert = !HasFlag(flags, "no-convert");
+            const bool prefetch = HasFlag(flags, "prefetch");
+            const auto media = convert && !prefetch ? GetMediaIndex(flags) : std::nullopt;
+            if (pack_path.empty())
+            {
+                return ExtractBanks(banks, convert, GetThreadCount(flags), GetMemoryBudget(flags),
+                                    prefetch, media, nullptr);
+            }
+
+            // Written under a temporary name, so an interrupted run leaves no pack behind
+            auto temp_path = pack_path;
+            temp_path += ".tmp";
+            wwtools::pack::PackWriter pack(temp_path);
+            const auto result = ExtractBanks(banks, convert, GetThreadCount(flags),
+                                             GetMemoryBudget(flags), prefetch, media, &pack);
+            pack.Finish();
+            fs::rename(temp_path, pack_path);
+            std::println(stderr, "Packed into {}", pack_path.string());
+            return result;
+        }
+
+        // Replace subcommand: <id>.wem files from a directory (by default the one extract
+        // --no-convert writes to) go back into the bank, which is rewritten in place
+        if (subcommand == "replace")
+        {
+            const fs::path wem_dir =
+                positional >= 5 ? fs::path(args[4]) : ReplaceExtension(bnk_path, "");
+            auto temp_path = bnk_path;
+            temp_path += ".tmp";
+
+            std::size_t replaced = 0;
+            {
+                const wwtools::MappedFile bank(bnk_path);
+                std::vector<wwtools::MappedFile> files;
+                std::unordered_map<std::uint32_t, std::string_view> wems;
+                for (const auto id : wwtools::bnk::GetWemIds(bank.View()))
+                {
+                    const auto path = wem_dir / std::format("{}.wem", id);
+                    if (fs::is_regular_file(path))
+                    {
+                        files.emplace_back(path);
+                        wems.emplace(id, files.back().View());
+                    }
+                }
+                replaced = wems.size();
+
+                // Only renamed over the bank once every byte made it to disk
+                wwtools::BnkReplaceFile(bank.View(), wems, temp_path);
+            }
+            fs::rename(temp_path, bnk_path);
+
+            std::println("Replaced {} WEM(s) in {}", replaced, bnk_path.string());
+            return EXIT_SUCCESS;
+        }
+
         const auto indata = ReadFile(bnk_path);
         if (indata.empty())
         {
@@ -256,12 +988,21 @@ try
         if (subcommand == "event")
         {
             std::string in_event_id;
-            if (argc >= 5)
+            if (positional >= 5)
             {
                 in_event_id = args[4];
             }
 
-            std::print("{}", wwtools::bnk::GetEventIdInfo(indata, in_event_id));
+            // Written as it is formatted, so large event maps are never held as one string
+            const auto report = wwtools::bnk::GetEvents(indata, in_event_id);
+            if (json)
+            {
+                wwtools::bnk::WriteEventsJson(report, std::cout);
+            }
+            else
+            {
+                wwtools::bnk::WriteEvents(report, std::cout);
+            }
             return EXIT_SUCCESS;
         }
 
@@ -269,6 +1010,9 @@ try
         const auto wems = wwtools::BnkExtract(indata);
         const bool noconvert = HasFlag(flags, "no-convert");
 
+        Incremental incremental(flags, bnk_path.parent_path());
+        const auto bnk_mtime = wwtools::manifest::ModificationTime(bnk_path);
+
         // --no-convert: extract raw embedded data to subdirectory
         if (noconvert)
         {
@@ -278,12 +1022,27 @@ try
             for (std::size_t i = 0; i < wems.size(); ++i)
             {
                 const auto outpath = outdir / (std::to_string(wems[i].id) + ".wem");
+                const auto input =
+                    incremental.EntryInput(bnk_path, bnk_mtime, wems[i].id, wems[i].data);
 
                 std::cout << rang::fg::cyan << "[" << (i + 1) << "/" << wems.size() << "] "
-                          << rang::fg::reset << "Extracting " << outpath.string() << "...\n";
+                          << rang::fg::reset;
+                if (incremental.Skip(input, outpath, g_mode_extract))
+                {
+                    std::cout << "Skipping " << outpath.string() << " (unchanged)\n";
+                    continue;
+                }
+                std::cout << "Extracting " << outpath.string() << "...\n";
 
-                std::ofstream of(outpath, std::ios::binary);
-                of << wems[i].data;
+                try
+                {
+                    WriteOutput(outpath, std::as_bytes(std::span(wems[i].data)));
+                    incremental.Done(input, outpath, g_mode_extract);
+                }
+                catch (const std::exception& e)
+                {
+                    std::println(stderr, "Failed to extract: {}", e.what());
+                }
             }
             return EXIT_SUCCESS;
         }
@@ -291,6 +1050,11 @@ try
         // Convert mode: handle both embedded and streamed WEMs
         const auto bnk_dir = bnk_path.parent_path();
         const auto bnk_stem = bnk_path.stem().string();
+        const bool prefetch = HasFlag(flags, "prefetch");
+        const auto media =
+            !prefetch && std::ranges::any_of(wems, [](const auto& wem) { return wem.streamed; })
+                ? GetMediaIndex(flags)
+                : std::nullopt;
 
         for (std::size_t i = 0; i < wems.size(); ++i)
         {
@@ -303,12 +1067,52 @@ try
             if (!wems[i].streamed)
             {
                 // Fully embedded WEM - convert directly
+                const auto input =
+                    incremental.EntryInput(bnk_path, bnk_mtime, wems[i].id, wems[i].data);
+
                 std::cout << rang::fg::cyan << "[" << (i + 1) << "/" << wems.size() << "] "
-                          << rang::fg::reset << "Converting " << outpath.string() << "...\n";
+                          << rang::fg::reset;
+                if (incremental.Skip(input, outpath, g_mode_convert))
+                {
+                    std::cout << "Skipping " << outpath.string() << " (unchanged)\n";
+                    continue;
+                }
+                std::cout << "Converting " << outpath.string() << "...\n";
 
                 try
                 {
                     Convert(wems[i].data, outpath);
+                    incremental.Done(input, outpath, g_mode_convert);
+                }
+                catch (const std::exception& e)
+                {
+                    std::println(stderr, "Failed to convert: {}", e.what());
+                }
+            }
+            else if (prefetch)
+            {
+                // Streamed WEM previewed from its prefetch stub, without the external .wem
+                std::cout << rang::fg::cyan << "[" << (i + 1) << "/" << wems.size() << "] "
+                          << rang::fg::reset;
+                if (wems[i].data.empty())
+                {
+                    std::println(stderr, "WEM {} is streamed without prefetch data", wem_id_str);
+                    continue;
+                }
+                const auto input =
+                    incremental.EntryInput(bnk_path, bnk_mtime, wems[i].id, wems[i].data);
+                if (incremental.Skip(input, outpath, g_mode_prefetch))
+                {
+                    std::cout << "Skipping " << outpath.string() << " (unchanged)\n";
+                    continue;
+                }
+
+                try
+                {
+                    const auto samples = ConvertPrefix(wems[i].data, outpath);
+                    std::cout << "Converted prefetch data to " << outpath.string() << " ("
+                              << samples << " samples)\n";
+                    incremental.Done(input, outpath, g_mode_prefetch);
                 }
                 catch (const std::exception& e)
                 {
@@ -318,30 +1122,36 @@ try
             else
             {
                 // Streamed WEM - look for external .wem file
-                const auto external_wem = bnk_dir / (wem_id_str + ".wem");
-                if (!fs::exists(external_wem))
+                const auto found = FindStreamedWem(media, bnk_dir, wems[i].id);
+                if (!found)
                 {
-                    std::cout << rang::fg::cyan << "[" << (i + 1) << "/" << wems.size() << "] "
-                              << rang::fg::reset;
-                    std::println(stderr, "WEM {} is streamed but {} not found", wem_id_str,
-                                 external_wem.string());
                     continue;
                 }
+                const auto& external_wem = *found;
 
-                std::cout << rang::fg::cyan << "[" << (i + 1) << "/" << wems.size() << "] "
-                          << rang::fg::reset << "Converting " << external_wem.string() << " -> "
-                          << outpath.string() << "...\n";
+                const auto mapped = MapFile(external_wem);
+                if (!mapped)
+                {
+                    continue;
+                }
+                const auto& wem_data = *mapped;
+
+                const auto input = incremental.FileInput(external_wem, wem_data.Bytes());
 
-                const auto wem_data = ReadFile(external_wem);
-                if (wem_data.empty())
+                std::cout << rang::fg::cyan << "[" << (i + 1) << "/" << wems.size() << "] "
+                          << rang::fg::reset;
+                if (incremental.Skip(input, outpath, g_mode_convert))
                 {
-                    std::println(stderr, "Failed to read {}", external_wem.string());
+                    std::cout << "Skipping " << external_wem.string() << " (unchanged)\n";
                     continue;
                 }
+                std::cout << "Converting " << external_wem.string() << " -> " << outpath.string()
+                          << "...\n";
 
                 try
                 {
-                    Convert(wem_data, outpath);
+                    Convert(wem_data.View(), outpath);
+                    incremental.Done(input, outpath, g_mode_convert);
                 }
                 catch (const std::exception& e)
                 {
@@ -353,6 +1163,397 @@ try
         return EXIT_SUCCESS;
     }
 
+    // Sound cache command handling
+    if (command == "cache")
+    {
+        if (argc < 4)
+        {
+            PrintHelp("You must specify list, extract or convert as well as the input!", args[0]);
+            return EXIT_FAILURE;
+        }
+
+        const std::string_view subcommand = args[2];
+        const fs::path cache_path = args[3];
+
+        if (subcommand == "list")
+        {
+            const wwtools::w3sc::SoundCache cache(cache_path);
+            std::println("CS3W version {}, {} entries:", cache.Version(), cache.Entries().size());
+            for (const auto& entry : cache.Entries())
+            {
+                std::println("\t{} ({} bytes at {})", entry.name, entry.size, entry.offset);
+            }
+            return EXIT_SUCCESS;
+        }
+
+        if (subcommand != "extract" && subcommand != "convert")
+        {
+            PrintHelp("Incorrect value for cache command!", args[0]);
+            return EXIT_FAILURE;
+        }
+
+        const wwtools::w3sc::SoundCache cache(cache_path);
+        return ProcessArchive(
+            cache_path, cache.Entries(),
+            [&](const wwtools::w3sc::Entry& entry, std::string&) { return cache.View(entry); },
+            subcommand == "convert", GetThreadCount(flags));
+    }
+
+    // REDengine bundle command handling
+    if (command == "bundle")
+    {
+        if (argc < 4)
+        {
+            PrintHelp("You must specify list, extract or convert as well as the input!", args[0]);
+            return EXIT_FAILURE;
+        }
+
+        const std::string_view subcommand = args[2];
+        const fs::path bundle_path = args[3];
+        const wwtools::bundle::Bundle bundle(bundle_path);
+
+        if (subcommand == "list")
+        {
+            std::println("{} entries:", bundle.Entries().size());
+            for (const auto& entry : bundle.Entries())
+            {
+                std::println("\t{} ({} bytes, {} stored at {})", entry.name, entry.size,
+                             entry.compressed_size, entry.offset);
+            }
+            return EXIT_SUCCESS;
+        }
+
+        if (subcommand != "extract" && subcommand != "convert")
+        {
+            PrintHelp("Incorrect value for bundle command!", args[0]);
+            return EXIT_FAILURE;
+        }
+
+        return ProcessArchive(
+            bundle_path, bundle.Entries(),
+            [&](const wwtools::bundle::Entry& entry, std::string& scratch) {
+                return bundle.Load(entry, scratch);
+            },
+            subcommand == "convert", GetThreadCount(flags));
+    }
+
+    // wwtools pack command handling
+    if (command == "pack")
+    {
+        if (argc < 4)
+        {
+            PrintHelp("You must specify list, extract or convert as well as the input!", args[0]);
+            return EXIT_FAILURE;
+        }
+
+        const std::string_view subcommand = args[2];
+        const fs::path pack_path = args[3];
+        const wwtools::pack::Pack pack(pack_path);
+
+        if (subcommand == "list")
+        {
+            std::println("{} entries:", pack.Entries().size());
+            for (const auto& entry : pack.Entries())
+            {
+                std::println("\t{} (ID {}, {} bytes at {})", entry.name, entry.id, entry.size,
+                             entry.offset);
+            }
+            return EXIT_SUCCESS;
+        }
+
+        if (subcommand != "extract" && subcommand != "convert")
+        {
+            PrintHelp("Incorrect value for pack command!", args[0]);
+            return EXIT_FAILURE;
+        }
+
+        return ProcessArchive(
+            pack_path, pack.Entries(),
+            [&](const wwtools::pack::Entry& entry, std::string&) {
+                if (!pack.Verify(entry))
+                {
+                    throw std::runtime_error("payload does not match its hash");
+                }
+                return pack.View(entry);
+            },
+            subcommand == "convert", GetThreadCount(flags));
+    }
+
+    // Index command handling
+    if (command == "index")
+    {
+        const fs::path root = args[2];
+        if (!fs::is_directory(root))
+        {
+            std::println(stderr, "{} is not a directory", root.string());
+            return EXIT_FAILURE;
+        }
+
+        const bool binary = HasFlag(flags, "binary");
+        const auto output = GetFlagValue(flags, "output");
+        if (binary && output.empty())
+        {
+            PrintHelp("The binary index format needs --output=<file>!", args[0]);
+            return EXIT_FAILURE;
+        }
+
+        const auto index = wwtools::IndexDirectory(root, GetThreadCount(flags));
+        for (std::size_t i = 0; i < index.failed.size(); ++i)
+        {
+            std::println(stderr, "Failed to index {}: {}", index.failed[i], index.errors[i]);
+        }
+
+        if (output.empty())
+        {
+            wwtools::WriteIndexCsv(index, std::cout);
+        }
+        else
+        {
+            std::ofstream fout(fs::path(output), std::ios::binary);
+            if (!fout)
+            {
+                std::println(stderr, "Failed to open {}", output);
+                return EXIT_FAILURE;
+            }
+
+            if (binary)
+            {
+                wwtools::WriteIndexBinary(index, fout);
+            }
+            else
+            {
+                wwtools::WriteIndexCsv(index, fout);
+            }
+        }
+
+        std::println(stderr, "Indexed {} WEM(s) from {} file(s)", index.Rows(),
+                     index.sources.size());
+        return index.failed.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Reverse index command handling
+    if (command == "xref")
+    {
+        const fs::path root = args[2];
+        if (!fs::is_directory(root))
+        {
+            std::println(stderr, "{} is not a directory", root.string());
+            return EXIT_FAILURE;
+        }
+
+        const auto wem_ids = ParseIds(GetFlagValue(flags, "wem"));
+        if (!wem_ids)
+        {
+            PrintHelp("--wem needs a comma-separated list of WEM IDs!", args[0]);
+            return EXIT_FAILURE;
+        }
+
+        // The index is kept next to the banks and brought up to date on every run
+        const auto custom = GetFlagValue(flags, "index");
+        const auto index_path = custom.empty() ? root / ".wwtools-xref" : fs::path(custom);
+
+        wwtools::WemXref xref;
+        if (std::ifstream fin(index_path, std::ios::binary); fin)
+        {
+            try
+            {
+                xref = wwtools::ReadXref(fin);
+            }
+            catch (const std::exception& e)
+            {
+                std::println(stderr, "Rebuilding {}: {}", index_path.string(), e.what());
+            }
+        }
+
+        const auto updated = wwtools::UpdateXref(xref, root, GetThreadCount(flags));
+        for (std::size_t i = 0; i < xref.failed.size(); ++i)
+        {
+            std::println(stderr, "Failed to read {}: {}", xref.failed[i], xref.errors[i]);
+        }
+        if (updated != 0 || !fs::exists(index_path))
+        {
+            auto temp_path = index_path;
+            temp_path += ".tmp";
+            {
+                std::ofstream fout(temp_path, std::ios::binary | std::ios::trunc);
+                wwtools::WriteXref(xref, fout);
+                if (!fout.flush())
+                {
+                    std::println(stderr, "Failed to write {}", temp_path.string());
+                    return EXIT_FAILURE;
+                }
+            }
+            fs::rename(temp_path, index_path);
+        }
+
+        const auto output = GetFlagValue(flags, "output");
+        if (output.empty())
+        {
+            wwtools::WriteXrefCsv(xref, std::cout, *wem_ids);
+        }
+        else
+        {
+            std::ofstream fout(fs::path(output), std::ios::binary);
+            if (!fout)
+            {
+                std::println(stderr, "Failed to open {}", output);
+                return EXIT_FAILURE;
+            }
+            wwtools::WriteXrefCsv(xref, fout, *wem_ids);
+        }
+
+        std::println(stderr, "{} reference(s) in {} bank(s), {} bank(s) updated", xref.hits.size(),
+                     xref.banks.size(), updated);
+        return xref.failed.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Granule repair command handling
+    if (command == "revorb")
+    {
+        const fs::path root = args[2];
+        if (!fs::is_directory(root))
+        {
+            std::println(stderr, "{} is not a directory", root.string());
+            return EXIT_FAILURE;
+        }
+
+        const auto files = wwtools::scan::FindFiles(root, {".ogg"});
+
+        std::mutex output_mutex;
+        std::atomic<std::size_t> fixed{0};
+        std::atomic<std::size_t> failures{0};
+
+        wwtools::parallel::ForEachIndex(
+            files.size(),
+            [&](const std::size_t i) {
+                const auto& path = files[i];
+                try
+                {
+                    // The mapping is released before the file is replaced
+                    std::optional<std::string> outdata;
+                    {
+                        const wwtools::MappedFile indata(path);
+                        outdata = wwtools::FixOggGranules(indata.View());
+                    }
+                    if (!outdata)
+                    {
+                        return;
+                    }
+
+                    ReplaceFile(path, *outdata);
+                    ++fixed;
+                    const std::scoped_lock lock(output_mutex);
+                    std::println("Fixed {}", path.string());
+                }
+                catch (const std::exception& e)
+                {
+                    const std::scoped_lock lock(output_mutex);
+                    std::println(stderr, "Failed to fix {}: {}", path.string(), e.what());
+                    ++failures;
+                }
+            },
+            GetThreadCount(flags));
+
+        std::println(stderr, "Fixed {} of {} OGG(s), {} failed", fixed.load(), files.size(),
+                     failures.load());
+        return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Converted output verification
+    if (command == "verify")
+    {
+        const fs::path root = args[2];
+        if (!fs::is_directory(root))
+        {
+            std::println(stderr, "{} is not a directory", root.string());
+            return EXIT_FAILURE;
+        }
+
+        const auto files = wwtools::scan::FindFiles(root, {".ogg"});
+
+        std::mutex output_mutex;
+        std::atomic<std::size_t> invalid{0};
+
+        wwtools::parallel::ForEachIndex(
+            files.size(),
+            [&](const std::size_t i) {
+                std::string error;
+                try
+                {
+                    const wwtools::MappedFile indata(files[i]);
+                    error = wwtools::VerifyOgg(indata.View()).error;
+                }
+                catch (const std::exception& e)
+                {
+                    error = e.what();
+                }
+                if (!error.empty())
+                {
+                    ++invalid;
+                    const std::scoped_lock lock(output_mutex);
+                    std::println("Invalid {}: {}", files[i].string(), error);
+                }
+            },
+            GetThreadCount(flags));
+
+        std::println(stderr, "{} of {} OGG(s) valid", files.size() - invalid, files.size());
+        return invalid == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // OGG to WEM command handling
+    if (command == "ogg")
+    {
+        const fs::path input = args[2];
+        // Modified packets only come with 2-byte packet headers
+        const bool granules = HasFlag(flags, "granules");
+        const wwtools::WemEncoding encoding{
+            .granules = granules,
+            .mod_packets = !granules && !HasFlag(flags, "standard-packets"),
+            .big_endian = HasFlag(flags, "rifx"),
+        };
+
+        std::vector<fs::path> files;
+        if (fs::is_directory(input))
+        {
+            files = wwtools::scan::FindFiles(input, {".ogg"});
+        }
+        else
+        {
+            files.push_back(input);
+        }
+
+        std::mutex output_mutex;
+        std::atomic<std::size_t> failures{0};
+
+        wwtools::parallel::ForEachIndex(
+            files.size(),
+            [&](const std::size_t i) {
+                const auto& path = files[i];
+                try
+                {
+                    const wwtools::MappedFile indata(path);
+                    const auto outpath = ReplaceExtension(path, ".wem");
+                    ReplaceFile(outpath, wwtools::Ogg2Wem(indata.View(), encoding));
+                    const std::scoped_lock lock(output_mutex);
+                    std::println("Converted {}", outpath.string());
+                }
+                catch (const std::exception& e)
+                {
+                    const std::scoped_lock lock(output_mutex);
+                    std::println(stderr, "Failed to convert {}: {}", path.string(), e.what());
+                    ++failures;
+                }
+            },
+            GetThreadCount(flags));
+
+        if (files.size() > 1)
+        {
+            std::println(stderr, "Converted {} of {} OGG(s)", files.size() - failures,
+                         files.size());
+        }
+        return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     // Unknown command
     PrintHelp("Unknown command!", args[0]);
     return EXIT_FAILURE;
@@ -34,9 +34,12 @@ class WwiseAudioToolsConan(ConanFile):
     def requirements(self):
         self.requires("cmake-package-builder/1.2.0") #recipe: https://github.com/tnt-coders/cmake-package-builder.git
         self.requires("kaitai_struct_cpp_stl_runtime/0.11")
+        self.requires("lz4/1.9.4")
         self.requires("ogg/1.3.5")
         self.requires("rang/3.2")
         self.requires("vorbis/1.3.7")
+        self.requires("xxhash/0.8.2")
+        self.requires("zlib/1.3.1")
 
         self.test_requires("catch2/3.12.0")
 
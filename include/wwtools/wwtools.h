@@ -11,9 +11,16 @@
  *
  */
 
+#include <cstddef>
 #include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <span>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
 /**
@@ -34,6 +41,127 @@ struct BnkEntry
     std::string data; ///< Embedded WEM data (full file if !streamed, prefetch stub if streamed)
 };
 
+/**
+ * @brief Decoded PCM audio
+ *
+ * @tparam Sample sample type (std::int16_t or float)
+ */
+template <typename Sample> struct Pcm
+{
+    std::uint16_t channels;      ///< number of channels
+    std::uint32_t sample_rate;   ///< sample rate in Hz
+    std::vector<Sample> samples; ///< interleaved samples, frames * channels values
+};
+
+/**
+ * @brief Envelope of one waveform bucket
+ */
+struct WaveformPoint
+{
+    float min; ///< lowest sample in the bucket
+    float max; ///< highest sample in the bucket
+    float rms; ///< root mean square of the bucket's samples
+};
+
+/**
+ * @brief Downsampled min/max/RMS envelope of a decoded WEM
+ */
+struct Waveform
+{
+    std::uint16_t channels;    ///< number of channels (0 if the WEM could not be decoded)
+    std::uint32_t sample_rate; ///< sample rate in Hz
+    std::uint64_t frames;      ///< number of frames summarized
+    std::size_t resolution;    ///< buckets per channel
+    std::vector<WaveformPoint> points; ///< channel-major: points[channel * resolution + bucket]
+};
+
+/**
+ * @brief WEM stream metadata read from the RIFF chunk headers alone
+ */
+struct WemMetadata
+{
+    std::uint16_t codec;                ///< fmt format tag (0xFFFF = Vorbis, 0xFFFE = PCM, ...)
+    bool big_endian;                    ///< true for RIFX containers
+    bool complete;                      ///< false if the data is only a prefix (prefetch stub)
+    std::uint16_t channels;             ///< number of channels
+    std::uint32_t sample_rate;          ///< sample rate in Hz
+    std::uint32_t avg_bytes_per_second; ///< average byte rate from fmt
+    std::uint16_t block_align;          ///< block alignment from fmt
+    std::uint16_t bits_per_sample;      ///< bits per sample from fmt (0 for Vorbis)
+    std::uint32_t channel_mask;         ///< speaker layout mask from extended fmt
+    std::uint32_t sample_count;         ///< frames in the stream (0 if unknown for the codec)
+    std::uint32_t loop_count;           ///< number of smpl loops
+    std::uint32_t loop_start;           ///< loop start in samples
+    std::uint32_t loop_end;             ///< loop end in samples (exclusive)
+    std::uint32_t riff_size;            ///< full file size declared by the RIFF header
+    std::uint32_t data_offset;          ///< offset of the data chunk payload (0 if not reached)
+    std::uint32_t data_size;            ///< declared size of the data chunk payload
+};
+
+/**
+ * @brief Outcome of checking an OGG Vorbis stream without decoding it
+ */
+struct OggVerification
+{
+    bool valid;            ///< true if every check passed
+    std::string error;     ///< the first problem found (empty if valid)
+    std::uint64_t pages;   ///< pages read before stopping
+    std::uint64_t packets; ///< audio packets checked before stopping
+    std::int64_t granule;  ///< last granule position seen (-1 if none)
+};
+
+/**
+ * @brief Columnar metadata table of WEMs found in loose files and soundbanks
+ *
+ * Row i is made of element i of every column.  Rows without readable metadata (e.g. streamed
+ * sounds that have no data in their bank) have zero channels, sample rate and codec.
+ */
+struct WemIndex
+{
+    std::vector<std::string> sources; ///< source files relative to the indexed root
+
+    std::vector<std::uint32_t> id;           ///< WEM ID (from DIDX/HIRC, or a loose file's name)
+    std::vector<std::uint32_t> source;       ///< index into sources
+    std::vector<std::uint64_t> offset;       ///< byte offset of the WEM within its source
+    std::vector<std::uint64_t> size;         ///< byte size (prefetch stub size if streamed)
+    std::vector<std::uint16_t> channels;     ///< number of channels
+    std::vector<std::uint32_t> sample_rate;  ///< sample rate in Hz
+    std::vector<std::uint32_t> sample_count; ///< frames in the full stream
+    std::vector<std::uint32_t> loop_start;   ///< loop start in samples
+    std::vector<std::uint32_t> loop_end;     ///< loop end in samples (exclusive, 0 if no loop)
+    std::vector<std::uint8_t> streamed;      ///< 1 if the bank entry is streamed or prefetched
+    std::vector<std::uint16_t> codec;        ///< fmt format tag
+
+    std::vector<std::string> failed; ///< files that could not be read or probed, like sources
+    std::vector<std::string> errors; ///< why each of failed could not be
+
+    /**
+     * @brief number of rows
+     */
+    [[nodiscard]] std::size_t Rows() const
+    {
+        return id.size();
+    }
+
+    /**
+     * @brief reserve room for `rows` rows in every column
+     */
+    void Reserve(std::size_t rows)
+    {
+        id.reserve(rows);
+        source.reserve(rows);
+        offset.reserve(rows);
+        size.reserve(rows);
+        channels.reserve(rows);
+        sample_rate.reserve(rows);
+        sample_count.reserve(rows);
+        loop_start.reserve(rows);
+        loop_end.reserve(rows);
+        streamed.reserve(rows);
+        codec.reserve(rows);
+    }
+};
+
 /**
  * @brief get OGG file data from WEM file data
  *
@@ -43,6 +171,291 @@ struct BnkEntry
  */
 [[nodiscard]] std::string Wem2Ogg(std::string_view indata);
 
+/**
+ * @brief convert WEM file data to an OGG file on disk
+ *
+ * Produces the same OGG as Wem2Ogg, but its pages go straight to the file as they are written,
+ * through one buffered writer that preallocates the file, instead of being collected in a string
+ * and copied through an ofstream.
+ *
+ * @param indata WEM file data
+ * @param outpath OGG file to create or overwrite (removed again if the conversion fails)
+ * @throws std::exception on conversion failure or when the file cannot be written
+ */
+void Wem2OggFile(std::string_view indata, const std::filesystem::path& outpath);
+
+/**
+ * @brief OGG Vorbis converted from the start of a WEM, see Wem2OggPrefix
+ */
+struct PartialOgg
+{
+    std::string ogg;       ///< OGG file data, ending with the last audio packet converted
+    std::uint64_t samples; ///< samples per channel the OGG decodes to
+    bool complete;         ///< true if the WEM was whole, so the OGG covers all of it
+};
+
+/**
+ * @brief get OGG file data from as much of a WEM as there is
+ *
+ * Converts a WEM cut short inside its audio data, such as the prefetch stub a BNK embeds for a
+ * streamed WEM (BnkEntry::data), into a shorter but valid OGG that ends after the last audio
+ * packet present in full.  Previews and indexing of streamed sounds then need no access to the
+ * external media.  Whole WEMs convert exactly as with Wem2Ogg.
+ *
+ * @param indata WEM file data, or a prefix of it that reaches into the data chunk
+ * @return the OGG and how much of the sound it covers
+ * @throws std::exception if the headers or the setup packet are cut off, or on conversion failure
+ */
+[[nodiscard]] PartialOgg Wem2OggPrefix(std::string_view indata);
+
+/**
+ * @brief rewrite the granule positions of an OGG Vorbis stream, as Wem2Ogg does
+ *
+ * For OGGs written by converters that left wrong granules behind.  A quick pass that sizes the
+ * packets without re-paging anything checks the granules first, so streams that are already
+ * correct cost no rewrite.
+ *
+ * @param indata OGG file data
+ * @return the fixed OGG file data, or std::nullopt if the granules are already correct
+ * @throws std::exception if the data is not a valid OGG Vorbis stream
+ */
+[[nodiscard]] std::optional<std::string> FixOggGranules(std::string_view indata);
+
+/**
+ * @brief Layout of a WEM written by Ogg2Wem
+ */
+struct WemEncoding
+{
+    bool granules = false;   ///< 6-byte packet headers with granules (vorb chunk) instead of 2-byte
+    bool mod_packets = true; ///< Wwise modified audio packets (needs 2-byte packet headers)
+    bool big_endian = false; ///< RIFX rather than RIFF
+};
+
+/**
+ * @brief get WEM file data from OGG Vorbis file data, the inverse of Wem2Ogg
+ *
+ * The setup header is stored in Wwise's compact form, which refers to codebooks by their ID in
+ * the built-in codebook library, so only OGGs whose codebooks are all in it convert (those
+ * written by Wem2Ogg always are).  What a WEM cannot hold is dropped: vendor and comments (except
+ * the LoopStart/LoopEnd loop points Wem2Ogg writes, which become a smpl loop), bitrate bounds
+ * and empty packets.  Converting the result back yields the same audio packets.
+ *
+ * @param indata OGG file data
+ * @param encoding WEM layout to write
+ * @return WEM file data
+ * @throws std::exception if the OGG is invalid, uses codebooks or features a WEM cannot hold, or
+ * the encoding is impossible
+ */
+[[nodiscard]] std::string Ogg2Wem(std::string_view indata, const WemEncoding& encoding = {});
+
+/**
+ * @brief check converted OGG Vorbis data without decoding it
+ *
+ * Catches corrupt reconstructions (e.g. the wrong codebook library) at a fraction of the cost of
+ * a full decode: page checksums and sequence numbers are checked, granule positions must never
+ * decrease, the three Vorbis headers must parse and every audio packet must name a mode of the
+ * setup header.  Audio is not synthesized, so errors inside a packet's residue go unnoticed.
+ *
+ * @param indata OGG file data
+ * @return the outcome, with the first problem found
+ */
+[[nodiscard]] OggVerification VerifyOgg(std::string_view indata);
+
+/**
+ * @brief check a batch of OGG Vorbis files in parallel
+ *
+ * @param oggs OGG file data
+ * @param threads worker threads to use (0 = one per hardware thread)
+ * @return one result per input, in the same order
+ * @see VerifyOgg
+ */
+[[nodiscard]] std::vector<OggVerification> VerifyOggs(std::span<const std::string_view> oggs,
+                                                      unsigned int threads = 0);
+
+/**
+ * @brief decode WEM file data directly to interleaved 16-bit PCM
+ *
+ * Reconstructed Vorbis packets are fed straight to libvorbis synthesis, so this is
+ * considerably cheaper than Wem2Ogg followed by an OGG decode. Output is trimmed to the
+ * sample count declared by the WEM.
+ *
+ * @param indata WEM file data
+ * @return decoded PCM
+ * @throws std::exception on decode failure
+ */
+[[nodiscard]] Pcm<std::int16_t> Wem2Pcm(std::string_view indata);
+
+/**
+ * @brief decode WEM file data directly to interleaved float PCM (nominal range [-1, 1])
+ *
+ * @param indata WEM file data
+ * @return decoded PCM
+ * @throws std::exception on decode failure
+ * @see Wem2Pcm
+ */
+[[nodiscard]] Pcm<float> Wem2PcmFloat(std::string_view indata);
+
+/**
+ * @brief read WEM metadata from the RIFF headers without decoding or copying anything
+ *
+ * Only the chunk headers and the fmt/smpl/vorb fields are touched, so a prefix of the file is
+ * enough, e.g. the prefetch stub embedded in a BNK for a streamed WEM.
+ *
+ * @param data WEM file data or a prefix of it that contains the fmt chunk
+ * @return the metadata
+ * @throws std::exception if the data is not a RIFF/RIFX WAVE or lacks a valid fmt chunk
+ */
+[[nodiscard]] WemMetadata ProbeWem(std::span<const std::byte> data);
+
+/**
+ * @brief index every WEM under a directory
+ *
+ * Recursively finds .wem and .bnk files and probes them in parallel: loose WEMs through a short
+ * prefix read, banks through their DIDX entries (embedded and prefetch) plus the streamed-only
+ * sounds listed in HIRC.  Files that cannot be read or probed contribute no rows and are listed
+ * in failed instead.
+ *
+ * @param root directory to walk
+ * @param threads worker threads to use (0 = one per hardware thread)
+ * @return the index, ordered by source path
+ */
+[[nodiscard]] WemIndex IndexDirectory(const std::filesystem::path& root,
+                                      unsigned int threads = 0);
+
+/**
+ * @brief write an index as CSV with a header row
+ */
+void WriteIndexCsv(const WemIndex& index, std::ostream& os);
+
+/**
+ * @brief write an index in the columnar binary format
+ *
+ * Layout (all integers little-endian): "WWIX", u32 version, u64 row count, u32 source count,
+ * each source as u32 length + UTF-8 bytes, then every column as a packed array in WemIndex
+ * member order.
+ */
+void WriteIndexBinary(const WemIndex& index, std::ostream& os);
+
+/**
+ * @brief One way an event of a soundbank reaches a WEM
+ */
+struct WemReference
+{
+    std::uint32_t wem_id;   ///< WEM played by the sound or music track
+    std::uint32_t event_id; ///< event whose action reaches it
+    std::string event_name; ///< event name from the bank's STID section (empty if absent)
+    std::uint8_t action_type; ///< event action type (1 = stop, 2 = pause, 3 = resume, 4 = play)
+    std::vector<std::uint32_t> path; ///< object IDs from the action's target down to the sound
+                                     ///< or music track playing the WEM
+};
+
+/**
+ * @brief The references found in one soundbank and the file state they were read from
+ */
+struct XrefBank
+{
+    std::string path;   ///< bank path relative to the indexed root
+    std::uint64_t size; ///< file size in bytes
+    std::int64_t mtime; ///< modification time in filesystem clock ticks
+    std::uint64_t hash; ///< XXH3 of the file contents
+    std::vector<WemReference> references; ///< in event order
+};
+
+/**
+ * @brief Location of a reference: banks[bank].references[reference]
+ */
+struct XrefHit
+{
+    std::uint32_t wem_id;    ///< WEM ID of the reference
+    std::uint32_t bank;      ///< index into WemXref::banks
+    std::uint32_t reference; ///< index into that bank's references
+};
+
+/**
+ * @brief Reverse index from WEM IDs to the events and soundbanks that reference them
+ */
+struct WemXref
+{
+    std::vector<XrefBank> banks; ///< ordered by path
+    std::vector<XrefHit> hits;   ///< every reference, ordered by WEM ID, then bank
+
+    std::vector<std::string> failed; ///< banks that could not be read or parsed, like paths
+    std::vector<std::string> errors; ///< why each of failed could not be
+
+    /**
+     * @brief the references to one WEM, in bank order
+     */
+    [[nodiscard]] std::span<const XrefHit> Find(std::uint32_t wem_id) const;
+
+    /**
+     * @brief the reference a hit points to
+     */
+    [[nodiscard]] const WemReference& Reference(const XrefHit& hit) const
+    {
+        return banks[hit.bank].references[hit.reference];
+    }
+};
+
+/**
+ * @brief bring a reverse index up to date with the soundbanks under a directory
+ *
+ * Recursively finds .bnk files.  Banks whose size and modification time match their entry in
+ * `xref` are kept as they are; touched banks are hashed and only re-parsed if their bytes
+ * changed.  New and changed banks are parsed in parallel, each event action being resolved
+ * through the bank's container hierarchy down to the WEMs it plays.  Banks that no longer exist
+ * are dropped.  Banks that cannot be read or parsed are listed in failed and left out of banks,
+ * so the next update tries them again.  Only references between an event and the objects stored
+ * in the same bank are found.
+ *
+ * @param xref index to update, e.g. empty or as returned by ReadXref
+ * @param root directory to walk
+ * @param threads worker threads to use (0 = one per hardware thread)
+ * @return number of banks read or dropped (0 if the index was already up to date)
+ */
+[[nodiscard]] std::size_t UpdateXref(WemXref& xref, const std::filesystem::path& root,
+                                    unsigned int threads = 0);
+
+/**
+ * @brief write a reverse index in its binary format
+ *
+ * Layout (all integers little-endian): "WWXR", u32 format version, the tool version as u32
+ * length + bytes, u32 bank count, then for each bank its path (u32 length + UTF-8 bytes), u64
+ * size, i64 mtime, u64 hash and u32 reference count, each reference being u32 WEM ID, u32 event
+ * ID, u8 action type, the event name (u32 length + bytes) and the path (u32 count + u32 IDs).
+ */
+void WriteXref(const WemXref& xref, std::ostream& os);
+
+/**
+ * @brief read a reverse index written by WriteXref
+ *
+ * An index written by another tool version comes back empty, so that UpdateXref re-parses every
+ * bank with the current parser.
+ *
+ * @throws std::runtime_error if the data is not a reverse index or is truncated
+ */
+[[nodiscard]] WemXref ReadXref(std::istream& is);
+
+/**
+ * @brief write the references to the given WEMs (all of them when empty) as CSV
+ *
+ * Columns: wem, bank, event, event_name, action, path (object IDs joined with '/').
+ */
+void WriteXrefCsv(const WemXref& xref, std::ostream& os,
+                  std::span<const std::uint32_t> wem_ids = {});
+
+/**
+ * @brief compute a min/max/RMS waveform envelope for WEM file data
+ *
+ * Decodes the WEM in a streaming fashion and folds each block into `resolution` buckets per
+ * channel, so memory stays bounded no matter how long the audio is.
+ *
+ * @param indata WEM file data
+ * @param resolution number of buckets per channel (must be non-zero)
+ * @return the waveform envelope
+ * @throws std::exception on decode failure or when resolution is 0
+ */
+[[nodiscard]] Waveform WemWaveform(std::string_view indata, std::size_t resolution);
+
 /**
  * @brief extract all WEMs from a BNK soundbank with their IDs and streaming status
  *
@@ -55,4 +468,52 @@ struct BnkEntry
  */
 [[nodiscard]] std::vector<BnkEntry> BnkExtract(std::string_view indata);
 
+/**
+ * @brief write a BNK soundbank with some of its embedded WEMs replaced
+ *
+ * Only the data index, the DATA section length and the HIRC fields locating embedded media are
+ * rebuilt; every other byte, untouched WEMs included, is copied straight from the input.  WEMs
+ * after the first replaced one are moved to the bank's media alignment.
+ *
+ * @param indata BNK file data
+ * @param wems replacement WEM file data by WEM ID; every ID must be embedded in the bank
+ * @param os stream receiving the new bank
+ * @throws std::runtime_error if the bank is malformed or has no embedded WEMs, an ID is not in
+ * its data index, or writing fails
+ */
+void BnkReplace(std::string_view indata,
+                const std::unordered_map<std::uint32_t, std::string_view>& wems, std::ostream& os);
+
+/**
+ * @brief write a BNK soundbank with some of its embedded WEMs replaced to a file on disk
+ *
+ * Produces the same bank as BnkReplace, but the copied and rebuilt ranges go to the file as one
+ * gathered, preallocated write instead of through an ostream.
+ *
+ * @param indata BNK file data
+ * @param wems replacement WEM file data by WEM ID; every ID must be embedded in the bank
+ * @param outpath BNK file to create or overwrite (removed again if writing fails)
+ * @throws std::exception if the bank is malformed or has no embedded WEMs, an ID is not in its
+ * data index, or the file cannot be written
+ */
+void BnkReplaceFile(std::string_view indata,
+                    const std::unordered_map<std::uint32_t, std::string_view>& wems,
+                    const std::filesystem::path& outpath);
+
+/**
+ * @brief compute waveform envelopes for BNK entries in parallel
+ *
+ * Streamed entries (which only carry a prefetch stub) and entries that fail to decode yield a
+ * Waveform with channels == 0 and no points.
+ *
+ * @param entries entries returned by BnkExtract
+ * @param resolution number of buckets per channel (must be non-zero)
+ * @param threads worker threads to use (0 = one per hardware thread)
+ * @return one Waveform per entry, in the same order
+ * @throws std::invalid_argument when resolution is 0
+ */
+[[nodiscard]] std::vector<Waveform> BnkWaveforms(std::span<const BnkEntry> entries,
+                                                 std::size_t resolution,
+                                                 unsigned int threads = 0);
+
 } // namespace wwtools
@@ -1,130 +1,84 @@
+#include <algorithm>
+#include <bit>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <format>
 #include <map>
+#include <ostream>
+#include <span>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
 #include <vector>
 
 #include "bnk.h"
-#include "kaitai/kaitaistream.h"
-#include "kaitai/structs/bnk.h"
+#include "json.h"
+#include "soundbank.h"
+#include "wem/byte_reader.h"
 
 namespace
 {
 
-// Associates an event action (play/stop/etc.) with the SFX object it targets.
-// m_is_child is set when the SFX was reached through a parent container rather
-// than being directly referenced by the event action's game_object_id.
-struct EventSFX
-{
-    bnk_t::action_type_t m_action_type{};
-    bnk_t::sound_effect_or_voice_t* m_sfx = nullptr;
-    bool m_is_child = false;
-};
+using wwtools::bnk::ActionType;
+using wwtools::bnk::EventActionRecord;
+using wwtools::bnk::EventRecord;
+using wwtools::bnk::ObjectType;
+using wwtools::bnk::ResolvedWem;
 
-// Searches the top-level BNK section list for one matching `type` (e.g. "BKHD", "DATA", "HIRC")
-// and returns a pointer to its parsed data, or nullptr if not present.
-template <typename T> [[nodiscard]] T* FindSection(bnk_t& bnk, std::string_view type)
+[[nodiscard]] wwtools::bnk::Soundbank Parse(const std::string_view indata)
 {
-    for (const auto& section : *bnk.data())
-    {
-        if (section->type() == type)
-        {
-            return static_cast<T*>(section->section_data());
-        }
-    }
-    return nullptr;
-}
-
-// Extracts the parent object ID from a SFX's raw sound_structure blob.
-//
-// The sound_structure layout (simplified):
-//   [0]     override_parent_fx (1 byte)
-//   [1]     num_effects (1 byte)
-//   if num_effects > 0:
-//     [2]     bypassed_fx bitmask (1 byte)
-//     [3..]   num_effects * 7 bytes of effect entries
-//   then:
-//     [+0..+3]  bus_id (4 bytes, skipped)
-//     [+4..+5]  direct_parent_id is at offset +4 (but we read from offset 6 + effect_block_size)
-//
-// The parent ID links an SFX to its container (e.g. random/sequence container),
-// allowing event->container->child SFX resolution in GetEventIdInfo.
-[[nodiscard]] std::uint32_t GetParentId(bnk_t::sound_effect_or_voice_t* sfx)
-{
-    std::uint32_t parent_id_offset = 6;
-    const auto& sound_structure = sfx->sound_structure();
-
-    if (sound_structure.size() < 2)
-    {
-        return 0;
-    }
-
-    const auto num_effects = static_cast<std::uint8_t>(sound_structure.at(1));
-    if (num_effects > 0)
-    {
-        parent_id_offset++;                  // bit mask for bypassed effects
-        parent_id_offset += num_effects * 7; // 7 bytes for each effect
-    }
-
-    if (sound_structure.size() < parent_id_offset + 4)
-    {
-        return 0;
-    }
-
-    // Read the 4-byte LE parent ID from the computed offset
-    std::uint32_t parent_id = 0;
-    std::stringstream ss;
-    ss.write(sound_structure.c_str(), static_cast<std::streamsize>(sound_structure.size()));
-    ss.seekg(static_cast<std::streamoff>(parent_id_offset));
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-    ss.read(reinterpret_cast<char*>(&parent_id), 4);
-
-    return parent_id;
+    return wwtools::bnk::Soundbank(std::as_bytes(std::span(indata)));
 }
 
 // Maps a BNK event action type enum to a human-readable label.
 // Uses a thread_local string for unknown types so the returned string_view stays valid.
-[[nodiscard]] std::string_view GetEventActionType(const bnk_t::action_type_t action_type)
+[[nodiscard]] std::string_view GetEventActionType(const ActionType action_type)
 {
-    switch (action_type)
+    const auto name = wwtools::bnk::ActionTypeName(action_type);
+    if (!name.empty())
     {
-    case bnk_t::ACTION_TYPE_PLAY:
-        return "play";
-    case bnk_t::ACTION_TYPE_PAUSE:
-        return "pause";
-    case bnk_t::ACTION_TYPE_STOP:
-        return "stop";
-    case bnk_t::ACTION_TYPE_RESUME:
-        return "resume";
-    default:
-        // For unknown types, we need to return a stable string
-        // Using a thread_local static for the formatted string
-        thread_local std::string g_unknown_type;
-        g_unknown_type = std::to_string(static_cast<int>(action_type));
-        return g_unknown_type;
+        return name;
     }
+
+    // For unknown types, we need to return a stable string
+    // Using a thread_local static for the formatted string
+    thread_local std::string g_unknown_type;
+    g_unknown_type = std::to_string(static_cast<int>(action_type));
+    return g_unknown_type;
 }
 
-// Searches the STID (string-to-ID mapping) section for a human-readable event name.
-// Returns empty string when stid_data is null or the ID isn't found.
-[[nodiscard]] std::string LookupEventName(bnk_t::stid_data_t* stid_data,
-                                          const std::uint32_t event_id)
+// Payload location of a top-level BNK section found by walking the section headers.
+struct SectionSpan
 {
-    if (!stid_data)
-    {
-        return {};
-    }
+    std::size_t offset = 0;
+    std::size_t size = 0;
+    bool present = false;
+};
 
-    for (const auto* stid_obj : *stid_data->objs())
+// Finds the first top-level section of type `fourcc` (sections are a 4-byte tag plus LE u32
+// length); a section running past the end of the data is truncated to what is available.
+[[nodiscard]] SectionSpan FindSectionSpan(const std::span<const std::byte> data,
+                                          const char* fourcc)
+{
+    std::size_t offset = 0;
+    while (offset + 8 <= data.size())
     {
-        if (stid_obj->id() == event_id)
+        const auto length =
+            wwtools::wem::Load<std::uint32_t, std::endian::little>(data, offset + 4);
+        const std::size_t payload = offset + 8;
+        if (std::memcmp(data.data() + offset, fourcc, 4) == 0)
         {
-            return stid_obj->name();
+            return {.offset = payload,
+                    .size = std::min<std::size_t>(length, data.size() - payload),
+                    .present = true};
         }
+        offset = payload + length;
     }
-
     return {};
 }
 
@@ -133,175 +87,224 @@ template <typename T> [[nodiscard]] T* FindSection(bnk_t& bnk, std::string_view
 namespace wwtools::bnk
 {
 
-// Parses the BNK and pulls raw WEM file blobs from the DATA section.
+// Pulls raw WEM file blobs from the DATA section.
 // The DATA section contains a DIDX (data index) followed by concatenated WEM payloads.
 // Each entry in outdata corresponds to one embedded WEM in index order.
 void Extract(const std::string_view indata, std::vector<std::string>& outdata)
 {
-    kaitai::kstream ks(std::string{indata});
-    bnk_t bnk(&ks);
-
-    auto* data_section = FindSection<bnk_t::data_data_t>(bnk, "DATA");
-    if (!data_section)
+    const auto bank = Parse(indata);
+    if (!bank.HasData())
     {
         return;
     }
 
-    const auto num_files = data_section->didx_data()->num_files();
-    outdata.reserve(num_files);
-
-    for (const auto& file_data : *data_section->data_obj_section()->data())
+    const auto entries = bank.DataIndex();
+    outdata.reserve(outdata.size() + entries.size());
+    for (const auto& entry : entries)
     {
-        outdata.push_back(file_data->file());
+        outdata.emplace_back(indata.substr(entry.offset, entry.size));
     }
 }
 
-[[nodiscard]] std::string GetInfo(const std::string_view indata)
+[[nodiscard]] BankInfo GetBankInfo(const std::string_view indata)
 {
-    kaitai::kstream ks(std::string{indata});
-    bnk_t bnk(&ks);
-
-    std::string result;
-
-    // Get bank header info
-    if (auto* bkhd = FindSection<bnk_t::bkhd_data_t>(bnk, "BKHD"))
+    const auto bank = Parse(indata);
+
+    BankInfo info;
+    info.has_header = bank.HasHeader();
+    info.has_data_index = bank.HasDataIndex();
+    info.version = bank.Version();
+    info.id = bank.Id();
+    info.wem_ids.reserve(bank.DataIndex().size());
+    for (const auto& entry : bank.DataIndex())
     {
-        result += std::format("Version: {}\n", bkhd->version());
-        result += std::format("Soundbank ID: {}\n", bkhd->id());
-    }
-
-    // Get data index info
-    if (auto* didx = FindSection<bnk_t::didx_data_t>(bnk, "DIDX"))
-    {
-        result += std::format("{} embedded WEM files:\n", didx->num_files());
-        for (const auto& index : *didx->objs())
-        {
-            result += std::format("\t{}\n", index->id());
-        }
+        info.wem_ids.push_back(entry.id);
     }
+    return info;
+}
 
-    return result;
+[[nodiscard]] std::string GetInfo(const std::string_view indata)
+{
+    std::ostringstream result;
+    WriteBankInfo(GetBankInfo(indata), result);
+    return std::move(result).str();
 }
 
-// Builds a human-readable report mapping events to the WEM audio files they trigger.
-//
-// Resolution chain: Event -> EventAction(s) -> SFX object(s) -> audio_file_id
+// Resolution chain: Event -> EventAction(s) -> target object -> every sound and music track
+// below it in the hierarchy, through any depth of containers
 //
 // When in_event_id is empty, reports on ALL events in the BNK.  When non-empty,
 // filters to just the event whose numeric ID matches the string.
 //
-// The three-pass approach:
-//   Pass 1: Find events and collect their event-action references
-//   Pass 2: Find SFX objects and match them to events via game_object_id or parent_id
-//   Pass 3: Format the result string
-[[nodiscard]] std::string GetEventIdInfo(const std::string_view indata,
-                                         const std::string_view in_event_id)
+// Action and name lookups go through hash indexes, so the work is linear in the objects visited.
+[[nodiscard]] EventReport GetEvents(const std::string_view indata,
+                                    const std::string_view in_event_id)
 {
-    kaitai::kstream ks(std::string{indata});
-    bnk_t bnk(&ks);
-
-    auto* hirc_data = FindSection<bnk_t::hirc_data_t>(bnk, "HIRC");
-    if (!hirc_data)
+    const auto bank = Parse(indata);
+    EventReport report;
+    if (!bank.HasHirc())
     {
-        return {};
+        return report;
     }
-
-    auto* stid_data = FindSection<bnk_t::stid_data_t>(bnk, "STID");
+    report.has_hirc = true;
 
     const bool all_event_ids = in_event_id.empty();
-    std::size_t num_events = 0;
 
-    // Pass 1: Map each event to its event-action objects
-    std::map<std::uint32_t, std::vector<bnk_t::event_action_t*>> event_to_event_actions;
+    // Events are reported in ID order, with the WEMs of repeated IDs merged
+    std::map<std::uint32_t, std::vector<EventWem>> event_wems;
 
-    for (const auto& obj : *hirc_data->objs())
+    std::vector<ResolvedWem> wems;
+    for (const auto& obj : bank.Objects())
     {
-        if (obj->type() != bnk_t::OBJECT_TYPE_EVENT)
+        if (obj.type != ObjectType::Event)
         {
             continue;
         }
 
-        ++num_events;
-        auto* event = dynamic_cast<bnk_t::event_t*>(obj->object_data());
-        const auto obj_id_str = std::to_string(obj->id());
+        ++report.event_count;
+        const auto* event = std::get_if<EventRecord>(&obj.data);
 
         // Check if we should process this event
-        if (!all_event_ids && obj_id_str != in_event_id)
+        if (event == nullptr || (!all_event_ids && std::to_string(obj.id) != in_event_id))
         {
             continue;
         }
 
-        // Find matching event actions
-        for (const auto& event_action_id : *event->event_actions())
+        for (std::size_t i = 0; i < event->action_count; ++i)
         {
-            for (const auto& action_obj : *hirc_data->objs())
+            const auto index = bank.Find(bank.EventActionId(*event, i));
+            if (!index)
+            {
+                continue;
+            }
+            const auto* event_action = std::get_if<EventActionRecord>(&bank.Objects()[*index].data);
+            if (event_action == nullptr || event_action->target_id == 0)
+            {
+                continue;
+            }
+
+            wems.clear();
+            bank.ResolveTarget(event_action->target_id, wems);
+            for (const auto& wem : wems)
             {
-                if (action_obj->type() != bnk_t::OBJECT_TYPE_EVENT_ACTION)
-                {
-                    continue;
-                }
-
-                auto* event_action =
-                    dynamic_cast<bnk_t::event_action_t*>(action_obj->object_data());
-                if (action_obj->id() == event_action_id && event_action->game_object_id() != 0)
-                {
-                    event_to_event_actions[obj->id()].push_back(event_action);
-                }
+                event_wems[obj.id].push_back(
+                    {.action_type = static_cast<std::uint8_t>(event_action->type),
+                     .wem_id = wem.wem_id,
+                     .child = wem.depth > 0});
             }
         }
     }
 
-    // Pass 2: Match SFX objects to events via event-action game_object_id or parent container
-    std::map<std::uint32_t, std::vector<EventSFX>> event_to_event_sfxs;
+    std::unordered_map<std::uint32_t, std::string_view> names;
+    for (const auto& name : bank.Names())
+    {
+        names.try_emplace(name.id, name.name);
+    }
 
-    for (const auto& obj : *hirc_data->objs())
+    report.events.reserve(event_wems.size());
+    for (auto& [event_id, wems_of_event] : event_wems)
     {
-        if (obj->type() != bnk_t::OBJECT_TYPE_SOUND_EFFECT_OR_VOICE)
-        {
-            continue;
-        }
+        const auto name = names.find(event_id);
+        report.events.push_back(
+            {.id = event_id,
+             .name = name != names.end() ? std::string{name->second} : std::string{},
+             .wems = std::move(wems_of_event)});
+    }
 
-        auto* sfx = dynamic_cast<bnk_t::sound_effect_or_voice_t*>(obj->object_data());
-        const auto parent_id = GetParentId(sfx);
+    return report;
+}
 
-        for (const auto& [event_id, event_actions] : event_to_event_actions)
+[[nodiscard]] std::string GetEventIdInfo(const std::string_view indata,
+                                         const std::string_view in_event_id)
+{
+    std::ostringstream result;
+    WriteEvents(GetEvents(indata, in_event_id), result);
+    return std::move(result).str();
+}
+
+void WriteBankInfo(const BankInfo& info, std::ostream& os)
+{
+    // Get bank header info
+    if (info.has_header)
+    {
+        os << std::format("Version: {}\n", info.version);
+        os << std::format("Soundbank ID: {}\n", info.id);
+    }
+
+    // Get data index info
+    if (info.has_data_index)
+    {
+        os << std::format("{} embedded WEM files:\n", info.wem_ids.size());
+        for (const auto id : info.wem_ids)
         {
-            for (const auto* event_action : event_actions)
-            {
-                const auto game_obj_id = event_action->game_object_id();
-                if (game_obj_id != obj->id() && game_obj_id != parent_id)
-                {
-                    continue;
-                }
-
-                event_to_event_sfxs[event_id].push_back({.m_action_type = event_action->type(),
-                                                         .m_sfx = sfx,
-                                                         .m_is_child = (game_obj_id == parent_id)});
-            }
+            os << std::format("\t{}\n", id);
         }
     }
+}
+
+void WriteBankInfoJson(const BankInfo& info, std::ostream& os)
+{
+    json::Writer json(os);
+    json.BeginObject();
+    if (info.has_header)
+    {
+        json.Member("version", info.version).Member("id", info.id);
+    }
+    json.Key("wem_ids").BeginArray();
+    for (const auto id : info.wem_ids)
+    {
+        json.Number(id);
+    }
+    json.EndArray().EndObject();
+    os << '\n';
+}
+
+void WriteEvents(const EventReport& report, std::ostream& os)
+{
+    if (!report.has_hirc)
+    {
+        return;
+    }
 
-    // Pass 3: Format the output
-    std::string result;
-    result += std::format("Found {} event(s)\n", num_events);
-    result += std::format("{} of them point to files in this BNK\n\n", event_to_event_sfxs.size());
+    os << std::format("Found {} event(s)\n", report.event_count);
+    os << std::format("{} of them point to files in this BNK\n\n", report.events.size());
 
-    for (const auto& [event_id, event_sfxs] : event_to_event_sfxs)
+    for (const auto& event : report.events)
     {
-        const auto event_name = LookupEventName(stid_data, event_id);
-        result +=
-            std::format("{} ({})\n", event_id, event_name.empty() ? "can't find name" : event_name);
+        os << std::format("{} ({})\n", event.id,
+                          event.name.empty() ? "can't find name" : event.name);
 
-        for (const auto& event_sfx : event_sfxs)
+        for (const auto& wem : event.wems)
         {
-            result += std::format("\t{} {}{}\n", GetEventActionType(event_sfx.m_action_type),
-                                  event_sfx.m_sfx->audio_file_id(),
-                                  event_sfx.m_is_child ? " (child)" : "");
+            os << std::format("\t{} {}{}\n", GetEventActionType(ActionType{wem.action_type}),
+                              wem.wem_id, wem.child ? " (child)" : "");
         }
-        result += '\n';
+        os << '\n';
     }
+}
 
-    return result;
+void WriteEventsJson(const EventReport& report, std::ostream& os)
+{
+    json::Writer json(os);
+    json.BeginObject().Member("event_count", report.event_count);
+    json.Key("events").BeginArray();
+    for (const auto& event : report.events)
+    {
+        json.BeginObject().Member("id", event.id).Member("name", event.name);
+        json.Key("wems").BeginArray();
+        for (const auto& wem : event.wems)
+        {
+            json.BeginObject()
+                .Member("action", GetEventActionType(ActionType{wem.action_type}))
+                .Member("action_type", wem.action_type)
+                .Member("wem_id", wem.wem_id)
+                .Member("child", wem.child)
+                .EndObject();
+        }
+        json.EndArray().EndObject();
+    }
+    json.EndArray().EndObject();
+    os << '\n';
 }
 
 [[nodiscard]] std::string GetEventNameFromId([[maybe_unused]] const std::uint32_t event_id)
@@ -315,57 +318,56 @@ void Extract(const std::string_view indata, std::vector<std::string>& outdata)
 
 [[nodiscard]] std::vector<std::uint32_t> GetWemIds(const std::string_view indata)
 {
-    kaitai::kstream ks(std::string{indata});
-    bnk_t bnk(&ks);
+    const auto bank = Parse(indata);
 
     std::vector<std::uint32_t> ids;
-
-    auto* didx = FindSection<bnk_t::didx_data_t>(bnk, "DIDX");
-    if (!didx)
-    {
-        return ids;
-    }
-
-    ids.reserve(didx->objs()->size());
-    for (const auto& obj : *didx->objs())
+    ids.reserve(bank.DataIndex().size());
+    for (const auto& entry : bank.DataIndex())
     {
-        ids.push_back(obj->id());
+        ids.push_back(entry.id);
     }
 
     return ids;
 }
 
-// Scans HIRC SFX objects for those marked as streamed (included_or_streamed != 0).
-// Streamed WEMs only have a small prefetch stub embedded in the BNK; the full audio
-// lives in a separate .wem file that the caller must locate and read.
-[[nodiscard]] std::vector<std::uint32_t> GetStreamedWemIds(const std::string_view indata)
+[[nodiscard]] std::vector<DataIndexEntry> GetDataIndex(const std::string_view indata)
 {
-    kaitai::kstream ks(std::string{indata});
-    bnk_t bnk(&ks);
+    const auto data = std::as_bytes(std::span(indata));
 
-    std::vector<std::uint32_t> ids;
-
-    auto* hirc_data = FindSection<bnk_t::hirc_data_t>(bnk, "HIRC");
-    if (!hirc_data)
+    const auto didx = FindSectionSpan(data, "DIDX");
+    const auto data_section = FindSectionSpan(data, "DATA");
+    if (!didx.present || !data_section.present)
     {
-        return ids;
+        return {};
     }
 
-    for (const auto& obj : *hirc_data->objs())
+    constexpr std::size_t entry_size = 12;
+    std::vector<DataIndexEntry> entries;
+    entries.reserve(didx.size / entry_size);
+
+    for (std::size_t pos = didx.offset; pos + entry_size <= didx.offset + didx.size;
+         pos += entry_size)
     {
-        if (obj->type() != bnk_t::OBJECT_TYPE_SOUND_EFFECT_OR_VOICE)
-        {
-            continue;
-        }
+        const auto id = wem::Load<std::uint32_t, std::endian::little>(data, pos);
+        const auto offset = wem::Load<std::uint32_t, std::endian::little>(data, pos + 4);
+        const auto size = wem::Load<std::uint32_t, std::endian::little>(data, pos + 8);
 
-        auto* sfx = dynamic_cast<bnk_t::sound_effect_or_voice_t*>(obj->object_data());
-        if (sfx->included_or_streamed() != 0)
+        if (static_cast<std::uint64_t>(offset) + size > data_section.size)
         {
-            ids.push_back(sfx->audio_file_id());
+            throw std::runtime_error(std::format("DIDX entry {} lies outside DATA", id));
         }
+        entries.push_back({.id = id, .offset = data_section.offset + offset, .size = size});
     }
 
-    return ids;
+    return entries;
+}
+
+// Scans HIRC sounds and music track sources for those marked as streamed.
+// Streamed WEMs only have a small prefetch stub embedded in the BNK; the full audio
+// lives in a separate .wem file that the caller must locate and read.
+[[nodiscard]] std::vector<std::uint32_t> GetStreamedWemIds(const std::string_view indata)
+{
+    return Parse(indata).StreamedWemIds();
 }
 
 } // namespace wwtools::bnk
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <ostream>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -8,17 +10,72 @@
 namespace wwtools::bnk
 {
 
+// Location of one embedded WEM (full file or prefetch stub) within a BNK file.
+struct DataIndexEntry
+{
+    std::uint32_t id;
+    std::uint64_t offset; // absolute offset in the BNK file
+    std::uint32_t size;
+};
+
+// Header and data index summary of a BNK, see GetBankInfo.
+struct BankInfo
+{
+    bool has_header = false;
+    bool has_data_index = false;
+    std::uint32_t version = 0;
+    std::uint32_t id = 0;
+    std::vector<std::uint32_t> wem_ids; // embedded WEMs in DIDX order
+};
+
+// A WEM an event action ends up playing.
+struct EventWem
+{
+    std::uint8_t action_type; // 1 = stop, 2 = pause, 3 = resume, 4 = play, others as stored
+    std::uint32_t wem_id;
+    bool child; // reached through a container rather than being the action's target itself
+};
+
+struct EventInfo
+{
+    std::uint32_t id;
+    std::string name; // from STID; empty when the bank does not name the event
+    std::vector<EventWem> wems;
+};
+
+// Events of a BNK and the WEMs they play, see GetEvents.
+struct EventReport
+{
+    bool has_hirc = false;
+    std::size_t event_count = 0;   // events in the bank
+    std::vector<EventInfo> events; // the requested events that reach a WEM, ordered by ID
+};
+
 // Extracts embedded WEM payloads from a BNK and appends them to outdata.
 // Does not clear outdata first; when DATA is missing, this returns without adding entries.
 void Extract(std::string_view indata, std::vector<std::string>& outdata);
 
+// Reads the header and data index summary.
+[[nodiscard]] BankInfo GetBankInfo(std::string_view indata);
+
 // Returns a human-readable BNK summary (header/data index details).
 [[nodiscard]] std::string GetInfo(std::string_view indata);
 
+// Resolves one event ID, or all events when the ID is empty, to the WEMs they play.  The report
+// is empty when the HIRC section is missing.
+[[nodiscard]] EventReport GetEvents(std::string_view indata, std::string_view in_event_id);
+
 // Returns event-to-WEM mapping info for one event ID or all events when ID is empty.
 // Returns an empty string when the HIRC section is missing.
 [[nodiscard]] std::string GetEventIdInfo(std::string_view indata, std::string_view in_event_id);
 
+// Write the reports straight to `os`, either in the format of GetInfo / GetEventIdInfo (nothing
+// for events of a bank without HIRC) or as one JSON object followed by a newline.
+void WriteBankInfo(const BankInfo& info, std::ostream& os);
+void WriteBankInfoJson(const BankInfo& info, std::ostream& os);
+void WriteEvents(const EventReport& report, std::ostream& os);
+void WriteEventsJson(const EventReport& report, std::ostream& os);
+
 // Compatibility stub kept for older callers; currently always returns empty string.
 // Use GetEventIdInfo(...) for event-name lookup based on BNK STID data.
 [[nodiscard]] std::string GetEventNameFromId(std::uint32_t event_id);
@@ -26,6 +83,11 @@ void Extract(std::string_view indata, std::vector<std::string>& outdata);
 // Returns all WEM IDs referenced by the BNK DIDX section (empty when DIDX is missing).
 [[nodiscard]] std::vector<std::uint32_t> GetWemIds(std::string_view indata);
 
+// Returns the DIDX entries with absolute file offsets by walking the section headers directly,
+// without a full parse or any copies (empty when DIDX or DATA is missing).  Throws
+// std::runtime_error when an entry lies outside the DATA section.
+[[nodiscard]] std::vector<DataIndexEntry> GetDataIndex(std::string_view indata);
+
 // Returns WEM IDs marked as streamed in HIRC object metadata (empty when HIRC is missing).
 [[nodiscard]] std::vector<std::uint32_t> GetStreamedWemIds(std::string_view indata);
 
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <lz4.h>
+#include <zlib.h>
+
+#include "bundle.h"
+#include "wem/byte_reader.h"
+
+namespace
+{
+
+constexpr std::string_view g_magic = "POTATO70";
+constexpr std::size_t g_header_size = 32;
+constexpr std::size_t g_entry_size = 0x140;
+constexpr std::size_t g_name_size = 0x100;
+
+// Offsets of the fields used from an embedded_file record.
+constexpr std::size_t g_size_field = 0x114;
+constexpr std::size_t g_compressed_size_field = 0x118;
+constexpr std::size_t g_offset_field = 0x11C;
+constexpr std::size_t g_compression_field = 0x13C;
+
+[[nodiscard]] std::uint32_t ReadU32(const std::span<const std::byte> data, const std::size_t offset)
+{
+    return wwtools::wem::Load<std::uint32_t, std::endian::little>(data, offset);
+}
+
+void InflateZlib(const std::span<const std::byte> in, std::string& out)
+{
+    auto out_size = static_cast<uLongf>(out.size());
+    // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+    const int result =
+        uncompress(reinterpret_cast<Bytef*>(out.data()), &out_size,
+                   reinterpret_cast<const Bytef*>(in.data()), static_cast<uLong>(in.size()));
+    // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (result != Z_OK || out_size != out.size())
+    {
+        throw std::runtime_error(std::format("zlib decompression failed ({})", result));
+    }
+}
+
+void DecompressLz4(const std::span<const std::byte> in, std::string& out)
+{
+    // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+    const int result = LZ4_decompress_safe(reinterpret_cast<const char*>(in.data()), out.data(),
+                                           static_cast<int>(in.size()),
+                                           static_cast<int>(out.size()));
+    // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (result < 0 || static_cast<std::size_t>(result) != out.size())
+    {
+        throw std::runtime_error(std::format("lz4 decompression failed ({})", result));
+    }
+}
+
+} // anonymous namespace
+
+namespace wwtools::bundle
+{
+
+Bundle::Bundle(const std::filesystem::path& path) : m_file(path)
+{
+    const auto data = m_file.Bytes();
+    if (data.size() < g_header_size ||
+        std::memcmp(data.data(), g_magic.data(), g_magic.size()) != 0)
+    {
+        throw std::runtime_error(std::format("{} is not a bundle", path.string()));
+    }
+
+    const std::size_t data_offset = ReadU32(data, 16);
+    if (data_offset > data.size())
+    {
+        throw std::runtime_error("bundle file table out of bounds");
+    }
+
+    m_entries.reserve((data_offset - std::min(data_offset, g_header_size)) / g_entry_size);
+    for (std::size_t base = g_header_size; base + g_entry_size <= data_offset;
+         base += g_entry_size)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        std::string_view name(reinterpret_cast<const char*>(data.data() + base), g_name_size);
+        name = name.substr(0, name.find('\0'));
+
+        const Entry entry{.name = name,
+                          .size = ReadU32(data, base + g_size_field),
+                          .compressed_size = ReadU32(data, base + g_compressed_size_field),
+                          .offset = ReadU32(data, base + g_offset_field),
+                          .compression =
+                              static_cast<Compression>(ReadU32(data, base + g_compression_field))};
+
+        if (entry.offset > data.size() || entry.compressed_size > data.size() - entry.offset)
+        {
+            throw std::runtime_error(std::format("bundle entry {} out of bounds", name));
+        }
+        m_entries.push_back(entry);
+    }
+}
+
+[[nodiscard]] std::string_view Bundle::Load(const Entry& entry, std::string& scratch) const
+{
+    const auto raw = Raw(entry);
+
+    // Some tools store small files uncompressed regardless of the declared type
+    if (entry.compression == Compression::None || entry.compressed_size == entry.size)
+    {
+        return m_file.View().substr(entry.offset, entry.compressed_size);
+    }
+
+    scratch.resize(entry.size);
+    switch (entry.compression)
+    {
+    case Compression::Zlib:
+        InflateZlib(raw, scratch);
+        break;
+    case Compression::Lz4:
+    case Compression::Lz4Hc:
+        if (raw.size() > static_cast<std::size_t>(std::numeric_limits<int>::max()))
+        {
+            throw std::runtime_error("lz4 block too large");
+        }
+        DecompressLz4(raw, scratch);
+        break;
+    default:
+        throw std::runtime_error(std::format("unsupported bundle compression {}",
+                                             static_cast<std::uint32_t>(entry.compression)));
+    }
+    return scratch;
+}
+
+} // namespace wwtools::bundle
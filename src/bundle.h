@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mapped_file.h"
+
+// Reader for REDengine bundles ("POTATO70" .bundle archives, see ksy/bundle.ksy).
+//
+// Layout (little-endian): "POTATO70", u4 bundle_size, u4 dummy_size, u4 data_offset, 12 bytes of
+// padding, then 320-byte embedded_file records up to data_offset: a NUL-padded 256-byte name,
+// a 16-byte hash, u4 zero, u4 size, u4 compressed_size, u4 offset, u8 timestamp, 16 zero bytes,
+// u4 dummy and u4 compression type.
+namespace wwtools::bundle
+{
+
+enum class Compression : std::uint32_t
+{
+    None = 0,
+    Zlib = 1,
+    Snappy = 2,
+    Doboz = 3,
+    Lz4 = 4,
+    Lz4Hc = 5,
+};
+
+struct Entry
+{
+    std::string_view name; // points into the mapped file table
+    std::uint32_t size;    // decompressed size
+    std::uint32_t compressed_size;
+    std::uint32_t offset;
+    Compression compression;
+};
+
+// Memory-maps a bundle and indexes its file table; payloads are only read and decompressed when
+// requested, so entries can be loaded concurrently from several threads.
+class Bundle
+{
+    MappedFile m_file;
+    std::vector<Entry> m_entries;
+
+public:
+    // Throws std::system_error if the file cannot be mapped and std::runtime_error if it is not a
+    // well-formed bundle.
+    explicit Bundle(const std::filesystem::path& path);
+
+    [[nodiscard]] std::span<const Entry> Entries() const
+    {
+        return m_entries;
+    }
+
+    // The stored (possibly compressed) bytes of an entry.
+    [[nodiscard]] std::span<const std::byte> Raw(const Entry& entry) const
+    {
+        return m_file.Bytes().subspan(entry.offset, entry.compressed_size);
+    }
+
+    // Returns an entry's decompressed payload: a view of the mapping for stored entries,
+    // otherwise a view of `scratch`, which receives the decompressed bytes.  Throws
+    // std::runtime_error for corrupt data or unsupported compression (Snappy, Doboz).
+    [[nodiscard]] std::string_view Load(const Entry& entry, std::string& scratch) const;
+};
+
+} // namespace wwtools::bundle
@@ -0,0 +1,65 @@
+#include "cpu_features.h"
+
+#if defined(WWTOOLS_ARCH_X86) && defined(_MSC_VER)
+#include <array>
+
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace
+{
+
+#if defined(WWTOOLS_ARCH_X86) && defined(_MSC_VER)
+
+// AVX2 needs the CPUID bit plus OS support for saving YMM state (OSXSAVE + XCR0 bits 1..2).
+[[nodiscard]] bool DetectAvx2()
+{
+    std::array<int, 4> regs{};
+    __cpuid(regs.data(), 0);
+    if (regs[0] < 7)
+    {
+        return false;
+    }
+
+    __cpuid(regs.data(), 1);
+    const bool osxsave = (regs[2] & (1 << 27)) != 0;
+    const bool avx = (regs[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+
+    __cpuidex(regs.data(), 7, 0);
+    return (regs[1] & (1 << 5)) != 0;
+}
+
+#elif defined(WWTOOLS_ARCH_X86)
+
+[[nodiscard]] bool DetectAvx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+}
+
+#else
+
+[[nodiscard]] bool DetectAvx2()
+{
+    return false;
+}
+
+#endif
+
+} // anonymous namespace
+
+namespace wwtools::cpu
+{
+
+[[nodiscard]] bool HasAvx2()
+{
+    static const bool g_has_avx2 = DetectAvx2();
+    return g_has_avx2;
+}
+
+} // namespace wwtools::cpu
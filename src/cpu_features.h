@@ -0,0 +1,26 @@
+#pragma once
+
+// Runtime CPU feature detection for the SIMD kernels.
+//
+// WWTOOLS_ARCH_X86 is defined on x86/x86-64 targets, where SSE2 is part of the baseline ABI.
+// AVX2 kernels are compiled per-function with WWTOOLS_TARGET_AVX2 (MSVC needs no attribute) and
+// are only called after HasAvx2() confirms support, so the rest of the library keeps building
+// for the baseline instruction set.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define WWTOOLS_ARCH_X86 1
+#endif
+
+#if defined(WWTOOLS_ARCH_X86) && (defined(__GNUC__) || defined(__clang__))
+#define WWTOOLS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define WWTOOLS_TARGET_AVX2
+#endif
+
+namespace wwtools::cpu
+{
+
+// True when the CPU and OS both support AVX2 (checked once, then cached).
+[[nodiscard]] bool HasAvx2();
+
+} // namespace wwtools::cpu
@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "file_sink.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+// Largest write buffer; outputs announced smaller through Reserve get a buffer of their size, so
+// writing many small files does not allocate a megabyte each
+constexpr std::size_t g_max_buffer_size = std::size_t{1} << 20;
+constexpr std::size_t g_min_buffer_size = std::size_t{64} << 10;
+
+} // anonymous namespace
+
+namespace wwtools
+{
+
+#if defined(_WIN32)
+
+FileSink::FileSink(const std::filesystem::path& path) : m_path(path)
+{
+    m_handle = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                           FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_handle == INVALID_HANDLE_VALUE)
+    {
+        m_handle = nullptr;
+        throw std::system_error(static_cast<int>(GetLastError()), std::system_category(),
+                                "failed to create " + path.string());
+    }
+}
+
+void FileSink::WriteAt(std::span<const std::byte> bytes, std::uint64_t offset)
+{
+    while (!bytes.empty())
+    {
+        const auto chunk = static_cast<DWORD>(std::min<std::size_t>(bytes.size(), 1U << 30));
+        OVERLAPPED position{};
+        position.Offset = static_cast<DWORD>(offset);
+        position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD written = 0;
+        const bool ok = WriteFile(m_handle, bytes.data(), chunk, &written, &position) != 0;
+        if (!ok || written == 0)
+        {
+            // A write that succeeds without writing anything would otherwise be retried forever
+            const DWORD error = ok ? ERROR_WRITE_FAULT : GetLastError();
+            throw std::system_error(static_cast<int>(error), std::system_category(),
+                                    "failed to write " + m_path.string());
+        }
+        bytes = bytes.subspan(written);
+        offset += written;
+    }
+}
+
+void FileSink::Reserve(const std::size_t size)
+{
+    m_reserved = size;
+
+    // Only a hint: allocation beyond the end of the file does not change its size
+    FILE_ALLOCATION_INFO allocation{};
+    allocation.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+    SetFileInformationByHandle(m_handle, FileAllocationInfo, &allocation, sizeof(allocation));
+}
+
+// Large pieces already bypass the buffer in Write, which is as far as WriteFile goes
+void FileSink::WriteGather(const std::span<const std::span<const std::byte>> pieces)
+{
+    OutputSink::WriteGather(pieces);
+}
+
+void FileSink::Release() noexcept
+{
+    if (m_handle != nullptr)
+    {
+        ::CloseHandle(m_handle);
+        m_handle = nullptr;
+    }
+}
+
+void FileSink::Close()
+{
+    Flush();
+    const auto handle = std::exchange(m_handle, nullptr);
+    if (handle != nullptr && ::CloseHandle(handle) == 0)
+    {
+        throw std::system_error(static_cast<int>(GetLastError()), std::system_category(),
+                                "failed to close " + m_path.string());
+    }
+}
+
+#else
+
+FileSink::FileSink(const std::filesystem::path& path) : m_path(path)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+    m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (m_fd < 0)
+    {
+        throw std::system_error(errno, std::generic_category(),
+                                "failed to create " + path.string());
+    }
+}
+
+void FileSink::WriteAt(std::span<const std::byte> bytes, std::uint64_t offset)
+{
+    while (!bytes.empty())
+    {
+        const auto written =
+            ::pwrite(m_fd, bytes.data(), bytes.size(), static_cast<off_t>(offset));
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            throw std::system_error(written < 0 ? errno : EIO, std::generic_category(),
+                                    "failed to write " + m_path.string());
+        }
+        bytes = bytes.subspan(static_cast<std::size_t>(written));
+        offset += static_cast<std::uint64_t>(written);
+    }
+}
+
+void FileSink::Reserve(const std::size_t size)
+{
+    m_reserved = size;
+
+#if defined(__linux__)
+    // Only a hint: keeping the size means an overestimate needs no truncation afterwards, and
+    // filesystems without fallocate just grow the file as it is written
+    if (size != 0)
+    {
+        ::fallocate(m_fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size));
+    }
+#endif
+}
+
+// Writes the buffered bytes and the pieces together in as few pwritev calls as the platform's
+// iovec limit allows, instead of copying large pieces through the buffer.
+void FileSink::WriteGather(const std::span<const std::span<const std::byte>> pieces)
+{
+    std::size_t total = 0;
+    for (const auto piece : pieces)
+    {
+        total += piece.size();
+    }
+    if (total < g_max_buffer_size)
+    {
+        OutputSink::WriteGather(pieces);
+        return;
+    }
+
+    std::vector<iovec> vectors;
+    vectors.reserve(pieces.size() + 1);
+    const auto add = [&](const std::span<const std::byte> bytes) {
+        if (!bytes.empty())
+        {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+            vectors.push_back({const_cast<std::byte*>(bytes.data()), bytes.size()});
+        }
+    };
+    add(std::span(m_buffer.get(), m_buffered));
+    for (const auto piece : pieces)
+    {
+        add(piece);
+    }
+
+    std::span<iovec> pending(vectors);
+    auto offset = m_offset;
+    while (!pending.empty())
+    {
+        const auto count = static_cast<int>(std::min<std::size_t>(pending.size(), IOV_MAX));
+        const auto written = ::pwritev(m_fd, pending.data(), count, static_cast<off_t>(offset));
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            throw std::system_error(written < 0 ? errno : EIO, std::generic_category(),
+                                    "failed to write " + m_path.string());
+        }
+        offset += static_cast<std::uint64_t>(written);
+
+        // Drop what went out, then resume inside a partly written piece
+        auto remaining = static_cast<std::size_t>(written);
+        while (!pending.empty() && remaining >= pending.front().iov_len)
+        {
+            remaining -= pending.front().iov_len;
+            pending = pending.subspan(1);
+        }
+        if (remaining != 0)
+        {
+            auto& partial = pending.front();
+            partial.iov_base = static_cast<std::byte*>(partial.iov_base) + remaining;
+            partial.iov_len -= remaining;
+        }
+    }
+    m_offset = offset;
+    m_buffered = 0;
+}
+
+void FileSink::Release() noexcept
+{
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+void FileSink::Close()
+{
+    Flush();
+    const int fd = std::exchange(m_fd, -1);
+    if (fd >= 0 && ::close(fd) != 0)
+    {
+        throw std::system_error(errno, std::generic_category(),
+                                "failed to close " + m_path.string());
+    }
+}
+
+#endif
+
+FileSink::~FileSink()
+{
+    Release();
+}
+
+void FileSink::Flush()
+{
+    if (m_buffered != 0)
+    {
+        WriteAt({m_buffer.get(), m_buffered}, m_offset);
+        m_offset += m_buffered;
+        m_buffered = 0;
+    }
+}
+
+void FileSink::Write(const std::span<const std::byte> bytes)
+{
+    if (m_buffer == nullptr)
+    {
+        m_capacity = static_cast<std::size_t>(std::clamp<std::uint64_t>(
+            m_reserved, g_min_buffer_size, g_max_buffer_size));
+    }
+    if (m_buffered + bytes.size() > m_capacity)
+    {
+        Flush();
+    }
+
+    // Anything the size of the buffer goes out directly from the caller's memory
+    if (bytes.size() >= m_capacity)
+    {
+        WriteAt(bytes, m_offset);
+        m_offset += bytes.size();
+        return;
+    }
+
+    if (m_buffer == nullptr)
+    {
+        m_buffer = std::make_unique_for_overwrite<std::byte[]>(m_capacity);
+    }
+    std::copy(bytes.begin(), bytes.end(), m_buffer.get() + m_buffered);
+    m_buffered += bytes.size();
+}
+
+} // namespace wwtools
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+#include "output_sink.h"
+
+namespace wwtools
+{
+
+// Writes the output straight to a file descriptor through one large buffer, without the stream
+// and locale layers of an ofstream.  Small writes (such as OGG page headers and bodies) are
+// gathered in the buffer and go out as positional writes; pieces larger than the buffer are
+// written directly from the caller's memory.  Reserve preallocates the announced size so the file
+// is laid out once instead of growing write by write.
+class FileSink final : public OutputSink
+{
+    std::unique_ptr<std::byte[]> m_buffer; // allocated on the first write, sized by Reserve
+    std::size_t m_capacity = 0;
+    std::size_t m_buffered = 0;
+    std::uint64_t m_offset = 0; // file position of m_buffer[0]
+    std::uint64_t m_reserved = 0;
+    std::filesystem::path m_path; // for error messages
+#if defined(_WIN32)
+    void* m_handle = nullptr;
+#else
+    int m_fd = -1;
+#endif
+
+    void Flush();
+    void WriteAt(std::span<const std::byte> bytes, std::uint64_t offset);
+    void Release() noexcept;
+
+public:
+    // Creates or truncates `path`.  Throws std::system_error when it cannot be opened.
+    explicit FileSink(const std::filesystem::path& path);
+
+    // Closes the file without reporting errors; call Close to know the output made it.
+    ~FileSink() override;
+
+    void Reserve(std::size_t size) override;
+    void Write(std::span<const std::byte> bytes) override;
+    void WriteGather(std::span<const std::span<const std::byte>> pieces) override;
+
+    // Writes out what is buffered and closes the file.  Throws std::system_error when a write or
+    // the close fails.
+    void Close();
+};
+
+} // namespace wwtools
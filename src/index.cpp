@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "bnk.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include "scan.h"
+#include "wem/probe.h"
+#include "wwtools/wwtools.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// Enough for the RIFF header plus fmt/vorb/smpl of practically every WEM; files whose fmt chunk
+// lies further in are mapped and probed in full.
+constexpr std::size_t g_probe_prefix_size = 4096;
+
+constexpr std::array<char, 4> g_index_magic = {'W', 'W', 'I', 'X'};
+constexpr std::uint32_t g_index_version = 1;
+
+// One table row before it is scattered into the columns.
+struct Row
+{
+    std::uint32_t id = 0;
+    std::uint64_t offset = 0;
+    std::uint64_t size = 0;
+    bool streamed = false;
+    wwtools::WemMetadata meta{};
+};
+
+// Reads up to `limit` bytes from the start of the file.
+[[nodiscard]] std::string ReadPrefix(const fs::path& path, const std::size_t limit)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error(std::format("failed to open {}", path.string()));
+    }
+
+    const auto file_size = static_cast<std::size_t>(fs::file_size(path));
+    std::string data(std::min(limit, file_size), '\0');
+    file.read(data.data(), static_cast<std::streamsize>(data.size()));
+    data.resize(static_cast<std::size_t>(file.gcount()));
+    return data;
+}
+
+// Probes a span, leaving the metadata zeroed when it is not a readable WEM.
+[[nodiscard]] wwtools::WemMetadata TryProbe(const std::string_view data)
+{
+    try
+    {
+        return wwtools::wem::Probe(std::as_bytes(std::span(data)));
+    }
+    catch (const std::exception&)
+    {
+        return {};
+    }
+}
+
+// Loose WEMs are named after their ID; anything else gets ID 0.
+[[nodiscard]] std::uint32_t IdFromStem(const fs::path& path)
+{
+    const auto stem = path.stem().string();
+    std::uint32_t id = 0;
+    const auto [end, ec] = std::from_chars(stem.data(), stem.data() + stem.size(), id);
+    return (ec == std::errc{} && end == stem.data() + stem.size()) ? id : 0;
+}
+
+// Throws when the file is not a readable WEM.
+[[nodiscard]] std::vector<Row> IndexWem(const fs::path& path)
+{
+    const auto file_size = fs::file_size(path);
+
+    const auto prefix = ReadPrefix(path, g_probe_prefix_size);
+    wwtools::WemMetadata meta{};
+    try
+    {
+        meta = wwtools::wem::Probe(std::as_bytes(std::span(prefix)));
+    }
+    catch (const std::exception&)
+    {
+        if (prefix.size() == file_size)
+        {
+            throw;
+        }
+        const wwtools::MappedFile file(path);
+        meta = wwtools::wem::Probe(file.Bytes());
+    }
+
+    return {Row{.id = IdFromStem(path), .offset = 0, .size = file_size, .meta = meta}};
+}
+
+// Embedded and prefetch entries come from DIDX; streamed-only sounds (no data in the bank) only
+// appear in HIRC and get a row without metadata.
+[[nodiscard]] std::vector<Row> IndexBnk(const fs::path& path)
+{
+    // Only the DIDX/HIRC sections and the probed prefix of each entry are paged in
+    const wwtools::MappedFile file(path);
+    const auto data = file.View();
+
+    std::vector<std::uint32_t> streamed_ids;
+    try
+    {
+        streamed_ids = wwtools::bnk::GetStreamedWemIds(data);
+    }
+    catch (const std::exception&)
+    {
+        // HIRC layouts the parser does not know; the DIDX entries are still indexed
+    }
+    std::ranges::sort(streamed_ids);
+    const auto [first, last] = std::ranges::unique(streamed_ids);
+    streamed_ids.erase(first, last);
+
+    std::vector<Row> rows;
+    const auto entries = wwtools::bnk::GetDataIndex(data);
+    rows.reserve(entries.size());
+    for (const auto& entry : entries)
+    {
+        const auto wem = data.substr(entry.offset, entry.size);
+        rows.push_back({.id = entry.id,
+                        .offset = entry.offset,
+                        .size = entry.size,
+                        .streamed = std::ranges::binary_search(streamed_ids, entry.id),
+                        .meta = TryProbe(wem)});
+    }
+
+    for (const auto id : streamed_ids)
+    {
+        if (std::ranges::find(entries, id, &wwtools::bnk::DataIndexEntry::id) == entries.end())
+        {
+            rows.push_back({.id = id, .streamed = true});
+        }
+    }
+
+    return rows;
+}
+
+// Writes a column as little-endian values.
+template <typename T> void WriteColumn(std::ostream& os, const std::span<const T> column)
+{
+    if constexpr (std::endian::native == std::endian::little || sizeof(T) == 1)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        os.write(reinterpret_cast<const char*>(column.data()),
+                 static_cast<std::streamsize>(column.size() * sizeof(T)));
+    }
+    else
+    {
+        for (const T value : column)
+        {
+            const T swapped = std::byteswap(value);
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            os.write(reinterpret_cast<const char*>(&swapped), sizeof(T));
+        }
+    }
+}
+
+template <typename T> void WriteValue(std::ostream& os, const T value)
+{
+    WriteColumn(os, std::span<const T>(&value, 1));
+}
+
+} // anonymous namespace
+
+namespace wwtools
+{
+
+[[nodiscard]] WemIndex IndexDirectory(const fs::path& root, const unsigned int threads)
+{
+    const auto files = scan::FindFiles(root, {".wem", ".bnk"}, threads);
+
+    // Each file is read and probed independently; unreadable files contribute no rows and are
+    // listed as failed instead
+    std::vector<std::vector<Row>> rows(files.size());
+    std::vector<std::string> errors(files.size());
+    parallel::ForEachIndex(
+        files.size(),
+        [&](const std::size_t i) {
+            try
+            {
+                rows[i] = scan::LowerExtension(files[i]) == ".bnk" ? IndexBnk(files[i])
+                                                                   : IndexWem(files[i]);
+            }
+            catch (const std::exception& e)
+            {
+                rows[i].clear();
+                errors[i] = e.what();
+            }
+        },
+        threads);
+
+    WemIndex index;
+    for (std::size_t i = 0; i < files.size(); ++i)
+    {
+        if (!errors[i].empty())
+        {
+            index.failed.push_back(files[i].lexically_relative(root).generic_string());
+            index.errors.push_back(std::move(errors[i]));
+        }
+    }
+
+    std::size_t total = 0;
+    for (const auto& file_rows : rows)
+    {
+        total += file_rows.size();
+    }
+    index.Reserve(total);
+
+    for (std::size_t i = 0; i < files.size(); ++i)
+    {
+        if (rows[i].empty())
+        {
+            continue;
+        }
+
+        const auto source = static_cast<std::uint32_t>(index.sources.size());
+        index.sources.push_back(files[i].lexically_relative(root).generic_string());
+
+        for (const auto& row : rows[i])
+        {
+            index.id.push_back(row.id);
+            index.source.push_back(source);
+            index.offset.push_back(row.offset);
+            index.size.push_back(row.size);
+            index.channels.push_back(row.meta.channels);
+            index.sample_rate.push_back(row.meta.sample_rate);
+            index.sample_count.push_back(row.meta.sample_count);
+            index.loop_start.push_back(row.meta.loop_start);
+            index.loop_end.push_back(row.meta.loop_end);
+            index.streamed.push_back(row.streamed ? 1 : 0);
+            index.codec.push_back(row.meta.codec);
+        }
+    }
+
+    return index;
+}
+
+void WriteIndexCsv(const WemIndex& index, std::ostream& os)
+{
+    os << "id,source,offset,size,channels,sample_rate,samples,loop_start,loop_end,streamed,codec\n";
+    for (std::size_t i = 0; i < index.Rows(); ++i)
+    {
+        os << std::format("{},{},{},{},{},{},{},{},{},{},{}\n", index.id[i],
+                          scan::CsvField(index.sources[index.source[i]]), index.offset[i],
+                          index.size[i], index.channels[i], index.sample_rate[i],
+                          index.sample_count[i], index.loop_start[i], index.loop_end[i],
+                          index.streamed[i], index.codec[i]);
+    }
+}
+
+void WriteIndexBinary(const WemIndex& index, std::ostream& os)
+{
+    os.write(g_index_magic.data(), g_index_magic.size());
+    WriteValue(os, g_index_version);
+    WriteValue(os, static_cast<std::uint64_t>(index.Rows()));
+    WriteValue(os, static_cast<std::uint32_t>(index.sources.size()));
+
+    for (const auto& source : index.sources)
+    {
+        WriteValue(os, static_cast<std::uint32_t>(source.size()));
+        os.write(source.data(), static_cast<std::streamsize>(source.size()));
+    }
+
+    WriteColumn(os, std::span(index.id));
+    WriteColumn(os, std::span(index.source));
+    WriteColumn(os, std::span(index.offset));
+    WriteColumn(os, std::span(index.size));
+    WriteColumn(os, std::span(index.channels));
+    WriteColumn(os, std::span(index.sample_rate));
+    WriteColumn(os, std::span(index.sample_count));
+    WriteColumn(os, std::span(index.loop_start));
+    WriteColumn(os, std::span(index.loop_end));
+    WriteColumn(os, std::span(index.streamed));
+    WriteColumn(os, std::span(index.codec));
+}
+
+} // namespace wwtools
@@ -0,0 +1,135 @@
+#include <array>
+#include <cstddef>
+#include <ostream>
+#include <string_view>
+
+#include "json.h"
+
+namespace wwtools::json
+{
+
+void Writer::Separate()
+{
+    if (m_after_key)
+    {
+        m_after_key = false;
+        return;
+    }
+    if (!m_has_members.empty())
+    {
+        if (m_has_members.back())
+        {
+            m_os.put(',');
+        }
+        m_has_members.back() = true;
+    }
+}
+
+// Escapes quotes, backslashes and control characters; other bytes (UTF-8 included) are copied in
+// runs.
+void Writer::Quoted(const std::string_view text)
+{
+    constexpr std::string_view hex = "0123456789abcdef";
+
+    m_os.put('"');
+    std::size_t run = 0;
+    for (std::size_t i = 0; i < text.size(); ++i)
+    {
+        const auto c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\')
+        {
+            continue;
+        }
+
+        m_os.write(text.data() + run, static_cast<std::streamsize>(i - run));
+        run = i + 1;
+        switch (c)
+        {
+        case '"':
+            m_os.write("\\\"", 2);
+            break;
+        case '\\':
+            m_os.write("\\\\", 2);
+            break;
+        case '\n':
+            m_os.write("\\n", 2);
+            break;
+        case '\r':
+            m_os.write("\\r", 2);
+            break;
+        case '\t':
+            m_os.write("\\t", 2);
+            break;
+        default:
+        {
+            const std::array<char, 6> escape = {'\\', 'u', '0', '0', hex[c >> 4U], hex[c & 0xFU]};
+            m_os.write(escape.data(), escape.size());
+            break;
+        }
+        }
+    }
+    m_os.write(text.data() + run, static_cast<std::streamsize>(text.size() - run));
+    m_os.put('"');
+}
+
+Writer& Writer::BeginObject()
+{
+    Separate();
+    m_os.put('{');
+    m_has_members.push_back(false);
+    return *this;
+}
+
+Writer& Writer::EndObject()
+{
+    m_has_members.pop_back();
+    m_os.put('}');
+    return *this;
+}
+
+Writer& Writer::BeginArray()
+{
+    Separate();
+    m_os.put('[');
+    m_has_members.push_back(false);
+    return *this;
+}
+
+Writer& Writer::EndArray()
+{
+    m_has_members.pop_back();
+    m_os.put(']');
+    return *this;
+}
+
+Writer& Writer::Key(const std::string_view key)
+{
+    Separate();
+    Quoted(key);
+    m_os.put(':');
+    m_after_key = true;
+    return *this;
+}
+
+Writer& Writer::String(const std::string_view value)
+{
+    Separate();
+    Quoted(value);
+    return *this;
+}
+
+Writer& Writer::Bool(const bool value)
+{
+    Separate();
+    if (value)
+    {
+        m_os.write("true", 4);
+    }
+    else
+    {
+        m_os.write("false", 5);
+    }
+    return *this;
+}
+
+} // namespace wwtools::json
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+// Streaming JSON writer: values go straight to the stream as they are written, so large reports
+// never exist as one string.  The writer inserts the separators; the caller only has to keep
+// Begin/End calls balanced and write a key before every value inside an object.
+namespace wwtools::json
+{
+
+class Writer
+{
+    std::ostream& m_os;
+    std::vector<bool> m_has_members; // one entry per open object or array
+    bool m_after_key = false;
+
+    // Writes the comma before a value or key that is not the first of its container.
+    void Separate();
+    void Quoted(std::string_view text);
+
+public:
+    explicit Writer(std::ostream& os) : m_os(os)
+    {
+    }
+
+    Writer& BeginObject();
+    Writer& EndObject();
+    Writer& BeginArray();
+    Writer& EndArray();
+    Writer& Key(std::string_view key);
+    Writer& String(std::string_view value);
+    Writer& Bool(bool value);
+
+    template <std::integral T>
+        requires(!std::same_as<T, bool>)
+    Writer& Number(const T value)
+    {
+        Separate();
+        std::array<char, 24> buffer{};
+        const auto result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+        m_os.write(buffer.data(), result.ptr - buffer.data());
+        return *this;
+    }
+
+    // Key followed by a value, for the common case of scalar members.
+    Writer& Member(const std::string_view key, const std::string_view value)
+    {
+        return Key(key).String(value);
+    }
+
+    // A template so that string literals do not convert to bool
+    template <std::same_as<bool> T> Writer& Member(const std::string_view key, const T value)
+    {
+        return Key(key).Bool(value);
+    }
+
+    template <std::integral T>
+        requires(!std::same_as<T, bool>)
+    Writer& Member(const std::string_view key, const T value)
+    {
+        return Key(key).Number(value);
+    }
+};
+
+} // namespace wwtools::json
@@ -0,0 +1,180 @@
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <xxhash.h>
+
+#include "manifest.h"
+#include "version.h"
+#include "ww2ogg/packed_codebooks.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+constexpr std::string_view g_manifest_header = "# wwtools manifest 2";
+
+// Identifies the codebook library compiled into this build (standard or aoTuV).
+[[nodiscard]] std::uint64_t CodebooksHash()
+{
+    static const std::uint64_t g_hash =
+        XXH3_64bits(ww2ogg::g_packed_codebooks_bin, ww2ogg::g_packed_codebooks_bin_len);
+    return g_hash;
+}
+
+[[nodiscard]] std::vector<std::string_view> SplitTabs(std::string_view line)
+{
+    std::vector<std::string_view> fields;
+    for (auto pos = line.find('\t'); pos != std::string_view::npos; pos = line.find('\t'))
+    {
+        fields.push_back(line.substr(0, pos));
+        line.remove_prefix(pos + 1);
+    }
+    fields.push_back(line);
+    return fields;
+}
+
+template <typename T>
+[[nodiscard]] bool ParseNumber(const std::string_view text, T& value, const int base = 10)
+{
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value, base);
+    return ec == std::errc{} && end == text.data() + text.size();
+}
+
+} // anonymous namespace
+
+namespace wwtools::manifest
+{
+
+[[nodiscard]] std::uint64_t Hash(const std::span<const std::byte> data)
+{
+    return XXH3_64bits(data.data(), data.size());
+}
+
+[[nodiscard]] std::int64_t ModificationTime(const fs::path& path)
+{
+    return static_cast<std::int64_t>(fs::last_write_time(path).time_since_epoch().count());
+}
+
+// Format: a header line, then one tab-separated record per line:
+//   key, hash (hex), size, mtime, tool version, codebooks hash (hex), mode, output
+// Manifests of an older format are ignored, so everything is converted again once.
+Manifest::Manifest(fs::path path) : m_path(std::move(path))
+{
+    std::ifstream file(m_path, std::ios::binary);
+    std::string line;
+    if (!file || !std::getline(file, line) || line != g_manifest_header)
+    {
+        return;
+    }
+
+    while (std::getline(file, line))
+    {
+        const auto fields = SplitTabs(line);
+        if (fields.size() != 8)
+        {
+            continue;
+        }
+
+        Record record;
+        if (!ParseNumber(fields[1], record.hash, 16) || !ParseNumber(fields[2], record.size) ||
+            !ParseNumber(fields[3], record.mtime) || !ParseNumber(fields[5], record.codebooks, 16))
+        {
+            continue;
+        }
+        record.tool_version = fields[4];
+        record.mode = fields[6];
+        record.output = fields[7];
+        m_records.insert_or_assign(std::string{fields[0]}, std::move(record));
+    }
+}
+
+[[nodiscard]] bool Manifest::Unchanged(const Input& input, const std::string_view output,
+                                       const std::string_view mode)
+{
+    const auto it = m_records.find(input.key);
+    if (it == m_records.end())
+    {
+        return false;
+    }
+
+    auto& record = it->second;
+    if (record.tool_version != g_tool_version || record.codebooks != CodebooksHash() ||
+        record.mode != mode || record.output != output || record.size != input.size)
+    {
+        return false;
+    }
+
+    if (record.mtime == input.mtime)
+    {
+        return true;
+    }
+
+    // Touched but possibly identical (e.g. a fresh checkout): fall back to the content hash
+    if (record.hash != Hash(input.data))
+    {
+        return false;
+    }
+    record.mtime = input.mtime;
+    m_dirty = true;
+    return true;
+}
+
+void Manifest::Update(const Input& input, const std::string_view output,
+                      const std::string_view mode)
+{
+    m_records.insert_or_assign(input.key, Record{.hash = Hash(input.data),
+                                                 .size = input.size,
+                                                 .mtime = input.mtime,
+                                                 .tool_version = std::string{g_tool_version},
+                                                 .codebooks = CodebooksHash(),
+                                                 .mode = std::string{mode},
+                                                 .output = std::string{output}});
+    m_dirty = true;
+}
+
+void Manifest::Save()
+{
+    if (!m_dirty)
+    {
+        return;
+    }
+
+    auto temp_path = m_path;
+    temp_path += ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            throw std::runtime_error(std::format("failed to write {}", temp_path.string()));
+        }
+
+        file << g_manifest_header << '\n';
+        for (const auto& [key, record] : m_records)
+        {
+            file << std::format("{}\t{:x}\t{}\t{}\t{}\t{:x}\t{}\t{}\n", key, record.hash,
+                                record.size, record.mtime, record.tool_version, record.codebooks,
+                                record.mode, record.output);
+        }
+
+        if (!file.flush())
+        {
+            throw std::runtime_error(std::format("failed to write {}", temp_path.string()));
+        }
+    }
+
+    fs::rename(temp_path, m_path);
+    m_dirty = false;
+}
+
+} // namespace wwtools::manifest
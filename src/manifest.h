@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Persistent record of converted inputs, used to skip work whose inputs and settings have not
+// changed since the previous run.
+namespace wwtools::manifest
+{
+
+// One conversion input: a loose file, or a WEM inside a bank keyed as "<bank>#<id>".
+struct Input
+{
+    std::string key;
+    std::uint64_t size;
+    std::int64_t mtime;               // of the containing file
+    std::span<const std::byte> data;  // only hashed when size or mtime changed
+};
+
+// What was recorded the last time an input was converted.
+struct Record
+{
+    std::uint64_t hash = 0; // XXH3 of the input bytes
+    std::uint64_t size = 0;
+    std::int64_t mtime = 0;
+    std::string tool_version;
+    std::uint64_t codebooks = 0; // XXH3 of the codebook library the output was built with
+    std::string mode;            // how the output was made from the input (e.g. a full conversion)
+    std::string output;
+};
+
+// XXH3-64 of a byte range.
+[[nodiscard]] std::uint64_t Hash(std::span<const std::byte> data);
+
+// Modification time in the filesystem clock's native ticks (only compared for equality).
+[[nodiscard]] std::int64_t ModificationTime(const std::filesystem::path& path);
+
+class Manifest
+{
+    std::filesystem::path m_path;
+    std::unordered_map<std::string, Record> m_records;
+    bool m_dirty = false;
+
+public:
+    // Loads the manifest at `path`; a missing or unreadable file starts an empty manifest.
+    explicit Manifest(std::filesystem::path path);
+
+    // True if `input` was last converted to `output` in `mode` by this tool version and codebook
+    // library and its bytes are unchanged.  Size and mtime are checked first; the data is only
+    // hashed when they differ, and a matching hash refreshes the stored mtime.
+    [[nodiscard]] bool Unchanged(const Input& input, std::string_view output,
+                                 std::string_view mode);
+
+    // Records a successful conversion of `input` to `output` in `mode`.
+    void Update(const Input& input, std::string_view output, std::string_view mode);
+
+    // Writes the manifest if anything changed, via a temporary file renamed over the old one.
+    void Save();
+
+    [[nodiscard]] const std::filesystem::path& Path() const
+    {
+        return m_path;
+    }
+
+    [[nodiscard]] std::size_t Size() const
+    {
+        return m_records.size();
+    }
+};
+
+} // namespace wwtools::manifest
@@ -0,0 +1,175 @@
+#include <cerrno>
+#include <cstddef>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#include "mapped_file.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace wwtools
+{
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::system_error(static_cast<int>(GetLastError()), std::system_category(),
+                                "failed to open " + path.string());
+    }
+
+    LARGE_INTEGER size{};
+    if (GetFileSizeEx(file, &size) == 0)
+    {
+        const auto error = GetLastError();
+        CloseHandle(file);
+        throw std::system_error(static_cast<int>(error), std::system_category(),
+                                "failed to stat " + path.string());
+    }
+    m_size = static_cast<std::size_t>(size.QuadPart);
+
+    // Empty files cannot be mapped; they simply have no bytes
+    if (m_size != 0)
+    {
+        m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping != nullptr)
+        {
+            m_data = static_cast<const std::byte*>(
+                MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (m_data == nullptr)
+        {
+            const auto error = GetLastError();
+            Release();
+            CloseHandle(file);
+            throw std::system_error(static_cast<int>(error), std::system_category(),
+                                    "failed to map " + path.string());
+        }
+    }
+
+    // The mapping keeps the file alive on its own
+    CloseHandle(file);
+}
+
+void MappedFile::Release() noexcept
+{
+    if (m_data != nullptr)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping != nullptr)
+    {
+        CloseHandle(m_mapping);
+    }
+    m_data = nullptr;
+    m_mapping = nullptr;
+    m_size = 0;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0)),
+      m_mapping(std::exchange(other.m_mapping, nullptr))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        m_mapping = std::exchange(other.m_mapping, nullptr);
+    }
+    return *this;
+}
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "failed to open " + path.string());
+    }
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0)
+    {
+        const int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), "failed to stat " + path.string());
+    }
+    m_size = static_cast<std::size_t>(st.st_size);
+
+    // Empty files cannot be mapped; they simply have no bytes
+    if (m_size != 0)
+    {
+        void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            const int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(),
+                                    "failed to map " + path.string());
+        }
+        ::madvise(data, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const std::byte*>(data);
+    }
+
+    // The mapping keeps the file alive on its own
+    ::close(fd);
+}
+
+void MappedFile::Release() noexcept
+{
+    if (m_data != nullptr)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+        ::munmap(const_cast<std::byte*>(m_data), m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+    }
+    return *this;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+    Release();
+}
+
+} // namespace wwtools
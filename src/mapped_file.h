@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+namespace wwtools
+{
+
+// Read-only memory mapping of a whole file.  Pages are only read when touched, so mapping a large
+// bank to look at a few entries costs no more I/O than the entries themselves.
+class MappedFile
+{
+    const std::byte* m_data = nullptr;
+    std::size_t m_size = 0;
+#if defined(_WIN32)
+    void* m_mapping = nullptr; // file mapping handle
+#endif
+
+    void Release() noexcept;
+
+public:
+    // Throws std::system_error when the file cannot be opened or mapped.
+    explicit MappedFile(const std::filesystem::path& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    [[nodiscard]] std::span<const std::byte> Bytes() const
+    {
+        return {m_data, m_size};
+    }
+
+    [[nodiscard]] std::string_view View() const
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        return {reinterpret_cast<const char*>(m_data), m_size};
+    }
+
+    [[nodiscard]] std::size_t Size() const
+    {
+        return m_size;
+    }
+};
+
+} // namespace wwtools
@@ -0,0 +1,49 @@
+#include <charconv>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+
+#include "media_index.h"
+#include "scan.h"
+
+namespace fs = std::filesystem;
+
+namespace wwtools::media
+{
+
+std::optional<std::uint32_t> StreamedWemId(const fs::path& path)
+{
+    if (scan::LowerExtension(path) != ".wem")
+    {
+        return std::nullopt;
+    }
+    const auto stem = path.stem().string();
+    std::uint32_t id = 0;
+    const auto* const end = stem.data() + stem.size();
+    const auto [ptr, ec] = std::from_chars(stem.data(), end, id);
+    if (stem.empty() || ec != std::errc{} || ptr != end)
+    {
+        return std::nullopt;
+    }
+    return id;
+}
+
+MediaIndex::MediaIndex(const std::span<const fs::path> roots, const unsigned int threads)
+{
+    // WalkParallel orders the files by root, then name, so duplicates resolve the same way on
+    // every run
+    const auto files = scan::WalkParallel(
+        roots,
+        [](const fs::directory_entry& entry) { return StreamedWemId(entry.path()).has_value(); },
+        threads);
+
+    m_paths.reserve(files.size());
+    for (const auto& path : files)
+    {
+        m_paths.try_emplace(*StreamedWemId(path), path);
+    }
+}
+
+} // namespace wwtools::media
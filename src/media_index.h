@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <unordered_map>
+
+// Locates the loose <id>.wem files of streamed media, which installs often keep in directory
+// trees of their own rather than next to the banks.
+namespace wwtools::media
+{
+
+// The WEM ID named by a streamed media file, "<id>.wem" (any extension case); nullopt for any
+// other name.
+[[nodiscard]] std::optional<std::uint32_t> StreamedWemId(const std::filesystem::path& path);
+
+// ID to path map over one or more directory trees, built up front by a single walk so resolving
+// a streamed WEM is a hash lookup instead of a filesystem probe per entry.
+class MediaIndex
+{
+    std::unordered_map<std::uint32_t, std::filesystem::path> m_paths;
+
+public:
+    MediaIndex() = default;
+
+    // Walks `roots` recursively, spreading their subdirectories over `threads` workers (0 = one
+    // per core).  When an ID appears more than once, the earliest root wins, and within a root
+    // the file found first walking top-level files and then subdirectories in name order.
+    // Unreadable directories are skipped; a missing root throws std::filesystem::filesystem_error.
+    explicit MediaIndex(std::span<const std::filesystem::path> roots, unsigned int threads = 0);
+
+    // The file holding WEM `id`, or nullptr when no root has one.
+    [[nodiscard]] const std::filesystem::path* Find(const std::uint32_t id) const
+    {
+        const auto found = m_paths.find(id);
+        return found == m_paths.end() ? nullptr : &found->second;
+    }
+
+    [[nodiscard]] std::size_t Size() const
+    {
+        return m_paths.size();
+    }
+};
+
+} // namespace wwtools::media
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// Destinations for output produced a piece at a time, such as OGG pages.
+namespace wwtools
+{
+
+class OutputSink
+{
+public:
+    OutputSink() = default;
+    virtual ~OutputSink() = default;
+
+    // Non-copyable, non-movable
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+    OutputSink(OutputSink&&) = delete;
+    OutputSink& operator=(OutputSink&&) = delete;
+
+    // Announces roughly how many bytes will follow, so the sink can allocate once.
+    virtual void Reserve(std::size_t /*size*/)
+    {
+    }
+
+    virtual void Write(std::span<const std::byte> bytes) = 0;
+
+    // Writes `pieces` back to back, in one scatter-gather write where the sink can do that.
+    virtual void WriteGather(const std::span<const std::span<const std::byte>> pieces)
+    {
+        for (const auto piece : pieces)
+        {
+            Write(piece);
+        }
+    }
+};
+
+// Collects the output in a string that grows as needed.
+class MemorySink final : public OutputSink
+{
+    std::string m_data;
+
+public:
+    void Reserve(const std::size_t size) override
+    {
+        m_data.reserve(size);
+    }
+
+    void Write(const std::span<const std::byte> bytes) override
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        m_data.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+
+    [[nodiscard]] std::string_view View() const
+    {
+        return m_data;
+    }
+
+    // Moves the collected bytes out, leaving the sink empty.
+    [[nodiscard]] std::string Take()
+    {
+        return std::exchange(m_data, {});
+    }
+};
+
+// Forwards the output to a stream; check the stream's state afterwards.
+class StreamSink final : public OutputSink
+{
+    std::ostream& m_os;
+
+public:
+    explicit StreamSink(std::ostream& os) : m_os(os)
+    {
+    }
+
+    void Write(const std::span<const std::byte> bytes) override
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        m_os.write(reinterpret_cast<const char*>(bytes.data()),
+                   static_cast<std::streamsize>(bytes.size()));
+    }
+};
+
+} // namespace wwtools
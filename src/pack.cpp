@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "manifest.h"
+#include "pack.h"
+#include "wem/byte_reader.h"
+
+namespace
+{
+
+constexpr std::uint32_t g_version = 1;
+constexpr std::size_t g_header_size = 8;
+constexpr std::size_t g_record_size = 32; // index record without its name
+constexpr std::size_t g_trailer_size = 24;
+
+template <typename T> void Store(std::vector<std::byte>& out, const T value)
+{
+    for (std::size_t shift = 0; shift < 8 * sizeof(T); shift += 8)
+    {
+        out.push_back(static_cast<std::byte>(value >> shift));
+    }
+}
+
+template <typename T>
+[[nodiscard]] T Load(const std::span<const std::byte> data, const std::size_t offset)
+{
+    return wwtools::wem::Load<T, std::endian::little>(data, offset);
+}
+
+// The magic followed by the version, as the header and the trailer end with.
+[[nodiscard]] std::vector<std::byte> Signature()
+{
+    std::vector<std::byte> signature;
+    for (const char c : std::string_view("WWPK"))
+    {
+        signature.push_back(static_cast<std::byte>(c));
+    }
+    Store(signature, g_version);
+    return signature;
+}
+
+} // anonymous namespace
+
+namespace wwtools::pack
+{
+
+PackWriter::PackWriter(const std::filesystem::path& path) : m_out(path)
+{
+    const auto header = Signature();
+    m_out.Write(header);
+    m_offset = header.size();
+}
+
+void PackWriter::Add(const std::uint32_t id, const std::string_view name,
+                     const std::span<const std::byte> data)
+{
+    if (m_failed)
+    {
+        throw std::runtime_error("pack cannot be added to after a failed write");
+    }
+
+    // Entries are extracted to their names, so a second one would overwrite the first
+    if (!m_names.emplace(name).second)
+    {
+        throw std::runtime_error(std::format("pack already holds an entry named {}", name));
+    }
+    try
+    {
+        m_out.Write(data);
+    }
+    catch (const std::exception&)
+    {
+        m_failed = true;
+        throw;
+    }
+
+    Store(m_index, id);
+    Store(m_index, static_cast<std::uint32_t>(name.size()));
+    Store(m_index, m_offset);
+    Store(m_index, static_cast<std::uint64_t>(data.size()));
+    Store(m_index, manifest::Hash(data));
+    const auto name_bytes = std::as_bytes(std::span(name));
+    m_index.insert(m_index.end(), name_bytes.begin(), name_bytes.end());
+
+    m_offset += data.size();
+    ++m_count;
+}
+
+void PackWriter::Finish()
+{
+    if (m_failed)
+    {
+        throw std::runtime_error("pack cannot be finished after a failed write");
+    }
+
+    std::vector<std::byte> trailer;
+    Store(trailer, m_offset);
+    Store(trailer, m_count);
+    const auto signature = Signature();
+    trailer.insert(trailer.end(), signature.begin(), signature.end());
+
+    try
+    {
+        m_out.Write(m_index);
+        m_out.Write(trailer);
+        m_out.Close();
+    }
+    catch (const std::exception&)
+    {
+        m_failed = true;
+        throw;
+    }
+}
+
+Pack::Pack(const std::filesystem::path& path) : m_file(path)
+{
+    const auto data = m_file.Bytes();
+    const auto signature = Signature();
+    if (data.size() < g_header_size + g_trailer_size ||
+        !std::ranges::equal(data.first(g_header_size), signature) ||
+        !std::ranges::equal(data.last(signature.size()), signature))
+    {
+        throw std::runtime_error(std::format("{} is not a complete wwtools pack", path.string()));
+    }
+
+    const auto trailer = data.size() - g_trailer_size;
+    const auto index_offset = Load<std::uint64_t>(data, trailer);
+    const auto count = Load<std::uint64_t>(data, trailer + 8);
+    if (index_offset < g_header_size || index_offset > trailer ||
+        count > (trailer - index_offset) / g_record_size)
+    {
+        throw std::runtime_error("pack index out of bounds");
+    }
+
+    m_entries.reserve(static_cast<std::size_t>(count));
+    m_by_id.reserve(static_cast<std::size_t>(count));
+    std::unordered_set<std::string_view> names;
+    names.reserve(static_cast<std::size_t>(count));
+    auto record = static_cast<std::size_t>(index_offset);
+    for (std::uint64_t i = 0; i < count; ++i)
+    {
+        if (record + g_record_size > trailer)
+        {
+            throw std::runtime_error("pack index truncated");
+        }
+        const auto name_size = Load<std::uint32_t>(data, record + 4);
+        const Entry entry{
+            .id = Load<std::uint32_t>(data, record),
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            .name = {reinterpret_cast<const char*>(data.data() + record + g_record_size),
+                     std::min<std::size_t>(name_size, trailer - record - g_record_size)},
+            .offset = Load<std::uint64_t>(data, record + 8),
+            .size = Load<std::uint64_t>(data, record + 16),
+            .hash = Load<std::uint64_t>(data, record + 24)};
+        if (entry.name.size() != name_size || entry.offset < g_header_size ||
+            !wem::InBounds(entry.offset, entry.size, index_offset))
+        {
+            throw std::runtime_error(std::format("pack entry {} out of bounds", i));
+        }
+        if (!names.insert(entry.name).second)
+        {
+            throw std::runtime_error(std::format("pack entry {} repeats the name {}", i,
+                                                 entry.name));
+        }
+
+        m_by_id.try_emplace(entry.id, m_entries.size());
+        m_entries.push_back(entry);
+        record += g_record_size + name_size;
+    }
+    if (record != trailer)
+    {
+        throw std::runtime_error("pack index size mismatch");
+    }
+}
+
+bool Pack::Verify(const Entry& entry) const
+{
+    return manifest::Hash(Data(entry)) == entry.hash;
+}
+
+} // namespace wwtools::pack
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "file_sink.h"
+#include "mapped_file.h"
+
+// Writer and reader for wwtools packs (.wwpack), single files holding the many outputs of a bulk
+// extraction so they cost one sequential write instead of a file each.
+//
+// Layout (little-endian): "WWPK", u4 version, then the payloads back to back.  The index follows
+// the last payload, one record per entry: u4 id, u4 name_size, u8 offset, u8 size, u8 hash
+// (XXH3-64 of the payload), then the name.  A 24-byte trailer ends the file: u8 index_offset,
+// u8 entry count, "WWPK", u4 version.  The writer only ever appends and readers start from the
+// trailer, so a pack whose writer did not finish is rejected rather than read short.
+namespace wwtools::pack
+{
+
+struct Entry
+{
+    std::uint32_t id;      // WEM ID
+    std::string_view name; // relative path it was extracted as; points into the mapped index
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::uint64_t hash;
+};
+
+class PackWriter
+{
+    FileSink m_out;
+    std::vector<std::byte> m_index;
+    std::uint64_t m_offset = 0; // where the next payload goes
+    std::uint64_t m_count = 0;
+    std::unordered_set<std::string> m_names;
+    bool m_failed = false; // a write failed, so the file no longer matches m_offset and m_index
+
+public:
+    // Creates or truncates `path`.  Throws std::system_error when it cannot be opened.
+    explicit PackWriter(const std::filesystem::path& path);
+
+    // Appends a payload; entries keep the order they are added in.  Throws std::runtime_error,
+    // writing nothing, when an entry already has this name, and std::system_error when the write
+    // fails.  After a failed write the writer is spent: every later Add or Finish throws
+    // std::runtime_error, so the pack is never finished around a payload that is missing.
+    void Add(std::uint32_t id, std::string_view name, std::span<const std::byte> data);
+
+    // Appends the index and the trailer and closes the file.  Throws std::system_error when a
+    // write fails.
+    void Finish();
+};
+
+// Memory-maps a pack and reads its index without touching any payload.
+class Pack
+{
+    MappedFile m_file;
+    std::vector<Entry> m_entries;
+    std::unordered_map<std::uint32_t, std::size_t> m_by_id; // first entry of each ID
+
+public:
+    // Throws std::system_error if the file cannot be mapped and std::runtime_error if it is not a
+    // complete, well-formed pack with unique entry names.
+    explicit Pack(const std::filesystem::path& path);
+
+    [[nodiscard]] std::span<const Entry> Entries() const
+    {
+        return m_entries;
+    }
+
+    // The first entry added with WEM ID `id`, or nullptr.
+    [[nodiscard]] const Entry* Find(const std::uint32_t id) const
+    {
+        const auto found = m_by_id.find(id);
+        return found == m_by_id.end() ? nullptr : &m_entries[found->second];
+    }
+
+    // Zero-copy view of an entry's payload, valid while this Pack lives.
+    [[nodiscard]] std::span<const std::byte> Data(const Entry& entry) const
+    {
+        return m_file.Bytes().subspan(entry.offset, entry.size);
+    }
+
+    [[nodiscard]] std::string_view View(const Entry& entry) const
+    {
+        return m_file.View().substr(entry.offset, entry.size);
+    }
+
+    // True when the payload still hashes to what the index recorded.
+    [[nodiscard]] bool Verify(const Entry& entry) const;
+};
+
+} // namespace wwtools::pack
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Minimal fork/join helper for batch work (many independent WEMs, banks or files).
+namespace wwtools::parallel
+{
+
+// Returns `requested`, or the hardware concurrency when `requested` is 0 (at least 1).
+[[nodiscard]] inline unsigned int ResolveThreadCount(const unsigned int requested)
+{
+    if (requested != 0)
+    {
+        return requested;
+    }
+    return std::max(1U, std::thread::hardware_concurrency());
+}
+
+// Calls fn(i) for every i in [0, count) using up to `threads` workers (0 = one per core).
+// Indices are handed out dynamically so uneven items balance out.  If any call throws, the
+// remaining indices are skipped and the first exception is rethrown once all workers finish.
+template <typename Fn>
+void ForEachIndex(const std::size_t count, const Fn& fn, unsigned int threads = 0)
+{
+    threads = static_cast<unsigned int>(
+        std::min<std::size_t>(ResolveThreadCount(threads), std::max<std::size_t>(count, 1)));
+
+    if (threads <= 1)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            fn(i);
+        }
+        return;
+    }
+
+    std::atomic<std::size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto worker = [&]() {
+        for (std::size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+        {
+            try
+            {
+                fn(i);
+            }
+            catch (...)
+            {
+                const std::scoped_lock lock(error_mutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+                next.store(count);
+            }
+        }
+    };
+
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(threads);
+        for (unsigned int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back(worker);
+        }
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace wwtools::parallel
@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#include "cpu_features.h"
+#include "pcm/convert.h"
+
+#if defined(WWTOOLS_ARCH_X86)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+constexpr float g_int16_scale = 32768.0F;
+constexpr float g_int16_min = -32768.0F;
+constexpr float g_int16_max = 32767.0F;
+
+// Frames per chunk when converting more than two channels through a planar scratch buffer.
+constexpr std::size_t g_chunk_frames = 256;
+
+// Reference conversion; the SIMD kernels clamp before rounding so they match this exactly.  The
+// clamp is written as maxps then minps behave, which return their second operand when either is
+// NaN, so NaN becomes -32768 here too instead of reaching lrint.
+[[nodiscard]] inline std::int16_t ToInt16(const float sample)
+{
+    const float product = sample * g_int16_scale;
+    const float raised = product > g_int16_min ? product : g_int16_min;
+    const float scaled = raised < g_int16_max ? raised : g_int16_max;
+    return static_cast<std::int16_t>(std::lrint(scaled));
+}
+
+void ConvertMonoScalar(const float* in, const std::size_t count, std::int16_t* out)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        out[i] = ToInt16(in[i]);
+    }
+}
+
+void InterleaveStereoScalar(const float* left, const float* right, const std::size_t frames,
+                            std::int16_t* out)
+{
+    for (std::size_t i = 0; i < frames; ++i)
+    {
+        out[2 * i] = ToInt16(left[i]);
+        out[2 * i + 1] = ToInt16(right[i]);
+    }
+}
+
+#if defined(WWTOOLS_ARCH_X86)
+
+// 8 floats -> 8 int16 (scale, clamp, round-to-nearest, narrow).
+[[nodiscard]] inline __m128i ConvertSse2(const float* in)
+{
+    const __m128 scale = _mm_set1_ps(g_int16_scale);
+    const __m128 lo_limit = _mm_set1_ps(g_int16_min);
+    const __m128 hi_limit = _mm_set1_ps(g_int16_max);
+
+    const __m128 a =
+        _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in), scale), lo_limit), hi_limit);
+    const __m128 b =
+        _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + 4), scale), lo_limit), hi_limit);
+    return _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+}
+
+void ConvertMonoSse2(const float* in, const std::size_t count, std::int16_t* out)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), ConvertSse2(in + i));
+    }
+    ConvertMonoScalar(in + i, count - i, out + i);
+}
+
+void InterleaveStereoSse2(const float* left, const float* right, const std::size_t frames,
+                          std::int16_t* out)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= frames; i += 8)
+    {
+        const __m128i l = ConvertSse2(left + i);
+        const __m128i r = ConvertSse2(right + i);
+        // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_unpacklo_epi16(l, r));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i + 8), _mm_unpackhi_epi16(l, r));
+        // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+    }
+    InterleaveStereoScalar(left + i, right + i, frames - i, out + 2 * i);
+}
+
+// 16 floats -> 16 int16 in source order (packs works per 128-bit lane, so fix the order).
+[[nodiscard]] WWTOOLS_TARGET_AVX2 inline __m256i ConvertAvx2(const float* in)
+{
+    const __m256 scale = _mm256_set1_ps(g_int16_scale);
+    const __m256 lo_limit = _mm256_set1_ps(g_int16_min);
+    const __m256 hi_limit = _mm256_set1_ps(g_int16_max);
+
+    const __m256 a = _mm256_min_ps(
+        _mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in), scale), lo_limit), hi_limit);
+    const __m256 b = _mm256_min_ps(
+        _mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + 8), scale), lo_limit), hi_limit);
+    const __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+    return _mm256_permute4x64_epi64(packed, 0xD8);
+}
+
+WWTOOLS_TARGET_AVX2 void ConvertMonoAvx2(const float* in, const std::size_t count,
+                                         std::int16_t* out)
+{
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), ConvertAvx2(in + i));
+    }
+    ConvertMonoSse2(in + i, count - i, out + i);
+}
+
+WWTOOLS_TARGET_AVX2 void InterleaveStereoAvx2(const float* left, const float* right,
+                                              const std::size_t frames, std::int16_t* out)
+{
+    std::size_t i = 0;
+    for (; i + 16 <= frames; i += 16)
+    {
+        const __m256i l = ConvertAvx2(left + i);
+        const __m256i r = ConvertAvx2(right + i);
+        const __m256i lo = _mm256_unpacklo_epi16(l, r); // frames 0-3 | 8-11
+        const __m256i hi = _mm256_unpackhi_epi16(l, r); // frames 4-7 | 12-15
+        // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i),
+                            _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i + 16),
+                            _mm256_permute2x128_si256(lo, hi, 0x31));
+        // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+    }
+    InterleaveStereoSse2(left + i, right + i, frames - i, out + 2 * i);
+}
+
+void InterleaveStereoFloatSse2(const float* left, const float* right, const std::size_t frames,
+                               float* out)
+{
+    std::size_t i = 0;
+    for (; i + 4 <= frames; i += 4)
+    {
+        const __m128 l = _mm_loadu_ps(left + i);
+        const __m128 r = _mm_loadu_ps(right + i);
+        _mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(l, r));
+    }
+    for (; i < frames; ++i)
+    {
+        out[2 * i] = left[i];
+        out[2 * i + 1] = right[i];
+    }
+}
+
+#endif // WWTOOLS_ARCH_X86
+
+using ConvertMonoFn = void (*)(const float*, std::size_t, std::int16_t*);
+using InterleaveStereoFn = void (*)(const float*, const float*, std::size_t, std::int16_t*);
+
+// Picks the widest kernel the CPU supports; resolved once per process.
+[[nodiscard]] ConvertMonoFn SelectConvertMono()
+{
+#if defined(WWTOOLS_ARCH_X86)
+    return wwtools::cpu::HasAvx2() ? ConvertMonoAvx2 : ConvertMonoSse2;
+#else
+    return ConvertMonoScalar;
+#endif
+}
+
+[[nodiscard]] InterleaveStereoFn SelectInterleaveStereo()
+{
+#if defined(WWTOOLS_ARCH_X86)
+    return wwtools::cpu::HasAvx2() ? InterleaveStereoAvx2 : InterleaveStereoSse2;
+#else
+    return InterleaveStereoScalar;
+#endif
+}
+
+} // anonymous namespace
+
+namespace wwtools::pcm
+{
+
+void InterleaveInt16(const float* const* planar, const int channels, const std::size_t frames,
+                     std::span<std::int16_t> out)
+{
+    static const ConvertMonoFn g_convert_mono = SelectConvertMono();
+    static const InterleaveStereoFn g_interleave_stereo = SelectInterleaveStereo();
+
+    if (channels == 1)
+    {
+        g_convert_mono(planar[0], frames, out.data());
+        return;
+    }
+
+    if (channels == 2)
+    {
+        g_interleave_stereo(planar[0], planar[1], frames, out.data());
+        return;
+    }
+
+    // Wider layouts: convert each channel with the vector kernel into a small planar scratch
+    // buffer, then scatter into the interleaved output.
+    const auto stride = static_cast<std::size_t>(channels);
+    std::array<std::int16_t, g_chunk_frames> scratch{};
+
+    for (std::size_t base = 0; base < frames; base += g_chunk_frames)
+    {
+        const std::size_t count = std::min(g_chunk_frames, frames - base);
+        for (std::size_t ch = 0; ch < stride; ++ch)
+        {
+            g_convert_mono(planar[ch] + base, count, scratch.data());
+
+            std::int16_t* dst = out.data() + base * stride + ch;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                dst[i * stride] = scratch[i];
+            }
+        }
+    }
+}
+
+void InterleaveFloat(const float* const* planar, const int channels, const std::size_t frames,
+                     std::span<float> out)
+{
+    if (channels == 1)
+    {
+        std::memcpy(out.data(), planar[0], frames * sizeof(float));
+        return;
+    }
+
+#if defined(WWTOOLS_ARCH_X86)
+    if (channels == 2)
+    {
+        InterleaveStereoFloatSse2(planar[0], planar[1], frames, out.data());
+        return;
+    }
+#endif
+
+    const auto stride = static_cast<std::size_t>(channels);
+    for (std::size_t ch = 0; ch < stride; ++ch)
+    {
+        const float* src = planar[ch];
+        float* dst = out.data() + ch;
+        for (std::size_t i = 0; i < frames; ++i)
+        {
+            dst[i * stride] = src[i];
+        }
+    }
+}
+
+} // namespace wwtools::pcm
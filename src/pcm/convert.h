@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Output stage of the PCM decoder: interleaves libvorbis' planar float blocks into the caller's
+// sample layout.  SSE2/AVX2 kernels are selected at runtime; other targets use the scalar path.
+// All paths produce bit-identical results.
+namespace wwtools::pcm
+{
+
+// Converts `frames` frames from `planar` (one pointer per channel, nominal range [-1, 1]) to
+// interleaved 16-bit samples in `out` (at least frames * channels elements).  Values are scaled
+// by 32768, rounded to nearest and clipped to the int16 range; NaN becomes -32768.
+void InterleaveInt16(const float* const* planar, int channels, std::size_t frames,
+                     std::span<std::int16_t> out);
+
+// Interleaves `frames` frames from `planar` into `out` (at least frames * channels elements)
+// without changing sample values.
+void InterleaveFloat(const float* const* planar, int channels, std::size_t frames,
+                     std::span<float> out);
+
+} // namespace wwtools::pcm
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include <ogg/ogg.h>
+#include <vorbis/codec.h>
+
+#include "pcm/decoder.h"
+#include "ww2ogg/bitstream.h"
+#include "ww2ogg/errors.h"
+#include "ww2ogg/packed_codebooks.h"
+#include "ww2ogg/wwriff.h"
+
+namespace
+{
+
+constexpr int g_header_packet_count = 3; // identification, comment, setup
+
+// PacketSink that runs libvorbis synthesis on each packet as WwiseRiffVorbis produces it.
+// The first three packets configure the decoder; every later one yields (at most) one block of
+// PCM, which is trimmed to the WEM's declared sample count and forwarded to the handler.
+class VorbisSynthesisSink final : public ww2ogg::PacketSink
+{
+    wwtools::pcm::PcmHandler& m_handler;
+    std::uint64_t m_frames_left;
+
+    vorbis_info m_vi{};
+    vorbis_comment m_vc{};
+    vorbis_dsp_state m_vd{};
+    vorbis_block m_vb{};
+    bool m_dsp_initialized = false;
+
+    int m_headers_read = 0;
+    ogg_int64_t m_packetno = 0;
+
+    void StartSynthesis()
+    {
+        if (vorbis_synthesis_init(&m_vd, &m_vi) != 0)
+        {
+            throw ww2ogg::ParseErrorStr("vorbis_synthesis_init failed");
+        }
+        if (vorbis_block_init(&m_vd, &m_vb) != 0)
+        {
+            vorbis_dsp_clear(&m_vd);
+            throw ww2ogg::ParseErrorStr("vorbis_block_init failed");
+        }
+        m_dsp_initialized = true;
+    }
+
+    void DrainPcm()
+    {
+        float** pcm = nullptr;
+        int frames = 0;
+        while ((frames = vorbis_synthesis_pcmout(&m_vd, &pcm)) > 0)
+        {
+            const auto usable =
+                static_cast<std::size_t>(std::min<std::uint64_t>(frames, m_frames_left));
+            if (usable > 0)
+            {
+                m_handler.OnBlock(pcm, usable);
+                m_frames_left -= usable;
+            }
+            vorbis_synthesis_read(&m_vd, frames);
+        }
+    }
+
+public:
+    VorbisSynthesisSink(wwtools::pcm::PcmHandler& handler, const std::uint64_t frames)
+        : m_handler(handler), m_frames_left(frames)
+    {
+        vorbis_info_init(&m_vi);
+        vorbis_comment_init(&m_vc);
+    }
+
+    ~VorbisSynthesisSink() override
+    {
+        if (m_dsp_initialized)
+        {
+            vorbis_block_clear(&m_vb);
+            vorbis_dsp_clear(&m_vd);
+        }
+        vorbis_comment_clear(&m_vc);
+        vorbis_info_clear(&m_vi);
+    }
+
+    VorbisSynthesisSink(const VorbisSynthesisSink&) = delete;
+    VorbisSynthesisSink& operator=(const VorbisSynthesisSink&) = delete;
+    VorbisSynthesisSink(VorbisSynthesisSink&&) = delete;
+    VorbisSynthesisSink& operator=(VorbisSynthesisSink&&) = delete;
+
+    void WritePacket(const std::span<const unsigned char> packet,
+                     [[maybe_unused]] const std::uint32_t granule, const bool last) override
+    {
+        ogg_packet op{};
+        // libvorbis takes a non-const pointer but never writes through it
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+        op.packet = const_cast<unsigned char*>(packet.data());
+        op.bytes = static_cast<long>(packet.size());
+        op.b_o_s = (m_packetno == 0) ? 1 : 0;
+        op.e_o_s = last ? 1 : 0;
+        op.granulepos = -1;
+        op.packetno = m_packetno++;
+
+        if (m_headers_read < g_header_packet_count)
+        {
+            if (vorbis_synthesis_headerin(&m_vi, &m_vc, &op) < 0)
+            {
+                throw ww2ogg::ParseErrorStr("invalid Vorbis header packet");
+            }
+            if (++m_headers_read == g_header_packet_count)
+            {
+                StartSynthesis();
+            }
+            return;
+        }
+
+        // Corrupt audio packets are skipped, as a player would
+        if (vorbis_synthesis(&m_vb, &op) == 0)
+        {
+            vorbis_synthesis_blockin(&m_vd, &m_vb);
+        }
+        DrainPcm();
+    }
+};
+
+} // anonymous namespace
+
+namespace wwtools::pcm
+{
+
+void DecodeWem(const std::string_view indata, PcmHandler& handler)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const std::string codebooks_data(reinterpret_cast<const char*>(ww2ogg::g_packed_codebooks_bin),
+                                     ww2ogg::g_packed_codebooks_bin_len);
+    ww2ogg::WwiseRiffVorbis ww(std::string{indata}, codebooks_data, false, false,
+                               ww2ogg::K_NO_FORCE_PACKET_FORMAT);
+
+    handler.OnStart(ww.Channels(), ww.SampleRate(), ww.SampleCount());
+
+    VorbisSynthesisSink sink(handler, ww.SampleCount());
+    ww.GeneratePackets(sink);
+}
+
+} // namespace wwtools::pcm
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Direct WEM -> PCM decoding.
+//
+// The packets rebuilt by WwiseRiffVorbis are fed straight into libvorbis synthesis, skipping the
+// OGG page serialization (and the revorb pass) that Wem2Ogg needs for a playable file.
+namespace wwtools::pcm
+{
+
+// Receives decoded audio one synthesis block at a time.
+class PcmHandler
+{
+public:
+    PcmHandler() = default;
+    virtual ~PcmHandler() = default;
+
+    // Non-copyable, non-movable
+    PcmHandler(const PcmHandler&) = delete;
+    PcmHandler& operator=(const PcmHandler&) = delete;
+    PcmHandler(PcmHandler&&) = delete;
+    PcmHandler& operator=(PcmHandler&&) = delete;
+
+    // Called once before any audio with the stream layout; `frames` is the sample count declared
+    // by the WEM, which is also the most OnBlock will deliver in total.
+    virtual void OnStart(std::uint16_t channels, std::uint32_t sample_rate,
+                         std::uint64_t frames) = 0;
+
+    // `planar` holds one pointer per channel, each valid for `frames` samples during the call.
+    virtual void OnBlock(const float* const* planar, std::size_t frames) = 0;
+};
+
+// Decodes WEM data and streams the PCM to `handler`.  Apart from the parsed input, memory use is
+// bounded by one Vorbis block regardless of the stream length.  Throws ww2ogg::ParseError on
+// malformed input.
+void DecodeWem(std::string_view indata, PcmHandler& handler);
+
+} // namespace wwtools::pcm
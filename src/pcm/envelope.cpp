@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "cpu_features.h"
+#include "pcm/envelope.h"
+
+#if defined(WWTOOLS_ARCH_X86)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+using wwtools::pcm::SampleStats;
+
+[[nodiscard]] SampleStats ReduceScalar(const std::span<const float> samples)
+{
+    SampleStats stats{.min = samples[0], .max = samples[0], .sum_squares = 0.0};
+    for (const float s : samples)
+    {
+        stats.min = std::min(stats.min, s);
+        stats.max = std::max(stats.max, s);
+        stats.sum_squares += static_cast<double>(s) * s;
+    }
+    return stats;
+}
+
+#if defined(WWTOOLS_ARCH_X86)
+
+// Folds the vector accumulators and the scalar tail into one result.
+[[nodiscard]] SampleStats FinishReduce(const std::array<float, 8>& mins,
+                                       const std::array<float, 8>& maxs,
+                                       const std::array<float, 8>& sums, const std::size_t lanes,
+                                       const std::span<const float> tail)
+{
+    SampleStats stats{.min = mins[0], .max = maxs[0], .sum_squares = 0.0};
+    for (std::size_t i = 0; i < lanes; ++i)
+    {
+        stats.min = std::min(stats.min, mins[i]);
+        stats.max = std::max(stats.max, maxs[i]);
+        stats.sum_squares += sums[i];
+    }
+    for (const float s : tail)
+    {
+        stats.min = std::min(stats.min, s);
+        stats.max = std::max(stats.max, s);
+        stats.sum_squares += static_cast<double>(s) * s;
+    }
+    return stats;
+}
+
+[[nodiscard]] SampleStats ReduceSse2(const std::span<const float> samples)
+{
+    if (samples.size() < 4)
+    {
+        return ReduceScalar(samples);
+    }
+
+    const float* data = samples.data();
+    __m128 vmin = _mm_loadu_ps(data);
+    __m128 vmax = vmin;
+    __m128 vsum = _mm_setzero_ps();
+
+    std::size_t i = 0;
+    for (; i + 4 <= samples.size(); i += 4)
+    {
+        const __m128 v = _mm_loadu_ps(data + i);
+        vmin = _mm_min_ps(vmin, v);
+        vmax = _mm_max_ps(vmax, v);
+        vsum = _mm_add_ps(vsum, _mm_mul_ps(v, v));
+    }
+
+    std::array<float, 8> mins{};
+    std::array<float, 8> maxs{};
+    std::array<float, 8> sums{};
+    _mm_storeu_ps(mins.data(), vmin);
+    _mm_storeu_ps(maxs.data(), vmax);
+    _mm_storeu_ps(sums.data(), vsum);
+    return FinishReduce(mins, maxs, sums, 4, samples.subspan(i));
+}
+
+[[nodiscard]] WWTOOLS_TARGET_AVX2 SampleStats ReduceAvx2(const std::span<const float> samples)
+{
+    if (samples.size() < 8)
+    {
+        return ReduceSse2(samples);
+    }
+
+    const float* data = samples.data();
+    __m256 vmin = _mm256_loadu_ps(data);
+    __m256 vmax = vmin;
+    __m256 vsum = _mm256_setzero_ps();
+
+    std::size_t i = 0;
+    for (; i + 8 <= samples.size(); i += 8)
+    {
+        const __m256 v = _mm256_loadu_ps(data + i);
+        vmin = _mm256_min_ps(vmin, v);
+        vmax = _mm256_max_ps(vmax, v);
+        vsum = _mm256_add_ps(vsum, _mm256_mul_ps(v, v));
+    }
+
+    std::array<float, 8> mins{};
+    std::array<float, 8> maxs{};
+    std::array<float, 8> sums{};
+    _mm256_storeu_ps(mins.data(), vmin);
+    _mm256_storeu_ps(maxs.data(), vmax);
+    _mm256_storeu_ps(sums.data(), vsum);
+    return FinishReduce(mins, maxs, sums, 8, samples.subspan(i));
+}
+
+#endif // WWTOOLS_ARCH_X86
+
+using ReduceFn = SampleStats (*)(std::span<const float>);
+
+[[nodiscard]] ReduceFn SelectReduce()
+{
+#if defined(WWTOOLS_ARCH_X86)
+    return wwtools::cpu::HasAvx2() ? ReduceAvx2 : ReduceSse2;
+#else
+    return ReduceScalar;
+#endif
+}
+
+} // anonymous namespace
+
+namespace wwtools::pcm
+{
+
+[[nodiscard]] SampleStats Reduce(const std::span<const float> samples)
+{
+    static const ReduceFn g_reduce = SelectReduce();
+    return g_reduce(samples);
+}
+
+EnvelopeHandler::EnvelopeHandler(Waveform& out) : m_out(out)
+{
+}
+
+// Bucket b spans [BucketEnd(b - 1), BucketEnd(b)); boundaries are spread evenly over the
+// declared frame count, so short streams simply leave some buckets zero-length.
+[[nodiscard]] std::uint64_t EnvelopeHandler::BucketEnd(const std::size_t bucket) const
+{
+    return (static_cast<std::uint64_t>(bucket) + 1) * m_out.frames / m_out.resolution;
+}
+
+void EnvelopeHandler::CloseBucket()
+{
+    const auto count = m_position - m_bucket_start;
+
+    for (std::size_t ch = 0; ch < m_accumulators.size(); ++ch)
+    {
+        auto& acc = m_accumulators[ch];
+        auto& point = m_out.points[ch * m_out.resolution + m_bucket];
+
+        if (!acc.empty && count > 0)
+        {
+            point.min = acc.min;
+            point.max = acc.max;
+            point.rms = static_cast<float>(std::sqrt(acc.sum_squares / static_cast<double>(count)));
+        }
+        acc = Accumulator{};
+    }
+
+    m_bucket_start = m_position;
+    ++m_bucket;
+}
+
+void EnvelopeHandler::OnStart(const std::uint16_t channels, const std::uint32_t sample_rate,
+                              const std::uint64_t frames)
+{
+    m_out.channels = channels;
+    m_out.sample_rate = sample_rate;
+    m_out.frames = frames;
+    m_out.points.assign(static_cast<std::size_t>(channels) * m_out.resolution, WaveformPoint{});
+    m_accumulators.assign(channels, Accumulator{});
+}
+
+void EnvelopeHandler::OnBlock(const float* const* planar, const std::size_t frames)
+{
+    std::size_t offset = 0;
+    while (offset < frames && m_bucket < m_out.resolution)
+    {
+        const auto end = BucketEnd(m_bucket);
+        if (m_position >= end)
+        {
+            CloseBucket();
+            continue;
+        }
+
+        const auto count =
+            static_cast<std::size_t>(std::min<std::uint64_t>(frames - offset, end - m_position));
+
+        for (std::size_t ch = 0; ch < m_accumulators.size(); ++ch)
+        {
+            const auto stats = Reduce(std::span<const float>(planar[ch] + offset, count));
+            auto& acc = m_accumulators[ch];
+            acc.min = acc.empty ? stats.min : std::min(acc.min, stats.min);
+            acc.max = acc.empty ? stats.max : std::max(acc.max, stats.max);
+            acc.sum_squares += stats.sum_squares;
+            acc.empty = false;
+        }
+
+        offset += count;
+        m_position += count;
+
+        if (m_position == end)
+        {
+            CloseBucket();
+        }
+    }
+}
+
+void EnvelopeHandler::Finish()
+{
+    if (m_bucket < m_out.resolution && m_position > m_bucket_start)
+    {
+        CloseBucket();
+    }
+    m_out.frames = m_position;
+}
+
+} // namespace wwtools::pcm
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "pcm/decoder.h"
+#include "wwtools/wwtools.h"
+
+// Waveform envelope (min/max/RMS per bucket) computed while decoding.
+namespace wwtools::pcm
+{
+
+// Partial reduction of a run of samples.
+struct SampleStats
+{
+    float min;
+    float max;
+    double sum_squares;
+};
+
+// Reduces `samples` (non-empty) to min, max and sum of squares.  SSE2/AVX2 kernels are selected at
+// runtime; min/max are exact on every path, the sum may differ in the last bits.
+[[nodiscard]] SampleStats Reduce(std::span<const float> samples);
+
+// PcmHandler that folds decoded blocks into a fixed number of buckets per channel.  Only the
+// per-channel accumulators are kept, so memory does not grow with the stream length.
+class EnvelopeHandler final : public PcmHandler
+{
+    struct Accumulator
+    {
+        float min = 0.0F;
+        float max = 0.0F;
+        double sum_squares = 0.0;
+        bool empty = true;
+    };
+
+    Waveform& m_out;
+    std::vector<Accumulator> m_accumulators; // one per channel for the current bucket
+    std::uint64_t m_position = 0;            // frames consumed so far
+    std::uint64_t m_bucket_start = 0;        // first frame of the current bucket
+    std::size_t m_bucket = 0;                // index of the current bucket
+
+    [[nodiscard]] std::uint64_t BucketEnd(std::size_t bucket) const;
+    void CloseBucket();
+
+public:
+    // `out.resolution` selects the number of buckets per channel and must be non-zero.
+    explicit EnvelopeHandler(Waveform& out);
+
+    void OnStart(std::uint16_t channels, std::uint32_t sample_rate, std::uint64_t frames) override;
+    void OnBlock(const float* const* planar, std::size_t frames) override;
+
+    // Closes the last partially-filled bucket; call once decoding has finished.
+    void Finish();
+};
+
+} // namespace wwtools::pcm
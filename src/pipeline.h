@@ -0,0 +1,109 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+// Building blocks for staged pipelines whose stages run on their own threads (read, convert,
+// write), with backpressure so a fast stage cannot run ahead of a slow one without bound.
+namespace wwtools::pipeline
+{
+
+// Bytes in flight between stages, capped by a budget.  Producers block in Acquire while the
+// budget is spent; later stages Charge what they produce without blocking (they must never wait
+// on a stage behind them) and Release once the bytes are gone.
+class ByteBudget
+{
+    std::mutex m_mutex;
+    std::condition_variable m_released;
+    std::size_t m_limit;
+    std::size_t m_used = 0;
+
+public:
+    explicit ByteBudget(const std::size_t limit) : m_limit(limit)
+    {
+    }
+
+    // Waits until `bytes` fit in the budget.  An item larger than the whole budget is let
+    // through once nothing else is in flight, so it cannot stall the pipeline.
+    void Acquire(const std::size_t bytes)
+    {
+        std::unique_lock lock(m_mutex);
+        m_released.wait(lock, [&] { return m_used == 0 || m_used + bytes <= m_limit; });
+        m_used += bytes;
+    }
+
+    void Charge(const std::size_t bytes)
+    {
+        const std::scoped_lock lock(m_mutex);
+        m_used += bytes;
+    }
+
+    void Release(const std::size_t bytes)
+    {
+        {
+            const std::scoped_lock lock(m_mutex);
+            m_used -= bytes;
+        }
+        m_released.notify_all();
+    }
+};
+
+// Multi-producer, multi-consumer FIFO holding at most `capacity` items.  Push blocks while it is
+// full; Pop blocks while it is empty and returns nullopt once it is closed and drained.
+template <typename T> class BoundedQueue
+{
+    std::mutex m_mutex;
+    std::condition_variable m_not_full;
+    std::condition_variable m_not_empty;
+    std::deque<T> m_items;
+    std::size_t m_capacity;
+    bool m_closed = false;
+
+public:
+    explicit BoundedQueue(const std::size_t capacity) : m_capacity(capacity)
+    {
+    }
+
+    void Push(T item)
+    {
+        {
+            std::unique_lock lock(m_mutex);
+            m_not_full.wait(lock, [&] { return m_items.size() < m_capacity; });
+            m_items.push_back(std::move(item));
+        }
+        m_not_empty.notify_one();
+    }
+
+    [[nodiscard]] std::optional<T> Pop()
+    {
+        std::optional<T> item;
+        {
+            std::unique_lock lock(m_mutex);
+            m_not_empty.wait(lock, [&] { return !m_items.empty() || m_closed; });
+            if (m_items.empty())
+            {
+                return std::nullopt;
+            }
+            item.emplace(std::move(m_items.front()));
+            m_items.pop_front();
+        }
+        m_not_full.notify_one();
+        return item;
+    }
+
+    // No more pushes will come; consumers drain what is left and then stop.
+    void Close()
+    {
+        {
+            const std::scoped_lock lock(m_mutex);
+            m_closed = true;
+        }
+        m_not_empty.notify_all();
+    }
+};
+
+} // namespace wwtools::pipeline
@@ -1,13 +1,24 @@
-
-#include <sstream>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <span>
+#include <string>
+#include <string_view>
 
 #include <ogg/ogg.h>
 #include <vorbis/codec.h>
 
+#include "output_sink.h"
+#include "revorb/revorb.h"
+#include "ww2ogg/crc.h"
+
 namespace
 {
 
-constexpr int g_k_buffer_size = 4096; // chunk size for feeding data to libogg
+constexpr std::size_t g_page_header_size = 27; // fixed part of a page header, before the lacing
+constexpr std::size_t g_checksum_offset = 22;
 
 // RAII guard for ogg_stream_state — calls ogg_stream_clear on destruction.
 class OggStreamGuard
@@ -85,265 +96,416 @@ public:
     VorbisCommentGuard& operator=(VorbisCommentGuard&&) = delete;
 };
 
-} // anonymous namespace
-
-namespace revorb
-{
-
-// Copies the three Vorbis header packets (identification, comment, setup) from input
-// to output, initializing the ogg_stream_state for both directions and extracting
-// vorbis_info (needed later to compute packet block sizes for granule calculation).
-// Returns false if the headers are malformed or incomplete.
-[[nodiscard]] bool CopyHeaders(std::stringstream& fi, ogg_sync_state* si, ogg_stream_state* is,
-                               std::stringstream& outdata, ogg_stream_state* os, vorbis_info* vi)
+// RAII guard for vorbis_info — initializes on construction, calls vorbis_info_clear on
+// destruction.
+class VorbisInfoGuard
 {
-    char* buffer = ogg_sync_buffer(si, g_k_buffer_size);
-
-    fi.read(buffer, g_k_buffer_size);
-    auto numread = fi.gcount();
-
-    ogg_sync_wrote(si, static_cast<long>(numread));
+    vorbis_info* m_vi;
 
-    ogg_page page{};
-    int result = ogg_sync_pageout(si, &page);
-    if (result != 1)
+public:
+    explicit VorbisInfoGuard(vorbis_info* const vi) : m_vi(vi)
     {
-        return false;
+        vorbis_info_init(m_vi);
     }
 
-    ogg_stream_init(is, ogg_page_serialno(&page));
-    ogg_stream_init(os, ogg_page_serialno(&page));
-
-    if (ogg_stream_pagein(is, &page) < 0)
+    ~VorbisInfoGuard()
     {
-        ogg_stream_clear(is);
-        ogg_stream_clear(os);
-        return false;
+        vorbis_info_clear(m_vi);
     }
 
-    ogg_packet packet{};
-    if (ogg_stream_packetout(is, &packet) != 1)
-    {
-        ogg_stream_clear(is);
-        ogg_stream_clear(os);
-        return false;
-    }
+    // Non-copyable, non-movable
+    VorbisInfoGuard(const VorbisInfoGuard&) = delete;
+    VorbisInfoGuard& operator=(const VorbisInfoGuard&) = delete;
+    VorbisInfoGuard(VorbisInfoGuard&&) = delete;
+    VorbisInfoGuard& operator=(VorbisInfoGuard&&) = delete;
+};
 
-    vorbis_comment vc{};
-    vorbis_comment_init(&vc);
-    if (vorbis_synthesis_headerin(vi, &vc, &packet) < 0)
+// Walks the pages of an OGG stream held in memory.  Pages point into the buffer, so nothing is
+// copied into an ogg_sync_state; each page's checksum is still verified, as ogg_sync does.
+class PageReader
+{
+    std::span<const unsigned char> m_data;
+    std::string_view m_error;
+
+public:
+    explicit PageReader(const std::span<const std::byte> data)
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        : m_data(reinterpret_cast<const unsigned char*>(data.data()), data.size())
     {
-        vorbis_comment_clear(&vc);
-        ogg_stream_clear(is);
-        ogg_stream_clear(os);
-        return false;
     }
 
-    ogg_stream_packetin(os, &packet);
-
-    int i = 0;
-    while (i < 2)
+    // Returns 1 when a page was read, 0 at the end of the data and -1 on a malformed page, which
+    // Error then describes.
+    [[nodiscard]] int Next(ogg_page& page)
     {
-        int res = ogg_sync_pageout(si, &page);
+        if (m_data.empty())
+        {
+            return 0;
+        }
+        if (m_data.size() < g_page_header_size)
+        {
+            m_error = "truncated page header";
+            return -1;
+        }
+        if (std::memcmp(m_data.data(), "OggS", 4) != 0 || m_data[4] != 0)
+        {
+            m_error = "no OGG page header";
+            return -1;
+        }
 
-        if (res == 0)
+        const std::size_t segments = m_data[g_page_header_size - 1];
+        const std::size_t header_size = g_page_header_size + segments;
+        if (m_data.size() < header_size)
         {
-            buffer = ogg_sync_buffer(si, g_k_buffer_size);
-            fi.read(buffer, g_k_buffer_size);
-            numread = fi.gcount();
-            if (numread == 0 && i < 2)
-            {
-                vorbis_comment_clear(&vc);
-                ogg_stream_clear(is);
-                ogg_stream_clear(os);
-                return false;
-            }
-            ogg_sync_wrote(si, g_k_buffer_size);
-            continue;
+            m_error = "truncated page header";
+            return -1;
+        }
+        std::size_t body_size = 0;
+        for (std::size_t i = 0; i < segments; ++i)
+        {
+            body_size += m_data[g_page_header_size + i];
+        }
+        if (m_data.size() - header_size < body_size)
+        {
+            m_error = "truncated page";
+            return -1;
         }
 
-        if (res == 1)
+        // The checksum covers the page with its own field zeroed
+        std::array<unsigned char, g_page_header_size + 255> header{};
+        std::memcpy(header.data(), m_data.data(), header_size);
+        std::memset(header.data() + g_checksum_offset, 0, 4);
+        const auto checksum =
+            ww2ogg::Checksum(ww2ogg::Checksum(header.data(), header_size),
+                             m_data.data() + header_size, body_size);
+        std::uint32_t stored = 0;
+        for (std::size_t i = 0; i < 4; ++i)
         {
-            ogg_stream_pagein(is, &page);
-            while (i < 2)
-            {
-                res = ogg_stream_packetout(is, &packet);
-                if (res == 0)
-                {
-                    break;
-                }
-                if (res < 0)
-                {
-                    vorbis_comment_clear(&vc);
-                    ogg_stream_clear(is);
-                    ogg_stream_clear(os);
-                    return false;
-                }
-                vorbis_synthesis_headerin(vi, &vc, &packet);
-                ogg_stream_packetin(os, &packet);
-                ++i;
-            }
+            stored |= static_cast<std::uint32_t>(m_data[g_checksum_offset + i]) << (8 * i);
         }
-    }
+        if (checksum != stored)
+        {
+            m_error = "page checksum mismatch";
+            return -1;
+        }
+
+        // libogg only reads through these
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+        page.header = const_cast<unsigned char*>(m_data.data());
+        page.header_len = static_cast<long>(header_size);
+        page.body = page.header + header_size;
+        page.body_len = static_cast<long>(body_size);
 
-    vorbis_comment_clear(&vc);
+        m_data = m_data.subspan(header_size + body_size);
+        return 1;
+    }
 
-    while (ogg_stream_flush(os, &page) != 0)
+    [[nodiscard]] std::string_view Error() const
     {
-        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-        outdata.write(reinterpret_cast<char*>(page.header), page.header_len);
-        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-        outdata.write(reinterpret_cast<char*>(page.body), page.body_len);
+        return m_error;
     }
+};
 
-    return true;
+void WritePage(wwtools::OutputSink& out, const ogg_page& page)
+{
+    out.Write(std::as_bytes(std::span(page.header, static_cast<std::size_t>(page.header_len))));
+    out.Write(std::as_bytes(std::span(page.body, static_cast<std::size_t>(page.body_len))));
 }
 
+} // anonymous namespace
+
+namespace revorb
+{
+
 // Recalculates and rewrites OGG page granule positions for a Vorbis stream.
 //
 // After ww2ogg conversion, granule positions may be incorrect (especially for modified
 // packets or when Wwise used placeholder values).  This function:
-//   1. Copies the three header packets verbatim
+//   1. Copies the three header packets verbatim, on pages of their own
 //   2. Reads each audio packet, computes its block size via vorbis_packet_blocksize
 //   3. Accumulates a running sample count: granpos += (prev_blocksize + cur_blocksize) / 4
 //   4. Writes each packet with the corrected granule position
 //
 // The /4 factor comes from Vorbis overlap-add: each block contributes blocksize/2 new
 // samples, and the overlap region between consecutive blocks is (prev+cur)/4 samples.
-[[nodiscard]] bool Revorb(std::istream& indata, std::stringstream& outdata)
+[[nodiscard]] bool Revorb(const std::span<const std::byte> indata, wwtools::OutputSink& outdata)
 {
-    bool failed = false;
-
-    std::stringstream indata_ss;
-    indata_ss << indata.rdbuf();
+    // Repaging only merges packets onto fewer pages, so the output is at most about this big
+    outdata.Reserve(indata.size());
 
-    ogg_sync_state sync_in{};
-    ogg_sync_state sync_out{};
-    ogg_sync_init(&sync_in);
-    ogg_sync_init(&sync_out);
+    PageReader reader(indata);
 
     ogg_stream_state stream_in{};
     ogg_stream_state stream_out{};
+    OggStreamGuard stream_in_guard(&stream_in);
+    OggStreamGuard stream_out_guard(&stream_out);
+
     vorbis_info vi{};
-    vorbis_info_init(&vi);
+    VorbisInfoGuard vi_guard(&vi);
+    vorbis_comment vc{};
+    VorbisCommentGuard vc_guard(&vc);
+    vc_guard.Init();
 
-    ogg_packet packet{};
-    ogg_page page{};
+    bool failed = false;
+    int headers = 0;
+    ogg_int64_t granpos = 0;
+    ogg_int64_t packetnum = 0;
+    long lastbs = 0;
 
-    if (CopyHeaders(indata_ss, &sync_in, &stream_in, outdata, &stream_out, &vi))
+    ogg_page page{};
+    ogg_packet packet{};
+    int res = 0;
+    for (bool first_page = true; (res = reader.Next(page)) == 1; first_page = false)
     {
-        ogg_int64_t granpos = 0;
-        ogg_int64_t packetnum = 0;
-        long lastbs = 0;
+        if (first_page)
+        {
+            stream_in_guard.Init(ogg_page_serialno(&page));
+            stream_out_guard.Init(ogg_page_serialno(&page));
+        }
+        if (ogg_stream_pagein(&stream_in, &page) < 0)
+        {
+            failed = true;
+        }
 
-        while (true)
+        while ((res = ogg_stream_packetout(&stream_in, &packet)) != 0)
         {
-            int eos = 0;
-            while (eos == 0)
+            if (res < 0)
             {
-                int res = ogg_sync_pageout(&sync_in, &page);
-                if (res == 0)
-                {
-                    char* buffer = ogg_sync_buffer(&sync_in, g_k_buffer_size);
-                    indata_ss.read(buffer, g_k_buffer_size);
-                    const auto numread = indata_ss.gcount();
-                    if (numread > 0)
-                    {
-                        ogg_sync_wrote(&sync_in, static_cast<long>(numread));
-                    }
-                    else
-                    {
-                        eos = 2;
-                    }
-                    continue;
-                }
+                failed = true;
+                continue;
+            }
 
-                if (res < 0)
+            if (headers < 3)
+            {
+                if (vorbis_synthesis_headerin(&vi, &vc, &packet) < 0)
                 {
-                    failed = true;
+                    return false;
                 }
-                else
+                ogg_stream_packetin(&stream_out, &packet);
+                if (++headers == 3)
                 {
-                    if (ogg_page_eos(&page) != 0)
-                    {
-                        eos = 1;
-                    }
-                    ogg_stream_pagein(&stream_in, &page);
-
-                    while (true)
+                    ogg_page opage{};
+                    while (ogg_stream_flush(&stream_out, &opage) != 0)
                     {
-                        res = ogg_stream_packetout(&stream_in, &packet);
-                        if (res == 0)
-                        {
-                            break;
-                        }
-                        if (res < 0)
-                        {
-                            failed = true;
-                            continue;
-                        }
-
-                        const auto bs = vorbis_packet_blocksize(&vi, &packet);
-                        if (lastbs != 0)
-                        {
-                            granpos += static_cast<ogg_int64_t>((lastbs + bs) / 4);
-                        }
-                        lastbs = bs;
-
-                        packet.granulepos = granpos;
-                        packet.packetno = packetnum++;
-                        if (packet.e_o_s == 0)
-                        {
-                            ogg_stream_packetin(&stream_out, &packet);
-
-                            ogg_page opage{};
-                            while (ogg_stream_pageout(&stream_out, &opage) != 0)
-                            {
-                                // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-                                outdata.write(reinterpret_cast<char*>(opage.header),
-                                              opage.header_len);
-                                // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-                                outdata.write(reinterpret_cast<char*>(opage.body), opage.body_len);
-                            }
-                        }
+                        WritePage(outdata, opage);
                     }
                 }
+                continue;
             }
 
-            if (eos == 2)
+            const auto bs = vorbis_packet_blocksize(&vi, &packet);
+            if (lastbs != 0)
             {
-                break;
+                granpos += static_cast<ogg_int64_t>((lastbs + bs) / 4);
             }
+            lastbs = bs;
 
+            packet.granulepos = granpos;
+            packet.packetno = packetnum++;
+            ogg_stream_packetin(&stream_out, &packet);
+
+            ogg_page opage{};
+            while (ogg_stream_pageout(&stream_out, &opage) != 0)
             {
-                packet.e_o_s = 1;
-                ogg_stream_packetin(&stream_out, &packet);
-                ogg_page opage{};
-                while (ogg_stream_flush(&stream_out, &opage) != 0)
-                {
-                    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-                    outdata.write(reinterpret_cast<char*>(opage.header), opage.header_len);
-                    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-                    outdata.write(reinterpret_cast<char*>(opage.body), opage.body_len);
-                }
-                ogg_stream_clear(&stream_in);
-                break;
+                WritePage(outdata, opage);
             }
         }
 
-        ogg_stream_clear(&stream_out);
+        if (ogg_page_eos(&page) != 0)
+        {
+            break;
+        }
+    }
+
+    if (res < 0 || headers < 3)
+    {
+        return false;
     }
-    else
+
+    // A stream without an end-of-stream page still gets its last packets written
+    ogg_page opage{};
+    while (ogg_stream_flush(&stream_out, &opage) != 0)
     {
-        failed = true;
+        WritePage(outdata, opage);
     }
 
-    vorbis_info_clear(&vi);
+    return !failed;
+}
+
+// Follows Revorb packet by packet, comparing granules instead of writing pages.
+[[nodiscard]] bool GranulesCorrect(const std::span<const std::byte> indata)
+{
+    PageReader reader(indata);
 
-    ogg_sync_clear(&sync_in);
-    ogg_sync_clear(&sync_out);
+    ogg_stream_state stream_in{};
+    OggStreamGuard stream_in_guard(&stream_in);
 
-    return !failed;
+    vorbis_info vi{};
+    VorbisInfoGuard vi_guard(&vi);
+    vorbis_comment vc{};
+    VorbisCommentGuard vc_guard(&vc);
+    vc_guard.Init();
+
+    int headers = 0;
+    ogg_int64_t granpos = 0;
+    long lastbs = 0;
+
+    ogg_page page{};
+    ogg_packet packet{};
+    int res = 0;
+    for (bool first_page = true; (res = reader.Next(page)) == 1; first_page = false)
+    {
+        if (first_page)
+        {
+            stream_in_guard.Init(ogg_page_serialno(&page));
+        }
+        if (ogg_stream_pagein(&stream_in, &page) < 0)
+        {
+            return false;
+        }
+
+        ogg_int64_t expected = -1;
+        while ((res = ogg_stream_packetout(&stream_in, &packet)) != 0)
+        {
+            if (res < 0 || (headers < 3 && vorbis_synthesis_headerin(&vi, &vc, &packet) < 0))
+            {
+                return false;
+            }
+
+            if (headers < 3)
+            {
+                // Header packets are copied with their granules as they are
+                ++headers;
+                expected = ogg_page_granulepos(&page);
+                continue;
+            }
+
+            const auto bs = vorbis_packet_blocksize(&vi, &packet);
+            if (lastbs != 0)
+            {
+                granpos += static_cast<ogg_int64_t>((lastbs + bs) / 4);
+            }
+            lastbs = bs;
+            expected = granpos;
+        }
+
+        if (ogg_page_granulepos(&page) != expected)
+        {
+            return false;
+        }
+        if (ogg_page_eos(&page) != 0)
+        {
+            break;
+        }
+    }
+
+    return res >= 0 && headers == 3;
+}
+
+[[nodiscard]] wwtools::OggVerification Verify(const std::span<const std::byte> indata)
+{
+    wwtools::OggVerification result{
+        .valid = false, .error = {}, .pages = 0, .packets = 0, .granule = -1};
+    const auto fail = [&](std::string error) {
+        result.error = std::move(error);
+        return result;
+    };
+
+    PageReader reader(indata);
+
+    ogg_stream_state stream_in{};
+    OggStreamGuard stream_in_guard(&stream_in);
+
+    vorbis_info vi{};
+    VorbisInfoGuard vi_guard(&vi);
+    vorbis_comment vc{};
+    VorbisCommentGuard vc_guard(&vc);
+    vc_guard.Init();
+
+    int headers = 0;
+    int serial = 0;
+    bool eos = false;
+
+    ogg_page page{};
+    ogg_packet packet{};
+    int res = 0;
+    while (!eos && (res = reader.Next(page)) == 1)
+    {
+        const auto pageno = result.pages;
+        if (pageno == 0)
+        {
+            serial = ogg_page_serialno(&page);
+            stream_in_guard.Init(serial);
+        }
+        else if (ogg_page_serialno(&page) != serial)
+        {
+            return fail(std::format("page {} belongs to another stream", pageno));
+        }
+        if (static_cast<std::uint64_t>(ogg_page_pageno(&page)) != pageno)
+        {
+            return fail(std::format("page {} is out of sequence", pageno));
+        }
+        if (ogg_stream_pagein(&stream_in, &page) < 0)
+        {
+            return fail(std::format("page {} could not be read", pageno));
+        }
+
+        const auto granule = ogg_page_granulepos(&page);
+        if (granule != -1)
+        {
+            if (granule < result.granule)
+            {
+                return fail(std::format("granule position goes backwards at page {}", pageno));
+            }
+            result.granule = granule;
+        }
+
+        while ((res = ogg_stream_packetout(&stream_in, &packet)) != 0)
+        {
+            if (res < 0)
+            {
+                return fail(std::format("packets missing before page {}", pageno));
+            }
+
+            if (headers < 3)
+            {
+                if (vorbis_synthesis_headerin(&vi, &vc, &packet) < 0)
+                {
+                    return fail(std::format("invalid Vorbis header packet {}", headers));
+                }
+                ++headers;
+                continue;
+            }
+
+            // Empty packets are allowed and decode to nothing; any other packet has to name a
+            // mode the setup header defines
+            if (packet.bytes != 0 && vorbis_packet_blocksize(&vi, &packet) < 0)
+            {
+                return fail(std::format("audio packet {} on page {} has no valid mode",
+                                        result.packets, pageno));
+            }
+            ++result.packets;
+        }
+
+        eos = ogg_page_eos(&page) != 0;
+        ++result.pages;
+    }
+
+    if (res < 0)
+    {
+        return fail(std::format("page {}: {}", result.pages, reader.Error()));
+    }
+    if (headers < 3)
+    {
+        return fail("missing Vorbis header packets");
+    }
+    if (!eos)
+    {
+        return fail("no end-of-stream page");
+    }
+
+    result.valid = true;
+    return result;
 }
 
 } // namespace revorb
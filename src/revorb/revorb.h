@@ -1,7 +1,10 @@
 #pragma once
 
-#include <istream>
-#include <sstream>
+#include <cstddef>
+#include <span>
+
+#include "output_sink.h"
+#include "wwtools/wwtools.h"
 
 namespace revorb
 {
@@ -9,6 +12,17 @@ namespace revorb
 // Rewrites OGG page granule positions so downstream players/decoders seek correctly.
 // Returns true when the stream is parsed and rewritten successfully; false on malformed/invalid
 // OGG. `outdata` receives rewritten bytes (partial output may exist when false is returned).
-[[nodiscard]] bool Revorb(std::istream& indata, std::stringstream& outdata);
+// Pages are read in place from `indata`, which must stay valid for the call.
+[[nodiscard]] bool Revorb(std::span<const std::byte> indata, wwtools::OutputSink& outdata);
+
+// Returns true when every page of `indata` already carries the granule position Revorb would give
+// the last packet ending on it (-1 if none ends there), so rewriting it would gain nothing.
+// Packets are only split out and sized, never re-paged.  Returns false on malformed/invalid OGG.
+[[nodiscard]] bool GranulesCorrect(std::span<const std::byte> indata);
+
+// Checks page framing, checksums and sequence, that granule positions never decrease, that the
+// three Vorbis headers parse and that every audio packet names a mode of the setup header.
+// Nothing is synthesized, so this is far cheaper than decoding.  Stops at the first problem.
+[[nodiscard]] wwtools::OggVerification Verify(std::span<const std::byte> indata);
 
 } // namespace revorb
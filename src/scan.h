@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <filesystem>
+#include <initializer_list>
+#include <iterator>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "parallel.h"
+
+// Helpers shared by the commands that walk a directory tree and report on what they find.
+namespace wwtools::scan
+{
+
+[[nodiscard]] inline std::string LowerExtension(const std::filesystem::path& path)
+{
+    auto ext = path.extension().string();
+    std::ranges::transform(ext, ext.begin(), [](const unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return ext;
+}
+
+// Regular files under `roots` that `keep(entry)` accepts.  The top level of each root is listed
+// here and the trees below it are walked on `threads` workers (0 = one per core), so one deep
+// directory does not hold up the others.  The result is grouped by root in the order given;
+// within a root its top-level files come first, then the tree of each subdirectory in name order,
+// every group sorted by path.  Unreadable directories are skipped; a missing root throws
+// std::filesystem::filesystem_error.
+template <typename Keep>
+[[nodiscard]] std::vector<std::filesystem::path> WalkParallel(
+    const std::span<const std::filesystem::path> roots, const Keep& keep,
+    const unsigned int threads = 0)
+{
+    namespace fs = std::filesystem;
+
+    const auto accept = [&](const fs::directory_entry& entry, std::vector<fs::path>& out) {
+        std::error_code ec;
+        if (entry.is_regular_file(ec) && keep(entry))
+        {
+            out.push_back(entry.path());
+        }
+    };
+
+    // groups[] holds each root's top-level files followed by one slot per subdirectory
+    std::vector<std::vector<fs::path>> groups;
+    std::vector<fs::path> subdirs;
+    std::vector<std::size_t> slots; // groups[] index of each subdirectory
+    for (const auto& root : roots)
+    {
+        auto& top = groups.emplace_back();
+        std::vector<fs::path> root_subdirs;
+        for (const auto& entry :
+             fs::directory_iterator(root, fs::directory_options::skip_permission_denied))
+        {
+            std::error_code ec;
+            if (entry.is_directory(ec))
+            {
+                root_subdirs.push_back(entry.path());
+            }
+            else
+            {
+                accept(entry, top);
+            }
+        }
+        std::ranges::sort(top);
+        std::ranges::sort(root_subdirs);
+        for (auto& subdir : root_subdirs)
+        {
+            slots.push_back(groups.size());
+            groups.emplace_back();
+            subdirs.push_back(std::move(subdir));
+        }
+    }
+
+    parallel::ForEachIndex(
+        subdirs.size(),
+        [&](const std::size_t i) {
+            auto& out = groups[slots[i]];
+            std::error_code ec;
+            for (fs::recursive_directory_iterator it(
+                     subdirs[i], fs::directory_options::skip_permission_denied, ec);
+                 !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+            {
+                accept(*it, out);
+            }
+            std::ranges::sort(out);
+        },
+        threads);
+
+    std::size_t total = 0;
+    for (const auto& group : groups)
+    {
+        total += group.size();
+    }
+    std::vector<fs::path> files;
+    files.reserve(total);
+    for (auto& group : groups)
+    {
+        std::ranges::move(group, std::back_inserter(files));
+    }
+    return files;
+}
+
+// Regular files under `root` whose lowercase extension is one of `extensions`, sorted by path.
+// The tree is walked in parallel as WalkParallel does.
+[[nodiscard]] inline std::vector<std::filesystem::path> FindFiles(
+    const std::filesystem::path& root, const std::initializer_list<std::string_view> extensions,
+    const unsigned int threads = 0)
+{
+    auto files = WalkParallel(
+        std::span(&root, 1),
+        [&](const std::filesystem::directory_entry& entry) {
+            return std::ranges::contains(extensions, LowerExtension(entry.path()));
+        },
+        threads);
+    std::ranges::sort(files);
+    return files;
+}
+
+// Matches `name` against a shell-style pattern, where '*' stands for any run of characters and
+// '?' for any one character.
+[[nodiscard]] inline bool GlobMatch(const std::string_view pattern, const std::string_view name)
+{
+    std::size_t p = 0;
+    std::size_t n = 0;
+    std::size_t star = std::string_view::npos; // last '*' seen, retried with one more character
+    std::size_t resume = 0;
+    while (n < name.size())
+    {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n]))
+        {
+            ++p;
+            ++n;
+        }
+        else if (p < pattern.size() && pattern[p] == '*')
+        {
+            star = p++;
+            resume = n;
+        }
+        else if (star != std::string_view::npos)
+        {
+            p = star + 1;
+            n = ++resume;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*')
+    {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+// Regular files in the directory of `pattern` (not below it) whose name matches its last
+// component, sorted by path.  Only the file name may hold wildcards.
+[[nodiscard]] inline std::vector<std::filesystem::path> ExpandGlob(
+    const std::filesystem::path& pattern)
+{
+    namespace fs = std::filesystem;
+
+    const auto dir = pattern.has_parent_path() ? pattern.parent_path() : fs::path(".");
+    const auto name = pattern.filename().string();
+
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::directory_iterator(dir))
+    {
+        if (entry.is_regular_file() && GlobMatch(name, entry.path().filename().string()))
+        {
+            files.push_back(entry.path());
+        }
+    }
+    std::ranges::sort(files);
+    return files;
+}
+
+// Quotes a CSV field when it contains a separator, quote or line break.
+[[nodiscard]] inline std::string CsvField(const std::string_view field)
+{
+    if (field.find_first_of(",\"\r\n") == std::string_view::npos)
+    {
+        return std::string{field};
+    }
+
+    std::string quoted = "\"";
+    for (const char c : field)
+    {
+        quoted += c;
+        if (c == '"')
+        {
+            quoted += '"';
+        }
+    }
+    quoted += '"';
+    return quoted;
+}
+
+} // namespace wwtools::scan
@@ -0,0 +1,697 @@
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "soundbank.h"
+#include "wem/byte_reader.h"
+
+namespace
+{
+
+constexpr std::size_t g_section_header_size = 8;
+constexpr std::size_t g_didx_entry_size = 12;
+
+// type (u8) + length (u4); the length covers the ID and the payload
+constexpr std::size_t g_object_header_size = 5;
+
+// Banks from this version on store the event action count as a VLQ instead of a u4
+constexpr std::uint32_t g_vlq_event_count_version = 123;
+
+[[nodiscard]] std::uint32_t Load32(const std::span<const std::byte> data, const std::size_t offset)
+{
+    return wwtools::wem::Load<std::uint32_t, std::endian::little>(data, offset);
+}
+
+[[nodiscard]] std::uint8_t Load8(const std::span<const std::byte> data, const std::size_t offset)
+{
+    return std::to_integer<std::uint8_t>(data[offset]);
+}
+
+// Size of a bank source without the embedded file's offset and size: plugin ID, stream type,
+// WEM ID, source ID and the source bits byte.
+constexpr std::size_t g_source_size = 17;
+
+// A 40-byte music track playlist item: track and source IDs plus four f64 timings.
+constexpr std::size_t g_playlist_item_size = 40;
+
+// A music track clip automation point: two f32 and an interpolation u32.
+constexpr std::size_t g_automation_point_size = 12;
+
+// Reads a bank source at `offset`, returning it with its size (the embedded file's offset and
+// size follow the IDs only when the source is not streamed).  The source's offset is left
+// relative to `body`.
+[[nodiscard]] std::optional<std::pair<wwtools::bnk::TrackSource, std::size_t>> DecodeSource(
+    const std::span<const std::byte> body, const std::size_t offset)
+{
+    if (offset > body.size() || body.size() - offset < g_source_size)
+    {
+        return std::nullopt;
+    }
+    const wwtools::bnk::TrackSource source{.stream_type = Load32(body, offset + 4),
+                                           .wem_id = Load32(body, offset + 8),
+                                           .source_id = Load32(body, offset + 12),
+                                           .offset = static_cast<std::uint32_t>(offset)};
+    const std::size_t size = g_source_size + (source.stream_type == 0 ? 8 : 0);
+    if (body.size() - offset < size)
+    {
+        return std::nullopt;
+    }
+    return std::pair(source, size);
+}
+
+// Parent ID from the node parameters starting at `offset`: the parent follows the override
+// flag, effect count, optional effect block (bypass mask plus 7 bytes per effect) and the output
+// bus ID.  0 when the body is too short.
+[[nodiscard]] std::uint32_t NodeParent(const std::span<const std::byte> body,
+                                       const std::size_t offset)
+{
+    if (offset > body.size() || body.size() - offset < 2)
+    {
+        return 0;
+    }
+    const auto num_effects = Load8(body, offset + 1);
+    const std::size_t parent = offset + 6 + (num_effects > 0 ? 1 + num_effects * 7 : 0);
+    return body.size() >= parent + 4 ? Load32(body, parent) : 0;
+}
+
+// Skips a u4-counted table of fixed-size entries at `pos`, returning its entry count.
+[[nodiscard]] std::optional<std::uint32_t> SkipTable(const std::span<const std::byte> body,
+                                                     std::size_t& pos, const std::size_t entry_size)
+{
+    if (pos > body.size() || body.size() - pos < 4)
+    {
+        return std::nullopt;
+    }
+    const auto entries = Load32(body, pos);
+    if (static_cast<std::uint64_t>(entries) * entry_size > body.size() - pos - 4)
+    {
+        return std::nullopt;
+    }
+    pos += 4 + entries * entry_size;
+    return entries;
+}
+
+// Offset of a music track's node parameters, given the offset just past its sources: the
+// playlist items, a u4 sub-track count when there are items, and the clip automations (clip
+// index, type and a table of points).  nullopt when the tables run past the body.
+[[nodiscard]] std::optional<std::size_t> TrackNodeOffset(const std::span<const std::byte> body,
+                                                         std::size_t pos)
+{
+    const auto items = SkipTable(body, pos, g_playlist_item_size);
+    if (!items)
+    {
+        return std::nullopt;
+    }
+    if (*items != 0)
+    {
+        pos += 4;
+    }
+
+    if (pos > body.size() || body.size() - pos < 4)
+    {
+        return std::nullopt;
+    }
+    const auto automations = Load32(body, pos);
+    pos += 4;
+    for (std::uint32_t i = 0; i < automations; ++i)
+    {
+        pos += 8;
+        if (!SkipTable(body, pos, g_automation_point_size))
+        {
+            return std::nullopt;
+        }
+    }
+    return pos;
+}
+
+// Sound (type 2): a bank source followed by the node parameters.
+[[nodiscard]] std::optional<wwtools::bnk::SoundRecord> DecodeSound(
+    const std::span<const std::byte> body)
+{
+    if (body.size() < 16)
+    {
+        return std::nullopt;
+    }
+
+    const std::uint32_t stream_type = Load32(body, 4);
+    return wwtools::bnk::SoundRecord{
+        .stream_type = stream_type,
+        .wem_id = Load32(body, 8),
+        .source_id = Load32(body, 12),
+        .parent_id = NodeParent(body, g_source_size + (stream_type == 0 ? 8 : 0))};
+}
+
+// Event action (type 3): scope, action type and the targeted game object ID.
+[[nodiscard]] std::optional<wwtools::bnk::EventActionRecord> DecodeEventAction(
+    const std::span<const std::byte> body)
+{
+    if (body.size() < 6)
+    {
+        return std::nullopt;
+    }
+    return wwtools::bnk::EventActionRecord{.scope = Load8(body, 0),
+                                           .type = wwtools::bnk::ActionType{Load8(body, 1)},
+                                           .target_id = Load32(body, 2)};
+}
+
+// Event (type 4): the action count (u4, or a little-endian base-128 VLQ in newer banks) followed
+// by that many action IDs.  `body_offset` is the body's absolute offset in the bank.
+[[nodiscard]] std::optional<wwtools::bnk::EventRecord> DecodeEvent(
+    const std::span<const std::byte> body, const std::size_t body_offset,
+    const std::uint32_t version)
+{
+    std::uint64_t count = 0;
+    std::size_t pos = 0;
+    if (version >= g_vlq_event_count_version)
+    {
+        for (unsigned int shift = 0;; shift += 7)
+        {
+            if (pos >= body.size() || shift >= 64)
+            {
+                return std::nullopt;
+            }
+            const auto group = Load8(body, pos++);
+            count |= static_cast<std::uint64_t>(group & 0x7F) << shift;
+            if ((group & 0x80) == 0)
+            {
+                break;
+            }
+        }
+    }
+    else
+    {
+        if (body.size() < 4)
+        {
+            return std::nullopt;
+        }
+        count = Load32(body, 0);
+        pos = 4;
+    }
+
+    if (count > (body.size() - pos) / 4)
+    {
+        return std::nullopt;
+    }
+    const auto actions_offset = static_cast<std::uint32_t>(body_offset + pos);
+    return wwtools::bnk::EventRecord{.actions_offset = actions_offset,
+                                     .action_count = static_cast<std::uint32_t>(count)};
+}
+
+// First arena block: enough for the tables of a typical bank (records, ID index and hierarchy
+// take a few times the bytes they describe), so most parses make one or two upstream allocations.
+[[nodiscard]] std::size_t ArenaSizeHint(const std::span<const std::byte> data)
+{
+    constexpr std::size_t minimum = 1024;
+
+    std::size_t hint = minimum;
+    std::size_t offset = 0;
+    while (offset + g_section_header_size <= data.size())
+    {
+        const std::size_t length = Load32(data, offset + 4);
+        const auto* tag = data.data() + offset;
+        if (std::memcmp(tag, "HIRC", 4) == 0 || std::memcmp(tag, "DIDX", 4) == 0 ||
+            std::memcmp(tag, "STID", 4) == 0)
+        {
+            hint += 4 * std::min(length, data.size() - offset);
+        }
+        offset += g_section_header_size + length;
+    }
+    return hint;
+}
+
+// Throws unless [offset, offset + size) lies within `total` bytes.
+void CheckBounds(const std::size_t offset, const std::size_t size, const std::size_t total,
+                 const std::string_view what)
+{
+    if (offset > total || size > total - offset)
+    {
+        throw std::runtime_error(std::format("BNK {} truncated", what));
+    }
+}
+
+} // anonymous namespace
+
+namespace wwtools::bnk
+{
+
+Soundbank::Soundbank(const std::span<const std::byte> data, std::pmr::memory_resource* upstream)
+    : m_arena(std::make_unique<std::pmr::monotonic_buffer_resource>(ArenaSizeHint(data), upstream)),
+      m_data(data), m_data_index(m_arena.get()), m_objects(m_arena.get()), m_names(m_arena.get()),
+      m_track_sources(m_arena.get()), m_index(m_arena.get()), m_parents(m_arena.get()),
+      m_child_offsets(m_arena.get()), m_children(m_arena.get()), m_orphans(m_arena.get())
+{
+    // Only the first section of each type counts; DIDX is resolved once DATA is known since it
+    // usually precedes it
+    struct Section
+    {
+        std::size_t offset = 0;
+        std::size_t size = 0;
+        bool present = false;
+    };
+    Section bkhd;
+    Section didx;
+    Section data_section;
+    Section hirc;
+    Section stid;
+
+    std::size_t offset = 0;
+    while (offset + g_section_header_size <= data.size())
+    {
+        const auto length = Load32(data, offset + 4);
+        const Section section{.offset = offset + g_section_header_size, .size = length,
+                              .present = true};
+        CheckBounds(section.offset, section.size, data.size(), "section");
+
+        const auto* tag = data.data() + offset;
+        if (std::memcmp(tag, "BKHD", 4) == 0 && !bkhd.present)
+        {
+            bkhd = section;
+        }
+        else if (std::memcmp(tag, "DIDX", 4) == 0 && !didx.present)
+        {
+            didx = section;
+        }
+        else if (std::memcmp(tag, "DATA", 4) == 0 && !data_section.present)
+        {
+            data_section = section;
+        }
+        else if (std::memcmp(tag, "HIRC", 4) == 0 && !hirc.present)
+        {
+            hirc = section;
+        }
+        else if (std::memcmp(tag, "STID", 4) == 0 && !stid.present)
+        {
+            stid = section;
+        }
+
+        offset = section.offset + section.size;
+    }
+
+    m_has_data = data_section.present;
+    if (bkhd.present)
+    {
+        ParseHeader(bkhd.offset, bkhd.size);
+    }
+    if (didx.present)
+    {
+        ParseDataIndex(didx.offset, didx.size);
+        if (m_has_data)
+        {
+            for (auto& entry : m_data_index)
+            {
+                if (entry.offset + entry.size > data_section.size)
+                {
+                    throw std::runtime_error(
+                        std::format("DIDX entry {} lies outside DATA", entry.id));
+                }
+                entry.offset += data_section.offset;
+            }
+        }
+    }
+    if (hirc.present)
+    {
+        ParseHirc(hirc.offset, hirc.size);
+    }
+    BuildHierarchy();
+    if (stid.present)
+    {
+        ParseNames(stid.offset, stid.size);
+    }
+}
+
+void Soundbank::ParseHeader(const std::size_t offset, const std::size_t size)
+{
+    CheckBounds(offset, 8, offset + size, "BKHD");
+    m_has_header = true;
+    m_version = Load32(m_data, offset);
+    m_id = Load32(m_data, offset + 4);
+}
+
+void Soundbank::ParseDataIndex(const std::size_t offset, const std::size_t size)
+{
+    m_has_data_index = true;
+    m_data_index.reserve(size / g_didx_entry_size);
+    for (std::size_t pos = offset; pos + g_didx_entry_size <= offset + size;
+         pos += g_didx_entry_size)
+    {
+        m_data_index.push_back({.id = Load32(m_data, pos),
+                                .offset = Load32(m_data, pos + 4),
+                                .size = Load32(m_data, pos + 8)});
+    }
+}
+
+void Soundbank::ParseHirc(const std::size_t offset, const std::size_t size)
+{
+    CheckBounds(offset, 4, offset + size, "HIRC");
+    m_has_hirc = true;
+
+    const auto count = Load32(m_data, offset);
+    const auto end = offset + size;
+    m_objects.reserve(std::min<std::size_t>(count, size / (g_object_header_size + 4)));
+
+    std::size_t pos = offset + 4;
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        CheckBounds(pos, g_object_header_size + 4, end, "HIRC object");
+        const auto type = ObjectType{Load8(m_data, pos)};
+        const auto length = Load32(m_data, pos + 1);
+        if (length < 4)
+        {
+            throw std::runtime_error("BNK HIRC object truncated");
+        }
+        CheckBounds(pos + g_object_header_size, length, end, "HIRC object");
+
+        const std::size_t body_offset = pos + g_object_header_size + 4;
+        const auto body = m_data.subspan(body_offset, length - 4);
+
+        HircObject object{.type = type,
+                          .id = Load32(m_data, pos + g_object_header_size),
+                          .offset = static_cast<std::uint32_t>(body_offset),
+                          .size = static_cast<std::uint32_t>(body.size()),
+                          .data = std::monostate{}};
+        switch (type)
+        {
+        case ObjectType::Sound:
+            if (const auto sound = DecodeSound(body))
+            {
+                object.data = *sound;
+            }
+            break;
+        case ObjectType::EventAction:
+            if (const auto action = DecodeEventAction(body))
+            {
+                object.data = *action;
+            }
+            break;
+        case ObjectType::Event:
+            if (const auto event = DecodeEvent(body, body_offset, m_version))
+            {
+                object.data = *event;
+            }
+            break;
+        case ObjectType::RandomSequenceContainer:
+        case ObjectType::SwitchContainer:
+        case ObjectType::ActorMixer:
+        case ObjectType::BlendContainer:
+        case ObjectType::MusicSegment:
+        case ObjectType::MusicSwitchContainer:
+        case ObjectType::MusicPlaylistContainer:
+            // These all open with the node parameters
+            object.data = NodeRecord{.parent_id = NodeParent(body, 0)};
+            break;
+        case ObjectType::MusicTrack:
+            DecodeMusicTrack(object, body);
+            break;
+        default:
+            break;
+        }
+        m_objects.push_back(object);
+
+        pos += g_object_header_size + length;
+    }
+}
+
+// Music track (type 11): u4 source count and the sources, then the tables TrackNodeOffset skips
+// and the node parameters.  The sources are kept even when the rest does not parse.
+void Soundbank::DecodeMusicTrack(HircObject& object, const std::span<const std::byte> body)
+{
+    if (body.size() < 4)
+    {
+        return;
+    }
+
+    const auto first_source = static_cast<std::uint32_t>(m_track_sources.size());
+    const auto count = Load32(body, 0);
+    std::size_t pos = 4;
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        const auto source = DecodeSource(body, pos);
+        if (!source)
+        {
+            m_track_sources.resize(first_source);
+            return;
+        }
+        m_track_sources.push_back(source->first);
+        m_track_sources.back().offset += object.offset;
+        pos += source->second;
+    }
+
+    const auto node = TrackNodeOffset(body, pos);
+    object.data = MusicTrackRecord{.parent_id = node ? NodeParent(body, *node) : 0,
+                                   .first_source = first_source,
+                                   .source_count = count};
+}
+
+// STID: u4 (always 1), u4 count, then (u4 ID, u1 length, name) entries.
+void Soundbank::ParseNames(const std::size_t offset, const std::size_t size)
+{
+    const auto end = offset + size;
+    CheckBounds(offset, 8, end, "STID");
+
+    const auto count = Load32(m_data, offset + 4);
+    m_names.reserve(std::min<std::size_t>(count, (size - 8) / 5));
+
+    std::size_t pos = offset + 8;
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        CheckBounds(pos, 5, end, "STID entry");
+        const auto id = Load32(m_data, pos);
+        const auto length = Load8(m_data, pos + 4);
+        CheckBounds(pos + 5, length, end, "STID entry");
+
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        const auto* name = reinterpret_cast<const char*>(m_data.data() + pos + 5);
+        m_names.push_back({.id = id, .name = std::string_view(name, length)});
+        pos += 5 + length;
+    }
+}
+
+// Links every object to its parent by index and lays the children out in CSR form, all in
+// linear time.
+void Soundbank::BuildHierarchy()
+{
+    const auto count = static_cast<std::uint32_t>(m_objects.size());
+
+    m_index.reserve(count);
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        m_index.try_emplace(m_objects[i].id, i);
+    }
+
+    m_parents.assign(count, g_no_object);
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        const auto parent_id = std::visit(
+            [](const auto& record) -> std::uint32_t {
+                if constexpr (requires { record.parent_id; })
+                {
+                    return record.parent_id;
+                }
+                return 0;
+            },
+            m_objects[i].data);
+        if (parent_id == 0)
+        {
+            continue;
+        }
+        if (const auto it = m_index.find(parent_id); it != m_index.end())
+        {
+            m_parents[i] = it->second;
+        }
+        else
+        {
+            m_orphans.emplace_back(parent_id, i);
+        }
+    }
+    std::ranges::sort(m_orphans);
+
+    // Drop links closing a cycle: follow each unvisited chain upwards and cut it where it runs
+    // into itself
+    enum class Mark : std::uint8_t
+    {
+        Unvisited,
+        OnPath,
+        Done,
+    };
+    std::vector<Mark> marks(count, Mark::Unvisited);
+    std::vector<std::uint32_t> path;
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        path.clear();
+        for (auto node = i; node != g_no_object && marks[node] != Mark::Done;
+             node = m_parents[node])
+        {
+            if (marks[node] == Mark::OnPath)
+            {
+                m_parents[path.back()] = g_no_object;
+                break;
+            }
+            marks[node] = Mark::OnPath;
+            path.push_back(node);
+        }
+        for (const auto node : path)
+        {
+            marks[node] = Mark::Done;
+        }
+    }
+
+    m_child_offsets.assign(count + 1, 0);
+    for (const auto parent : m_parents)
+    {
+        if (parent != g_no_object)
+        {
+            ++m_child_offsets[parent + 1];
+        }
+    }
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        m_child_offsets[i + 1] += m_child_offsets[i];
+    }
+
+    m_children.resize(m_child_offsets[count]);
+    std::vector<std::uint32_t> fill(m_child_offsets.begin(), m_child_offsets.end() - 1);
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        if (m_parents[i] != g_no_object)
+        {
+            m_children[fill[m_parents[i]]++] = i;
+        }
+    }
+}
+
+[[nodiscard]] std::optional<std::size_t> Soundbank::Find(const std::uint32_t id) const
+{
+    const auto it = m_index.find(id);
+    if (it == m_index.end())
+    {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void Soundbank::ResolveWems(const std::size_t index, std::vector<ResolvedWem>& out) const
+{
+    ResolveFrom(index, 0, out);
+}
+
+void Soundbank::ResolveTarget(const std::uint32_t id, std::vector<ResolvedWem>& out) const
+{
+    if (const auto index = Find(id))
+    {
+        ResolveFrom(*index, 0, out);
+        return;
+    }
+
+    const auto [first, last] = std::ranges::equal_range(
+        m_orphans, id, {}, [](const auto& orphan) { return orphan.first; });
+    for (const auto& [parent_id, index] : std::ranges::subrange(first, last))
+    {
+        ResolveFrom(index, 1, out);
+    }
+}
+
+void Soundbank::ResolveFrom(const std::size_t index, const std::uint32_t depth,
+                            std::vector<ResolvedWem>& out) const
+{
+    struct Pending
+    {
+        std::uint32_t object;
+        std::uint32_t depth;
+    };
+    std::vector<Pending> stack{{static_cast<std::uint32_t>(index), depth}};
+
+    while (!stack.empty())
+    {
+        const auto [object, object_depth] = stack.back();
+        stack.pop_back();
+
+        const auto& data = m_objects[object].data;
+        if (const auto* sound = std::get_if<SoundRecord>(&data))
+        {
+            out.push_back({.wem_id = sound->wem_id,
+                           .object = object,
+                           .depth = object_depth,
+                           .streamed = sound->stream_type != 0});
+        }
+        else if (const auto* track = std::get_if<MusicTrackRecord>(&data))
+        {
+            for (const auto& source : TrackSources(*track))
+            {
+                out.push_back({.wem_id = source.wem_id,
+                               .object = object,
+                               .depth = object_depth,
+                               .streamed = source.stream_type != 0});
+            }
+        }
+
+        // Pushed in reverse so children come off the stack in HIRC order
+        const auto children = Children(object);
+        for (auto it = children.rbegin(); it != children.rend(); ++it)
+        {
+            stack.push_back({*it, object_depth + 1});
+        }
+    }
+}
+
+[[nodiscard]] std::vector<std::uint32_t> Soundbank::StreamedWemIds() const
+{
+    std::vector<std::uint32_t> ids;
+    for (const auto& object : m_objects)
+    {
+        if (const auto* sound = std::get_if<SoundRecord>(&object.data))
+        {
+            if (sound->stream_type != 0)
+            {
+                ids.push_back(sound->wem_id);
+            }
+        }
+        else if (const auto* track = std::get_if<MusicTrackRecord>(&object.data))
+        {
+            for (const auto& source : TrackSources(*track))
+            {
+                if (source.stream_type != 0)
+                {
+                    ids.push_back(source.wem_id);
+                }
+            }
+        }
+    }
+    return ids;
+}
+
+[[nodiscard]] std::uint32_t Soundbank::EventActionId(const EventRecord& event,
+                                                     const std::size_t index) const
+{
+    return Load32(m_data, event.actions_offset + index * 4);
+}
+
+[[nodiscard]] std::string_view ActionTypeName(const ActionType type)
+{
+    switch (type)
+    {
+    case ActionType::Stop:
+        return "stop";
+    case ActionType::Pause:
+        return "pause";
+    case ActionType::Resume:
+        return "resume";
+    case ActionType::Play:
+        return "play";
+    default:
+        return {};
+    }
+}
+
+} // namespace wwtools::bnk
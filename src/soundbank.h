@@ -0,0 +1,279 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "bnk.h"
+
+// Zero-copy BNK parser (see ksy/bnk.ksy for the layout).
+//
+// Sections are a 4-byte tag plus a LE u32 length.  HIRC objects are decoded once into compact
+// tagged records holding offsets into the input instead of copies, so a Soundbank is only valid
+// while the bytes it was constructed from are.  All tables live in a monotonic arena owned by the
+// Soundbank and are released in one go when it is destroyed.
+namespace wwtools::bnk
+{
+
+enum class ObjectType : std::uint8_t
+{
+    Settings = 1,
+    Sound = 2,
+    EventAction = 3,
+    Event = 4,
+    RandomSequenceContainer = 5,
+    SwitchContainer = 6,
+    ActorMixer = 7,
+    AudioBus = 8,
+    BlendContainer = 9,
+    MusicSegment = 10,
+    MusicTrack = 11,
+    MusicSwitchContainer = 12,
+    MusicPlaylistContainer = 13,
+    Attenuation = 14,
+    DialogueEvent = 15,
+    MotionBus = 16,
+    MotionFx = 17,
+    Effect = 18,
+    Unknown = 19,
+    AuxiliaryBus = 20,
+};
+
+// Event action types with a dedicated label; other values are kept as-is.
+enum class ActionType : std::uint8_t
+{
+    Stop = 1,
+    Pause = 2,
+    Resume = 3,
+    Play = 4,
+};
+
+// "stop", "pause", "resume" or "play"; empty for the other action types.
+[[nodiscard]] std::string_view ActionTypeName(ActionType type);
+
+// Sound effect or voice (HIRC type 2).
+struct SoundRecord
+{
+    std::uint32_t stream_type; // 0 = embedded, otherwise streamed / prefetched
+    std::uint32_t wem_id;
+    std::uint32_t source_id;
+    std::uint32_t parent_id; // 0 when the sound structure is too short to hold one
+};
+
+// Event action (HIRC type 3).
+struct EventActionRecord
+{
+    std::uint8_t scope;
+    ActionType type;
+    std::uint32_t target_id; // game object the action applies to
+};
+
+// Event (HIRC type 4); the action IDs stay in the input, see Soundbank::EventActionId.
+struct EventRecord
+{
+    std::uint32_t actions_offset;
+    std::uint32_t action_count;
+};
+
+// Container or music node without sources of its own: random/sequence, switch and blend
+// containers, actor-mixers, music segments, music switch and playlist containers.
+struct NodeRecord
+{
+    std::uint32_t parent_id; // 0 when the node parameters are too short to hold one
+};
+
+// One source of a music track.
+struct TrackSource
+{
+    std::uint32_t stream_type; // 0 = embedded, otherwise streamed / prefetched
+    std::uint32_t wem_id;
+    std::uint32_t source_id;
+    std::uint32_t offset; // where the source starts, absolute in the bank
+};
+
+// Music track (HIRC type 11); its sources are Soundbank::TrackSources(record).
+struct MusicTrackRecord
+{
+    std::uint32_t parent_id; // 0 when the track layout could not be walked up to it
+    std::uint32_t first_source;
+    std::uint32_t source_count;
+};
+
+struct HircObject
+{
+    ObjectType type;
+    std::uint32_t id;
+    std::uint32_t offset; // object payload following the ID, absolute in the bank
+    std::uint32_t size;
+    // Decoded fields for the types above; monostate for other types and for bodies too short to
+    // decode
+    std::variant<std::monostate, SoundRecord, EventActionRecord, EventRecord, NodeRecord,
+                 MusicTrackRecord>
+        data;
+};
+
+// Object index standing for "no object" in the hierarchy.
+inline constexpr std::uint32_t g_no_object = 0xFFFFFFFF;
+
+// A WEM reached from a hierarchy node, see Soundbank::ResolveWems.
+struct ResolvedWem
+{
+    std::uint32_t wem_id;
+    std::uint32_t object; // index of the sound or music track playing it
+    std::uint32_t depth;  // 0 when that object is the node resolved from
+    bool streamed;
+};
+
+// STID entry.
+struct NameEntry
+{
+    std::uint32_t id;
+    std::string_view name; // points into the input
+};
+
+class Soundbank
+{
+    // Declared first so it outlives the containers allocated from it; boxed so moving a
+    // Soundbank keeps the containers' memory resource at a stable address
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> m_arena;
+
+    std::span<const std::byte> m_data;
+    std::uint32_t m_version = 0;
+    std::uint32_t m_id = 0;
+    bool m_has_header = false;
+    bool m_has_data_index = false;
+    bool m_has_data = false;
+    bool m_has_hirc = false;
+    std::pmr::vector<DataIndexEntry> m_data_index;
+    std::pmr::vector<HircObject> m_objects;
+    std::pmr::vector<NameEntry> m_names;
+    std::pmr::vector<TrackSource> m_track_sources;
+
+    // Hierarchy: ID lookup, parent links as object indices and the children of each object in
+    // CSR form (m_children[m_child_offsets[i] .. m_child_offsets[i + 1]])
+    std::pmr::unordered_map<std::uint32_t, std::uint32_t> m_index;
+    std::pmr::vector<std::uint32_t> m_parents;
+    std::pmr::vector<std::uint32_t> m_child_offsets;
+    std::pmr::vector<std::uint32_t> m_children;
+    // (parent ID, object index) of objects whose parent is not in this bank, sorted
+    std::pmr::vector<std::pair<std::uint32_t, std::uint32_t>> m_orphans;
+
+    void ParseHeader(std::size_t offset, std::size_t size);
+    void ParseDataIndex(std::size_t offset, std::size_t size);
+    void ParseHirc(std::size_t offset, std::size_t size);
+    void ParseNames(std::size_t offset, std::size_t size);
+    void DecodeMusicTrack(HircObject& object, std::span<const std::byte> body);
+    void BuildHierarchy();
+    void ResolveFrom(std::size_t index, std::uint32_t depth, std::vector<ResolvedWem>& out) const;
+
+public:
+    // Throws std::runtime_error when a section, HIRC object or DIDX entry runs past its bounds.
+    // The arena takes its blocks from `upstream`, e.g. a reusable buffer when parsing many banks.
+    explicit Soundbank(std::span<const std::byte> data,
+                       std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+
+    // Moving keeps the arena; assignment would have to rebind the tables to another arena.
+    Soundbank(Soundbank&&) noexcept = default;
+    Soundbank& operator=(Soundbank&&) = delete;
+    Soundbank(const Soundbank&) = delete;
+    Soundbank& operator=(const Soundbank&) = delete;
+    ~Soundbank() = default;
+
+    [[nodiscard]] bool HasHeader() const
+    {
+        return m_has_header;
+    }
+
+    [[nodiscard]] bool HasDataIndex() const
+    {
+        return m_has_data_index;
+    }
+
+    [[nodiscard]] bool HasData() const
+    {
+        return m_has_data;
+    }
+
+    [[nodiscard]] bool HasHirc() const
+    {
+        return m_has_hirc;
+    }
+
+    [[nodiscard]] std::uint32_t Version() const
+    {
+        return m_version;
+    }
+
+    [[nodiscard]] std::uint32_t Id() const
+    {
+        return m_id;
+    }
+
+    // DIDX entries; offsets are absolute in the bank when DATA is present, otherwise relative to
+    // the missing DATA payload.
+    [[nodiscard]] std::span<const DataIndexEntry> DataIndex() const
+    {
+        return m_data_index;
+    }
+
+    [[nodiscard]] std::span<const HircObject> Objects() const
+    {
+        return m_objects;
+    }
+
+    [[nodiscard]] std::span<const NameEntry> Names() const
+    {
+        return m_names;
+    }
+
+    // Zero-copy view of an embedded WEM (full file or prefetch stub).
+    [[nodiscard]] std::span<const std::byte> Wem(const DataIndexEntry& entry) const
+    {
+        return m_data.subspan(entry.offset, entry.size);
+    }
+
+    [[nodiscard]] std::uint32_t EventActionId(const EventRecord& event, std::size_t index) const;
+
+    [[nodiscard]] std::span<const TrackSource> TrackSources(const MusicTrackRecord& track) const
+    {
+        return std::span(m_track_sources).subspan(track.first_source, track.source_count);
+    }
+
+    // Index of the object with this ID (the first one if the ID repeats).
+    [[nodiscard]] std::optional<std::size_t> Find(std::uint32_t id) const;
+
+    // Parent object index, or g_no_object for roots and parents outside this bank.  Parent links
+    // that would close a cycle in a malformed bank are dropped, so the hierarchy is a forest.
+    [[nodiscard]] std::uint32_t Parent(const std::size_t index) const
+    {
+        return m_parents[index];
+    }
+
+    // Child object indices in HIRC order.
+    [[nodiscard]] std::span<const std::uint32_t> Children(const std::size_t index) const
+    {
+        return std::span(m_children)
+            .subspan(m_child_offsets[index], m_child_offsets[index + 1] - m_child_offsets[index]);
+    }
+
+    // Appends the WEMs played by an object and all of its descendants, depth-first in HIRC
+    // order; linear in the size of the subtree.
+    void ResolveWems(std::size_t index, std::vector<ResolvedWem>& out) const;
+
+    // Appends the WEMs an action targeting `id` plays: that object's subtree, or for a container
+    // stored in another bank the subtrees of the objects here naming it as their parent.
+    void ResolveTarget(std::uint32_t id, std::vector<ResolvedWem>& out) const;
+
+    // WEM IDs of every streamed sound and music track source.
+    [[nodiscard]] std::vector<std::uint32_t> StreamedWemIds() const;
+};
+
+} // namespace wwtools::bnk
@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "soundbank.h"
+#include "soundbank_writer.h"
+#include "wem/byte_reader.h"
+
+namespace
+{
+
+constexpr std::size_t g_section_header_size = 8;
+constexpr std::size_t g_didx_entry_size = 12;
+
+// An embedded source's media offset and size (u4 each) follow its plugin ID, stream type, WEM ID
+// and source ID
+constexpr std::size_t g_media_field_offset = 16;
+
+// Media alignment for banks whose offsets do not reveal one (Wwise's default), and the largest
+// one inferred
+constexpr std::uint32_t g_default_alignment = 16;
+constexpr std::uint32_t g_max_alignment = 4096;
+
+constexpr std::array<std::byte, g_max_alignment> g_padding{};
+
+[[nodiscard]] std::uint32_t Load32(const std::span<const std::byte> data, const std::size_t offset)
+{
+    return wwtools::wem::Load<std::uint32_t, std::endian::little>(data, offset);
+}
+
+void Store32(std::vector<std::byte>& out, const std::uint32_t value)
+{
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        out.push_back(static_cast<std::byte>(value >> shift));
+    }
+}
+
+// Payload position of a section.
+struct SectionSpan
+{
+    std::size_t offset = 0;
+    std::size_t size = 0;
+    bool present = false;
+};
+
+// Bytes [begin, end) of the bank replaced by `pieces`.
+struct Splice
+{
+    std::size_t begin;
+    std::size_t end;
+    std::vector<std::span<const std::byte>> pieces;
+};
+
+// Largest power of two, up to g_max_alignment, dividing every media offset.
+[[nodiscard]] std::uint32_t MediaAlignment(const std::span<const std::uint32_t> offsets)
+{
+    const auto combined = std::reduce(offsets.begin(), offsets.end(), std::uint32_t{0},
+                                      std::bit_or<std::uint32_t>{});
+    if (combined == 0)
+    {
+        return g_default_alignment;
+    }
+    return std::min(std::uint32_t{1} << std::countr_zero(combined), g_max_alignment);
+}
+
+[[nodiscard]] std::uint64_t AlignUp(const std::uint64_t value, const std::uint32_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // anonymous namespace
+
+namespace wwtools::bnk
+{
+
+void SoundbankWriter::Append(const std::span<const std::byte> piece)
+{
+    if (piece.empty())
+    {
+        return;
+    }
+    m_size += piece.size();
+
+    // Neighbouring ranges of the same buffer go out as one piece
+    if (!m_pieces.empty() && m_pieces.back().data() + m_pieces.back().size() == piece.data())
+    {
+        m_pieces.back() = {m_pieces.back().data(), m_pieces.back().size() + piece.size()};
+        return;
+    }
+    m_pieces.push_back(piece);
+}
+
+SoundbankWriter::SoundbankWriter(
+    const std::span<const std::byte> bank,
+    const std::unordered_map<std::uint32_t, std::span<const std::byte>>& wems)
+{
+    // Validates the whole layout and locates the HIRC sources; DATA itself is not read
+    const Soundbank parsed(bank);
+
+    SectionSpan didx;
+    SectionSpan data_section;
+    for (std::size_t offset = 0; offset + g_section_header_size <= bank.size();)
+    {
+        const SectionSpan section{
+            .offset = offset + g_section_header_size, .size = Load32(bank, offset + 4),
+            .present = true};
+        const auto* tag = bank.data() + offset;
+        if (std::memcmp(tag, "DIDX", 4) == 0 && !didx.present)
+        {
+            didx = section;
+        }
+        else if (std::memcmp(tag, "DATA", 4) == 0 && !data_section.present)
+        {
+            data_section = section;
+        }
+        offset = section.offset + section.size;
+    }
+    if (!didx.present || !data_section.present)
+    {
+        throw std::runtime_error("BNK has no embedded WEMs (DIDX or DATA missing)");
+    }
+
+    const auto entries = parsed.DataIndex();
+    std::unordered_map<std::uint32_t, std::size_t> entry_index;
+    entry_index.reserve(entries.size());
+    std::vector<std::uint32_t> old_offsets(entries.size());
+    for (std::size_t i = 0; i < entries.size(); ++i)
+    {
+        entry_index.emplace(entries[i].id, i);
+        old_offsets[i] = static_cast<std::uint32_t>(entries[i].offset - data_section.offset);
+    }
+    for (const auto& [id, payload] : wems)
+    {
+        if (!entry_index.contains(id))
+        {
+            throw std::runtime_error(std::format("WEM {} is not embedded in the bank", id));
+        }
+        if (payload.size() > std::numeric_limits<std::uint32_t>::max())
+        {
+            throw std::runtime_error(std::format("WEM {} is too large for a bank", id));
+        }
+    }
+
+    // Lay DATA out again in its original order.  Up to the first replaced WEM nothing moves and
+    // the original bytes, padding included, are kept as one range
+    std::vector<std::size_t> order(entries.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::ranges::stable_sort(order, {}, [&](const std::size_t i) { return old_offsets[i]; });
+
+    const auto alignment = MediaAlignment(old_offsets);
+    auto new_offsets = old_offsets;
+    std::vector<std::uint32_t> new_sizes(entries.size());
+    std::vector<std::span<const std::byte>> data_pieces;
+    std::uint64_t data_size = 0;
+    bool in_place = true;
+
+    for (const auto i : order)
+    {
+        const auto replacement = wems.find(entries[i].id);
+        if (in_place && replacement == wems.end() && old_offsets[i] >= data_size)
+        {
+            new_sizes[i] = entries[i].size;
+            data_size = std::uint64_t{old_offsets[i]} + entries[i].size;
+            continue;
+        }
+        if (in_place)
+        {
+            data_pieces.push_back(bank.subspan(data_section.offset, data_size));
+            in_place = false;
+        }
+
+        const auto payload =
+            replacement == wems.end() ? parsed.Wem(entries[i]) : replacement->second;
+        const auto aligned = AlignUp(data_size, alignment);
+        if (aligned + payload.size() > std::numeric_limits<std::uint32_t>::max())
+        {
+            throw std::runtime_error("BNK DATA section too large");
+        }
+        data_pieces.push_back(std::span(g_padding).first(aligned - data_size));
+        data_pieces.push_back(payload);
+        new_offsets[i] = static_cast<std::uint32_t>(aligned);
+        new_sizes[i] = static_cast<std::uint32_t>(payload.size());
+        data_size = aligned + payload.size();
+    }
+
+    std::vector<Splice> splices;
+    const auto own = [&](std::vector<std::byte> bytes) -> std::span<const std::byte> {
+        return m_owned.emplace_back(std::move(bytes));
+    };
+
+    if (!in_place)
+    {
+        // The DATA length, then its payload; anything that trailed the last WEM is dropped
+        std::vector<std::byte> length;
+        Store32(length, static_cast<std::uint32_t>(data_size));
+        splices.push_back({.begin = data_section.offset - 4,
+                           .end = data_section.offset + data_section.size,
+                           .pieces = {own(std::move(length))}});
+        splices.back().pieces.insert(splices.back().pieces.end(), data_pieces.begin(),
+                                     data_pieces.end());
+
+        std::vector<std::byte> index;
+        index.reserve(entries.size() * g_didx_entry_size);
+        for (std::size_t i = 0; i < entries.size(); ++i)
+        {
+            Store32(index, entries[i].id);
+            Store32(index, new_offsets[i]);
+            Store32(index, new_sizes[i]);
+        }
+        splices.push_back({.begin = didx.offset,
+                           .end = didx.offset + entries.size() * g_didx_entry_size,
+                           .pieces = {own(std::move(index))}});
+    }
+
+    // Embedded sources pointing at a WEM's old location move with it
+    const auto relocate = [&](const std::uint32_t wem_id, const std::size_t source) {
+        const auto entry = entry_index.find(wem_id);
+        if (entry == entry_index.end())
+        {
+            return;
+        }
+        const auto i = entry->second;
+        const auto field = source + g_media_field_offset;
+        if ((new_offsets[i] == old_offsets[i] && new_sizes[i] == entries[i].size) ||
+            Load32(bank, field) != old_offsets[i] || Load32(bank, field + 4) != entries[i].size)
+        {
+            return;
+        }
+        std::vector<std::byte> location;
+        Store32(location, new_offsets[i]);
+        Store32(location, new_sizes[i]);
+        splices.push_back({.begin = field, .end = field + 8, .pieces = {own(std::move(location))}});
+    };
+
+    for (const auto& object : parsed.Objects())
+    {
+        if (const auto* sound = std::get_if<SoundRecord>(&object.data))
+        {
+            // DecodeSound only checks the IDs, so make sure the media fields are there
+            if (sound->stream_type == 0 && object.size >= g_media_field_offset + 8)
+            {
+                relocate(sound->wem_id, object.offset);
+            }
+        }
+        else if (const auto* track = std::get_if<MusicTrackRecord>(&object.data))
+        {
+            for (const auto& source : parsed.TrackSources(*track))
+            {
+                if (source.stream_type == 0)
+                {
+                    relocate(source.wem_id, source.offset);
+                }
+            }
+        }
+    }
+
+    // Splices never overlap: they cover distinct sections or distinct HIRC sources
+    std::ranges::sort(splices, {}, &Splice::begin);
+    std::size_t cursor = 0;
+    for (const auto& splice : splices)
+    {
+        Append(bank.subspan(cursor, splice.begin - cursor));
+        for (const auto piece : splice.pieces)
+        {
+            Append(piece);
+        }
+        cursor = splice.end;
+    }
+    Append(bank.subspan(cursor));
+}
+
+} // namespace wwtools::bnk
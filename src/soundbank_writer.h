@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "output_sink.h"
+
+// Rewrites a BNK with some of its embedded WEMs replaced, without re-serializing it.
+//
+// Only DIDX, the DATA section length and the HIRC fields locating embedded media are rebuilt.
+// Everything else, untouched WEMs included, stays a reference into the input and is written
+// straight through, so patching a few WEMs of a large bank costs about as much as copying it.
+namespace wwtools::bnk
+{
+
+class SoundbankWriter
+{
+    // The output as a scatter list over the input, the new payloads and m_owned
+    std::vector<std::span<const std::byte>> m_pieces;
+    std::deque<std::vector<std::byte>> m_owned; // rebuilt bytes; a deque keeps them in place
+    std::uint64_t m_size = 0;
+
+    void Append(std::span<const std::byte> piece);
+
+public:
+    // Lays out `bank` with the WEMs in `wems` (by ID) replaced: WEMs after the first replaced one
+    // move to the bank's media alignment, and DIDX entries and embedded HIRC sources follow them.
+    // The bank and the payloads must outlive the writer.  Throws std::runtime_error when the bank
+    // is malformed or lacks DIDX/DATA, or when a WEM ID has no DIDX entry.
+    SoundbankWriter(std::span<const std::byte> bank,
+                    const std::unordered_map<std::uint32_t, std::span<const std::byte>>& wems);
+
+    // The pieces point into m_owned, which moves along but would not be copied
+    SoundbankWriter(SoundbankWriter&&) noexcept = default;
+    SoundbankWriter& operator=(SoundbankWriter&&) noexcept = default;
+    SoundbankWriter(const SoundbankWriter&) = delete;
+    SoundbankWriter& operator=(const SoundbankWriter&) = delete;
+    ~SoundbankWriter() = default;
+
+    // The rewritten bank, in order.
+    [[nodiscard]] std::span<const std::span<const std::byte>> Pieces() const
+    {
+        return m_pieces;
+    }
+
+    [[nodiscard]] std::uint64_t Size() const
+    {
+        return m_size;
+    }
+
+    void Write(OutputSink& out) const
+    {
+        out.Reserve(m_size);
+        out.WriteGather(m_pieces);
+    }
+};
+
+} // namespace wwtools::bnk
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string_view>
+
+// Version of this build, stored in manifests and reverse indexes so that whatever an older build
+// recorded is redone.  WWTOOLS_VERSION is defined for the library's own sources only.
+namespace wwtools
+{
+
+inline constexpr std::string_view g_tool_version = WWTOOLS_VERSION;
+
+} // namespace wwtools
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+
+#include "w3sc.h"
+#include "wem/byte_reader.h"
+
+namespace
+{
+
+constexpr std::size_t g_magic_size = 4;
+
+// Reads the version-dependent offset/size fields (u4 in version 1, u8 afterwards).
+class FieldReader
+{
+    std::span<const std::byte> m_data;
+    std::size_t m_width;
+
+public:
+    FieldReader(const std::span<const std::byte> data, const std::uint32_t version)
+        : m_data(data), m_width(version == 1 ? 4 : 8)
+    {
+    }
+
+    [[nodiscard]] std::size_t Width() const
+    {
+        return m_width;
+    }
+
+    [[nodiscard]] std::uint64_t Read(const std::size_t offset) const
+    {
+        if (offset + m_width > m_data.size())
+        {
+            throw std::runtime_error("sound cache truncated");
+        }
+        if (m_width == 4)
+        {
+            return wwtools::wem::Load<std::uint32_t, std::endian::little>(m_data, offset);
+        }
+        return wwtools::wem::Load<std::uint64_t, std::endian::little>(m_data, offset);
+    }
+};
+
+} // anonymous namespace
+
+namespace wwtools::w3sc
+{
+
+SoundCache::SoundCache(const std::filesystem::path& path) : m_file(path)
+{
+    const auto data = m_file.Bytes();
+
+    constexpr std::size_t version_offset = g_magic_size;
+    constexpr std::size_t fields_offset = version_offset + 4 + 8; // version + dummy
+    if (data.size() < fields_offset || std::memcmp(data.data(), "CS3W", g_magic_size) != 0)
+    {
+        throw std::runtime_error(std::format("{} is not a sound cache", path.string()));
+    }
+
+    m_version = wem::Load<std::uint32_t, std::endian::little>(data, version_offset);
+    const FieldReader fields(data, m_version);
+    const auto width = fields.Width();
+
+    const auto info_offset = fields.Read(fields_offset);
+    const auto count = fields.Read(fields_offset + width);
+    const auto names_offset = fields.Read(fields_offset + 2 * width);
+    const auto names_size = fields.Read(fields_offset + 3 * width);
+
+    const auto info_size = 3 * width;
+    if (!wem::InBounds(names_offset, names_size, data.size()) ||
+        count > (data.size() - std::min<std::uint64_t>(info_offset, data.size())) / info_size)
+    {
+        throw std::runtime_error("sound cache tables out of bounds");
+    }
+
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const std::string_view names(reinterpret_cast<const char*>(data.data() + names_offset),
+                                 static_cast<std::size_t>(names_size));
+
+    m_entries.reserve(static_cast<std::size_t>(count));
+    for (std::uint64_t i = 0; i < count; ++i)
+    {
+        const auto base = static_cast<std::size_t>(info_offset + i * info_size);
+        const auto name_offset = fields.Read(base);
+        const auto offset = fields.Read(base + width);
+        const auto size = fields.Read(base + 2 * width);
+
+        if (name_offset >= names.size() || !wem::InBounds(offset, size, data.size()))
+        {
+            throw std::runtime_error(std::format("sound cache entry {} out of bounds", i));
+        }
+
+        auto name = names.substr(static_cast<std::size_t>(name_offset));
+        name = name.substr(0, name.find('\0'));
+        m_entries.push_back({.name = name, .offset = offset, .size = size});
+    }
+}
+
+} // namespace wwtools::w3sc
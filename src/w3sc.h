@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "mapped_file.h"
+
+// Reader for Witcher 3 sound caches ("CS3W" .cache archives, see ksy/w3sc.ksy).
+//
+// Layout (little-endian): "CS3W", u4 version, u8 dummy, then info_offset, file count,
+// names_offset and names_size, followed by a file_info table of (name_offset, offset, size).
+// Version 1 stores those fields as u4, later versions as u8.  Names are NUL-terminated strings
+// at names_offset + name_offset.
+namespace wwtools::w3sc
+{
+
+struct Entry
+{
+    std::string_view name; // points into the mapped names blob
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+// Memory-maps a cache and indexes its entries without touching any payload.
+class SoundCache
+{
+    MappedFile m_file;
+    std::uint32_t m_version = 0;
+    std::vector<Entry> m_entries;
+
+public:
+    // Throws std::system_error if the file cannot be mapped and std::runtime_error if it is not a
+    // well-formed sound cache.
+    explicit SoundCache(const std::filesystem::path& path);
+
+    [[nodiscard]] std::uint32_t Version() const
+    {
+        return m_version;
+    }
+
+    [[nodiscard]] std::span<const Entry> Entries() const
+    {
+        return m_entries;
+    }
+
+    // Zero-copy view of an entry's payload, valid while this SoundCache lives.
+    [[nodiscard]] std::span<const std::byte> Data(const Entry& entry) const
+    {
+        return m_file.Bytes().subspan(entry.offset, entry.size);
+    }
+
+    [[nodiscard]] std::string_view View(const Entry& entry) const
+    {
+        return m_file.View().substr(entry.offset, entry.size);
+    }
+};
+
+} // namespace wwtools::w3sc
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+// Bounds-unchecked fixed-endian loads from a contiguous byte buffer, and the range check that
+// guards them when the offsets come from the data itself.
+namespace wwtools::wem
+{
+
+// True when [offset, offset + size) lies within a buffer of `total` bytes.
+[[nodiscard]] inline bool InBounds(const std::uint64_t offset, const std::uint64_t size,
+                                   const std::uint64_t total)
+{
+    return offset <= total && size <= total - offset;
+}
+
+// Reads a T stored in `Order` byte order at `offset`; the caller guarantees the bytes exist.
+template <typename T, std::endian Order>
+    requires std::is_integral_v<T>
+[[nodiscard]] inline T Load(const std::span<const std::byte> data, const std::size_t offset)
+{
+    T value{};
+    std::memcpy(&value, data.data() + offset, sizeof(T));
+    if constexpr (Order != std::endian::native)
+    {
+        value = std::byteswap(value);
+    }
+    return value;
+}
+
+} // namespace wwtools::wem
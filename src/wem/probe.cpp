@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#include "ww2ogg/errors.h"
+#include "wem/byte_reader.h"
+#include "wem/probe.h"
+
+namespace
+{
+
+constexpr std::size_t g_riff_header_size = 12;
+constexpr std::size_t g_chunk_header_size = 8;
+
+constexpr std::uint16_t g_codec_pcm = 0x0001;
+constexpr std::uint16_t g_codec_pcm_extensible = 0xFFFE;
+constexpr std::uint16_t g_codec_vorbis = 0xFFFF;
+
+// fmt chunk size that embeds the vorb fields at fmt + 0x18 instead of a separate chunk
+constexpr std::uint32_t g_fmt_size_embedded_vorb = 0x42;
+
+// Location of a chunk's payload; size is as declared, which may run past the available bytes.
+struct Chunk
+{
+    std::size_t offset = 0;
+    std::uint32_t size = 0;
+    bool present = false;
+};
+
+[[nodiscard]] bool ChunkIs(const std::span<const std::byte> data, const std::size_t offset,
+                           const char* fourcc)
+{
+    return std::memcmp(data.data() + offset, fourcc, 4) == 0;
+}
+
+// True when `size` bytes at `offset` lie inside the available data.
+[[nodiscard]] bool Available(const std::span<const std::byte> data, const std::size_t offset,
+                             const std::size_t size)
+{
+    return offset <= data.size() && size <= data.size() - offset;
+}
+
+template <std::endian Order>
+[[nodiscard]] wwtools::WemMetadata ProbeImpl(const std::span<const std::byte> data)
+{
+    using wwtools::wem::Load;
+
+    wwtools::WemMetadata meta{};
+    meta.big_endian = Order == std::endian::big;
+    meta.riff_size = Load<std::uint32_t, Order>(data, 4) + 8;
+    meta.complete = meta.riff_size <= data.size();
+
+    if (!ChunkIs(data, 8, "WAVE"))
+    {
+        throw ww2ogg::ParseErrorStr("missing WAVE");
+    }
+
+    // Walk chunk headers only, stopping at the end of the RIFF or of the available prefix
+    Chunk fmt;
+    Chunk smpl;
+    Chunk vorb;
+    const std::size_t end = std::min<std::size_t>(meta.riff_size, data.size());
+    std::size_t offset = g_riff_header_size;
+    while (offset + g_chunk_header_size <= end)
+    {
+        const auto size = Load<std::uint32_t, Order>(data, offset + 4);
+        const Chunk chunk{.offset = offset + g_chunk_header_size, .size = size, .present = true};
+
+        if (ChunkIs(data, offset, "fmt "))
+        {
+            fmt = chunk;
+        }
+        else if (ChunkIs(data, offset, "smpl"))
+        {
+            smpl = chunk;
+        }
+        else if (ChunkIs(data, offset, "vorb"))
+        {
+            vorb = chunk;
+        }
+        else if (ChunkIs(data, offset, "data"))
+        {
+            meta.data_offset = static_cast<std::uint32_t>(chunk.offset);
+            meta.data_size = size;
+        }
+
+        offset = chunk.offset + size;
+    }
+
+    // fmt: the basic WAVEFORMATEX fields plus the extensible channel mask when present
+    if (!fmt.present || fmt.size < 0x10 || !Available(data, fmt.offset, 0x10))
+    {
+        throw ww2ogg::ParseErrorStr("expected fmt chunk");
+    }
+    meta.codec = Load<std::uint16_t, Order>(data, fmt.offset);
+    meta.channels = Load<std::uint16_t, Order>(data, fmt.offset + 0x02);
+    meta.sample_rate = Load<std::uint32_t, Order>(data, fmt.offset + 0x04);
+    meta.avg_bytes_per_second = Load<std::uint32_t, Order>(data, fmt.offset + 0x08);
+    meta.block_align = Load<std::uint16_t, Order>(data, fmt.offset + 0x0C);
+    meta.bits_per_sample = Load<std::uint16_t, Order>(data, fmt.offset + 0x0E);
+    if (fmt.size >= 0x18 && Available(data, fmt.offset, 0x18))
+    {
+        meta.channel_mask = Load<std::uint32_t, Order>(data, fmt.offset + 0x14);
+    }
+
+    if (!vorb.present && fmt.size == g_fmt_size_embedded_vorb)
+    {
+        vorb = {.offset = fmt.offset + 0x18, .size = 0, .present = true};
+    }
+
+    // Only the sample count is needed from vorb; it leads the chunk in every layout
+    if (meta.codec == g_codec_vorbis && vorb.present && Available(data, vorb.offset, 4))
+    {
+        meta.sample_count = Load<std::uint32_t, Order>(data, vorb.offset);
+    }
+    else if ((meta.codec == g_codec_pcm || meta.codec == g_codec_pcm_extensible) &&
+             meta.block_align != 0)
+    {
+        meta.sample_count = meta.data_size / meta.block_align;
+    }
+
+    // smpl: a single loop; the end point is stored inclusive, 0 meaning "end of stream"
+    if (smpl.present && Available(data, smpl.offset, 0x34))
+    {
+        meta.loop_count = Load<std::uint32_t, Order>(data, smpl.offset + 0x1C);
+        if (meta.loop_count != 0)
+        {
+            meta.loop_start = Load<std::uint32_t, Order>(data, smpl.offset + 0x2C);
+            const auto loop_end = Load<std::uint32_t, Order>(data, smpl.offset + 0x30);
+            meta.loop_end = loop_end == 0 ? meta.sample_count : loop_end + 1;
+        }
+    }
+
+    return meta;
+}
+
+} // anonymous namespace
+
+namespace wwtools::wem
+{
+
+[[nodiscard]] WemMetadata Probe(const std::span<const std::byte> data)
+{
+    if (data.size() < g_riff_header_size)
+    {
+        throw ww2ogg::ParseErrorStr("RIFF header truncated");
+    }
+
+    if (ChunkIs(data, 0, "RIFF"))
+    {
+        return ProbeImpl<std::endian::little>(data);
+    }
+    if (ChunkIs(data, 0, "RIFX"))
+    {
+        return ProbeImpl<std::endian::big>(data);
+    }
+    throw ww2ogg::ParseErrorStr("missing RIFF");
+}
+
+} // namespace wwtools::wem
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+#include "wwtools/wwtools.h"
+
+// Header-only WEM metadata probe: walks the RIFF chunk headers and reads the few fields needed
+// from fmt/smpl/vorb, without copying the input or touching audio data.
+namespace wwtools::wem
+{
+
+// Works on any prefix that still contains the fmt chunk (e.g. a BNK prefetch stub); fields whose
+// chunk lies beyond the available bytes are left zero.  Throws ww2ogg::ParseError if the data is
+// not a RIFF/RIFX WAVE or the fmt chunk is missing or malformed.
+[[nodiscard]] WemMetadata Probe(std::span<const std::byte> data);
+
+} // namespace wwtools::wem
@@ -1,10 +1,13 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <istream>
 #include <limits>
 #include <ostream>
+#include <span>
 #include <vector>
 
 #include "crc.h"
@@ -50,24 +53,6 @@ inline void Write32Le(std::ostream& os, uint32_t v)
     os.write(b, 4);
 }
 
-[[nodiscard]] inline uint16_t Read16Le(unsigned char b[2])
-{
-    uint16_t v = 0;
-    for (int i = 1; i >= 0; --i)
-    {
-        v <<= 8;
-        v |= b[i];
-    }
-    return v;
-}
-
-[[nodiscard]] inline uint16_t Read16Le(std::istream& is)
-{
-    char b[2];
-    is.read(b, 2);
-    return Read16Le(reinterpret_cast<unsigned char*>(b));
-}
-
 inline void Write16Le(unsigned char b[2], uint16_t v)
 {
     for (int i = 0; i < 2; ++i)
@@ -84,24 +69,6 @@ inline void Write16Le(std::ostream& os, uint16_t v)
     os.write(b, 2);
 }
 
-[[nodiscard]] inline uint32_t Read32Be(unsigned char b[4])
-{
-    uint32_t v = 0;
-    for (int i = 0; i < 4; ++i)
-    {
-        v <<= 8;
-        v |= b[i];
-    }
-    return v;
-}
-
-[[nodiscard]] inline uint32_t Read32Be(std::istream& is)
-{
-    char b[4];
-    is.read(b, 4);
-    return Read32Be(reinterpret_cast<unsigned char*>(b));
-}
-
 inline void Write32Be(unsigned char b[4], uint32_t v)
 {
     for (int i = 3; i >= 0; --i)
@@ -118,24 +85,6 @@ inline void Write32Be(std::ostream& os, uint32_t v)
     os.write(b, 4);
 }
 
-[[nodiscard]] inline uint16_t Read16Be(unsigned char b[2])
-{
-    uint16_t v = 0;
-    for (int i = 0; i < 2; ++i)
-    {
-        v <<= 8;
-        v |= b[i];
-    }
-    return v;
-}
-
-[[nodiscard]] inline uint16_t Read16Be(std::istream& is)
-{
-    char b[2];
-    is.read(b, 2);
-    return Read16Be(reinterpret_cast<unsigned char*>(b));
-}
-
 inline void Write16Be(unsigned char b[2], uint16_t v)
 {
     for (int i = 1; i >= 0; --i)
@@ -203,6 +152,25 @@ public:
     }
 };
 
+// Receives completed Vorbis packets from a Bitoggstream running in packet mode.
+// Lets consumers (e.g. the PCM decoder) take reconstructed packets directly instead of
+// re-parsing serialized OGG pages.  `packet` is only valid for the duration of the call.
+class PacketSink
+{
+public:
+    PacketSink() = default;
+    virtual ~PacketSink() = default;
+
+    // Non-copyable, non-movable
+    PacketSink(const PacketSink&) = delete;
+    PacketSink& operator=(const PacketSink&) = delete;
+    PacketSink(PacketSink&&) = delete;
+    PacketSink& operator=(PacketSink&&) = delete;
+
+    virtual void WritePacket(std::span<const unsigned char> packet, uint32_t granule,
+                             bool last) = 0;
+};
+
 // Output bitstream that accumulates bits and flushes them as complete OGG pages.
 //
 // Bits are accumulated LSB-first (matching Vorbis bit-packing order), collected into
@@ -211,9 +179,13 @@ public:
 //
 // The page buffer is sized to hold a maximum-length OGG page:
 //   27 bytes header + 255 segment table entries + 255*255 bytes payload
+//
+// When constructed with a PacketSink, each flush hands the accumulated payload to the sink
+// as one packet and no page framing or checksum is produced.
 class Bitoggstream
 {
-    std::ostream& m_os;
+    std::ostream* m_os = nullptr;
+    PacketSink* m_packet_sink = nullptr;
 
     unsigned char m_bit_buffer{0}; // partial byte being assembled
     unsigned int m_bits_stored{0}; // bits written into m_bit_buffer so far
@@ -238,7 +210,13 @@ public:
     {
     };
 
-    explicit Bitoggstream(std::ostream& os) : m_os(os)
+    explicit Bitoggstream(std::ostream& os) : m_os(&os)
+    {
+        if (std::numeric_limits<unsigned char>::digits != 8)
+            throw WeirdCharSize();
+    }
+
+    explicit Bitoggstream(PacketSink& packet_sink) : m_packet_sink(&packet_sink)
     {
         if (std::numeric_limits<unsigned char>::digits != 8)
             throw WeirdCharSize();
@@ -256,6 +234,22 @@ public:
         }
     }
 
+    // Writes whole bytes, least significant bit first like eight PutBit calls each, but a byte at
+    // a time whatever the current bit alignment.
+    void PutBytes(const std::span<const std::byte> bytes)
+    {
+        const unsigned int stored = m_bits_stored;
+        for (const auto byte : bytes)
+        {
+            const auto value = std::to_integer<unsigned int>(byte);
+            m_bit_buffer |= static_cast<unsigned char>(value << stored);
+            m_bits_stored = 8;
+            FlushBits();
+            m_bit_buffer = static_cast<unsigned char>(value >> (8 - stored));
+            m_bits_stored = stored;
+        }
+    }
+
     void SetGranule(const uint32_t g)
     {
         m_granule = g;
@@ -285,7 +279,19 @@ public:
             FlushBits();
         }
 
-        if (m_payload_bytes != 0)
+        if (m_payload_bytes != 0 && m_packet_sink != nullptr)
+        {
+            m_packet_sink->WritePacket(
+                std::span<const unsigned char>(&m_page_buffer[HEADER_BYTES + MAX_SEGMENTS],
+                                               m_payload_bytes),
+                m_granule, last);
+
+            ++m_seqno;
+            m_first = false;
+            m_continued = next_continued;
+            m_payload_bytes = 0;
+        }
+        else if (m_payload_bytes != 0)
         {
             unsigned int segments =
                 (m_payload_bytes + SEGMENT_SIZE) / SEGMENT_SIZE; // intentionally round up
@@ -293,11 +299,8 @@ public:
                 segments = MAX_SEGMENTS; // at max eschews the final 0
 
             // move payload back
-            for (unsigned int i = 0; i < m_payload_bytes; ++i)
-            {
-                m_page_buffer[HEADER_BYTES + segments + i] =
-                    m_page_buffer[HEADER_BYTES + MAX_SEGMENTS + i];
-            }
+            std::memmove(&m_page_buffer[HEADER_BYTES + segments],
+                         &m_page_buffer[HEADER_BYTES + MAX_SEGMENTS], m_payload_bytes);
 
             m_page_buffer[0] = 'O';
             m_page_buffer[1] = 'g';
@@ -330,14 +333,13 @@ public:
             }
 
             // checksum
-            Write32Le(&m_page_buffer[22],
-                      Checksum(m_page_buffer.data(), HEADER_BYTES + segments + m_payload_bytes));
+            const std::size_t page_bytes = HEADER_BYTES + segments + m_payload_bytes;
+            Write32Le(&m_page_buffer[22], Checksum(m_page_buffer.data(), page_bytes));
 
             // output to ostream
-            for (unsigned int i = 0; i < HEADER_BYTES + segments + m_payload_bytes; ++i)
-            {
-                m_os.put(static_cast<char>(m_page_buffer[i]));
-            }
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            m_os->write(reinterpret_cast<const char*>(m_page_buffer.data()),
+                        static_cast<std::streamsize>(page_bytes));
 
             ++m_seqno;
             m_first = false;
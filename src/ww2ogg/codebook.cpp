@@ -1,5 +1,7 @@
+#include <span>
 #include <sstream>
 #include <string>
+#include <utility>
 
 #include "ww2ogg/codebook.h"
 
@@ -169,6 +171,10 @@ void CodebookLibrary::Copy(Bitstream& bis, Bitoggstream& bos)
         bis >> min >> max >> value_length >> sequence_flag;
         bos << min << max << value_length << sequence_flag;
 
+        if (dimensions == 0)
+        {
+            throw ParseErrorStr("lookup table with no dimensions");
+        }
         const unsigned int quantvals = BookMaptype1Quantvals(entries, dimensions);
         for (unsigned int i = 0; i < quantvals; ++i)
         {
@@ -302,6 +308,10 @@ void CodebookLibrary::Rebuild(Bitstream& bis, const unsigned long cb_size, Bitog
         bis >> min >> max >> value_length >> sequence_flag;
         bos << min << max << value_length << sequence_flag;
 
+        if (dimensions == 0)
+        {
+            throw ParseErrorStr("lookup table with no dimensions");
+        }
         const unsigned int quantvals = BookMaptype1Quantvals(entries, dimensions);
         for (unsigned int i = 0; i < quantvals; ++i)
         {
@@ -329,4 +339,51 @@ void CodebookLibrary::Rebuild(Bitstream& bis, const unsigned long cb_size, Bitog
     }
 }
 
+namespace
+{
+
+// Collects the single packet a codebook is rebuilt into.
+class CodebookSink final : public PacketSink
+{
+public:
+    std::string codebook;
+
+    void WritePacket(const std::span<const unsigned char> packet, const uint32_t /*granule*/,
+                     const bool /*last*/) override
+    {
+        codebook.assign(packet.begin(), packet.end());
+    }
+};
+
+} // anonymous namespace
+
+CodebookIndex::CodebookIndex(const std::string& codebooks_data)
+{
+    CodebookLibrary library(codebooks_data);
+
+    for (int i = 0; library.GetCodebook(i) != nullptr; ++i)
+    {
+        CodebookSink sink;
+        {
+            Bitoggstream bos(sink);
+            library.Rebuild(i, bos);
+            bos.FlushPage();
+        }
+        // Identical codebooks keep the lowest ID
+        m_ids.emplace(std::move(sink.codebook), i);
+    }
+}
+
+int CodebookIndex::Find(Bitstream& bis) const
+{
+    CodebookSink sink;
+    {
+        Bitoggstream bos(sink);
+        CodebookLibrary().Copy(bis, bos);
+        bos.FlushPage();
+    }
+    const auto it = m_ids.find(sink.codebook);
+    return it == m_ids.end() ? -1 : it->second;
+}
+
 } // namespace ww2ogg
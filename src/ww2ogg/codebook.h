@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "bitstream.h"
@@ -119,4 +120,19 @@ public:
     void Copy(Bitstream& bis, Bitoggstream& bos);
 };
 
+// The inverse of CodebookLibrary::Rebuild: maps every codebook of a packed library, in its
+// standard Vorbis form, back to its ID.  Building it rebuilds the whole library, so it is meant
+// to be built once and shared by every conversion.
+class CodebookIndex
+{
+    std::unordered_map<std::string, int> m_ids;
+
+public:
+    explicit CodebookIndex(const std::string& codebooks_data);
+
+    // Reads one standard Vorbis codebook from `bis` and returns its ID, or -1 when the library
+    // does not have it.
+    [[nodiscard]] int Find(Bitstream& bis) const;
+};
+
 } // namespace ww2ogg
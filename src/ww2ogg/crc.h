@@ -1,17 +1,20 @@
 #pragma once
 
-// OGG page CRC32 checksum (polynomial 0x04c11db7, from Tremor/lowmem).
-// Used by Bitoggstream::FlushPage to compute the checksum field of each OGG page.
+#include <cstddef>
+#include <cstdint>
 
-#include <stdint.h>
-
-#ifdef __cplusplus
-extern "C"
+// OGG page CRC32 checksum (polynomial 0x04c11db7, MSB-first, initial value 0, no final xor).
+// Used by Bitoggstream::FlushPage to compute the checksum field of each OGG page, and by revorb
+// to verify the pages it reads.
+namespace ww2ogg
 {
-#endif // __cplusplus
 
-    uint32_t Checksum(unsigned char* data, int bytes);
+// Computes the CRC over `bytes` bytes starting at `data` (slice-by-8, table verified at compile
+// time against the bitwise definition).
+[[nodiscard]] std::uint32_t Checksum(const unsigned char* data, std::size_t bytes);
+
+// Continues `crc` over `bytes` more bytes, for pages checked in pieces.
+[[nodiscard]] std::uint32_t Checksum(std::uint32_t crc, const unsigned char* data,
+                                     std::size_t bytes);
 
-#ifdef __cplusplus
-}
-#endif // __cplusplus
+} // namespace ww2ogg
@@ -0,0 +1,901 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <limits>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "wem/byte_reader.h"
+#include "ww2ogg/bitstream.h"
+#include "ww2ogg/codebook.h"
+#include "ww2ogg/errors.h"
+#include "ww2ogg/ogg2wem.h"
+
+namespace ww2ogg
+{
+
+namespace
+{
+
+constexpr std::size_t g_page_header_size = 27; // fixed part of a page header, before the lacing
+constexpr std::size_t g_identification_size = 30;
+constexpr std::uint32_t g_max_packet_size = 0xFFFF; // 2- and 6-byte headers store a u16 size
+
+// The packets of the first logical stream of an OGG file, up to its end-of-stream page.
+struct OggPackets
+{
+    std::vector<std::span<const unsigned char>> packets;
+    std::deque<std::string> joined; // storage for the packets continued across pages
+    std::uint32_t serial = 0;
+    std::int64_t last_granule = -1; // granule position of the last page that has one
+};
+
+template <std::unsigned_integral T>
+[[nodiscard]] T LoadLe(const std::span<const unsigned char> data, const std::size_t offset)
+{
+    return wwtools::wem::Load<T, std::endian::little>(std::as_bytes(data), offset);
+}
+
+// Splits an OGG stream into packets, checking each page's framing and checksum as revorb does.
+// Packets within one page point into `data`; packets continued across pages are joined.
+[[nodiscard]] OggPackets ReadPackets(const std::span<const std::byte> bytes)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const std::span data(reinterpret_cast<const unsigned char*>(bytes.data()), bytes.size());
+
+    OggPackets ogg;
+    std::string partial;
+    bool in_partial = false;
+
+    for (std::size_t offset = 0; offset < data.size();)
+    {
+        const auto page = data.subspan(offset);
+        if (page.size() < g_page_header_size || std::memcmp(page.data(), "OggS", 4) != 0 ||
+            page[4] != 0)
+        {
+            throw ParseErrorStr("invalid OGG page");
+        }
+
+        const std::size_t segments = page[g_page_header_size - 1];
+        const std::size_t header_size = g_page_header_size + segments;
+        if (page.size() < header_size)
+        {
+            throw ParseErrorStr("OGG page truncated");
+        }
+        const auto lacing = page.subspan(g_page_header_size, segments);
+        std::size_t body_size = 0;
+        for (const auto value : lacing)
+        {
+            body_size += value;
+        }
+        if (page.size() - header_size < body_size)
+        {
+            throw ParseErrorStr("OGG page truncated");
+        }
+        const auto body = page.subspan(header_size, body_size);
+
+        // The checksum covers the page with its own field zeroed
+        std::array<unsigned char, g_page_header_size + 255> header{};
+        std::memcpy(header.data(), page.data(), header_size);
+        std::memset(header.data() + 22, 0, 4);
+        if (Checksum(Checksum(header.data(), header_size), body.data(), body.size()) !=
+            LoadLe<std::uint32_t>(page, 22))
+        {
+            throw ParseErrorStr("OGG page checksum mismatch");
+        }
+
+        const auto flags = page[5];
+        const auto serial = LoadLe<std::uint32_t>(page, 14);
+        if (offset == 0)
+        {
+            ogg.serial = serial;
+        }
+        else if (serial != ogg.serial)
+        {
+            throw ParseErrorStr("interleaved OGG streams");
+        }
+        if (((flags & 1U) != 0) != in_partial)
+        {
+            throw ParseErrorStr("OGG packet continuation mismatch");
+        }
+        if (const auto granule = LoadLe<std::uint64_t>(page, 6); granule != ~UINT64_C(0))
+        {
+            ogg.last_granule = static_cast<std::int64_t>(granule);
+        }
+
+        std::size_t start = 0;
+        std::size_t size = 0;
+        for (const auto value : lacing)
+        {
+            size += value;
+            if (value == 255)
+            {
+                continue;
+            }
+
+            const auto piece = body.subspan(start, size);
+            if (in_partial)
+            {
+                partial.append(piece.begin(), piece.end());
+                ogg.joined.push_back(std::exchange(partial, {}));
+                // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+                ogg.packets.emplace_back(reinterpret_cast<const unsigned char*>(
+                                             ogg.joined.back().data()),
+                                         ogg.joined.back().size());
+                in_partial = false;
+            }
+            else
+            {
+                ogg.packets.push_back(piece);
+            }
+            start += size;
+            size = 0;
+        }
+        if (!lacing.empty() && lacing.back() == 255)
+        {
+            const auto piece = body.subspan(start);
+            partial.append(piece.begin(), piece.end());
+            in_partial = true;
+        }
+
+        offset += header_size + body_size;
+        if ((flags & 4U) != 0)
+        {
+            break;
+        }
+    }
+
+    if (in_partial)
+    {
+        throw ParseErrorStr("OGG stream ends inside a packet");
+    }
+    return ogg;
+}
+
+// Checks the packet type byte and "vorbis" magic that start every header packet.
+void CheckHeader(const std::span<const unsigned char> packet, const unsigned char type,
+                 const std::size_t min_size)
+{
+    if (packet.size() < std::max<std::size_t>(min_size, 7) || packet[0] != type ||
+        std::memcmp(packet.data() + 1, "vorbis", 6) != 0)
+    {
+        throw ParseErrorStr(std::format("invalid Vorbis header packet type {}", type));
+    }
+}
+
+// The identification header fields a WEM keeps.
+struct Identification
+{
+    std::uint16_t channels;
+    std::uint32_t sample_rate;
+    std::int32_t bitrate_nominal;
+    std::uint8_t blocksize_0_pow;
+    std::uint8_t blocksize_1_pow;
+};
+
+[[nodiscard]] Identification ReadIdentification(const std::span<const unsigned char> packet)
+{
+    CheckHeader(packet, 1, g_identification_size);
+    if (LoadLe<std::uint32_t>(packet, 7) != 0)
+    {
+        throw ParseErrorStr("unsupported Vorbis version");
+    }
+
+    const Identification id{
+        .channels = packet[11],
+        .sample_rate = LoadLe<std::uint32_t>(packet, 12),
+        .bitrate_nominal = static_cast<std::int32_t>(LoadLe<std::uint32_t>(packet, 20)),
+        .blocksize_0_pow = static_cast<std::uint8_t>(packet[28] & 0x0FU),
+        .blocksize_1_pow = static_cast<std::uint8_t>(packet[28] >> 4U),
+    };
+    if (id.channels == 0 || id.sample_rate == 0 || id.blocksize_0_pow > id.blocksize_1_pow)
+    {
+        throw ParseErrorStr("invalid Vorbis identification header");
+    }
+    return id;
+}
+
+// Loop points from the LoopStart/LoopEnd comments ww2ogg writes (end exclusive, 0 if absent).
+struct Loop
+{
+    std::uint32_t start = 0;
+    std::uint32_t end = 0;
+};
+
+[[nodiscard]] Loop ReadLoop(const std::span<const unsigned char> packet)
+{
+    CheckHeader(packet, 3, 7);
+
+    std::size_t offset = 7;
+    const auto field = [&]() {
+        if (packet.size() - offset < 4)
+        {
+            throw ParseErrorStr("comment header truncated");
+        }
+        const auto size = LoadLe<std::uint32_t>(packet, offset);
+        offset += 4;
+        if (packet.size() - offset < size)
+        {
+            throw ParseErrorStr("comment header truncated");
+        }
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        const std::string_view text(reinterpret_cast<const char*>(packet.data() + offset), size);
+        offset += size;
+        return text;
+    };
+    const auto value = [](const std::string_view text, std::uint32_t& out) {
+        std::from_chars(text.data(), text.data() + text.size(), out);
+    };
+
+    static_cast<void>(field()); // vendor
+    if (packet.size() - offset < 4)
+    {
+        throw ParseErrorStr("comment header truncated");
+    }
+    const auto count = LoadLe<std::uint32_t>(packet, offset);
+    offset += 4;
+
+    Loop loop;
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        const auto comment = field();
+        if (comment.starts_with("LoopStart="))
+        {
+            value(comment.substr(10), loop.start);
+        }
+        else if (comment.starts_with("LoopEnd="))
+        {
+            value(comment.substr(8), loop.end);
+        }
+    }
+    return loop;
+}
+
+// The stripped setup packet and what the audio packets need from the setup header.
+struct Setup
+{
+    std::string packet;
+    std::vector<bool> mode_blockflag;
+    int mode_bits = 0;
+};
+
+// Collects the stripped setup packet.
+class SetupSink final : public PacketSink
+{
+public:
+    std::string packet;
+
+    void WritePacket(const std::span<const unsigned char> data, const uint32_t /*granule*/,
+                     const bool /*last*/) override
+    {
+        packet.assign(data.begin(), data.end());
+    }
+};
+
+// The inverse of the setup half of WwiseRiffVorbis::GenerateOggHeader: reads a standard setup
+// header and writes the compact form, with codebook IDs in place of the codebooks, floor,
+// residue and mapping types shrunk or dropped, and no time domain transforms or framing bit.
+[[nodiscard]] Setup StripSetup(const std::span<const unsigned char> packet,
+                               const unsigned int channels, const CodebookIndex& codebooks)
+{
+    CheckHeader(packet, 5, 7);
+
+    std::istringstream in(std::string(packet.begin() + 7, packet.end()));
+    Bitstream ss(in);
+    SetupSink sink;
+    Setup setup;
+
+    try
+    {
+        Bitoggstream os(sink);
+
+        // codebook count
+        BitUint<8> codebook_count_less1;
+        ss >> codebook_count_less1;
+        const unsigned int codebook_count = codebook_count_less1 + 1;
+        os << codebook_count_less1;
+
+        // codebooks, as IDs in the library
+        for (unsigned int i = 0; i < codebook_count; ++i)
+        {
+            const int codebook_id = codebooks.Find(ss);
+            if (codebook_id < 0)
+            {
+                throw ParseErrorStr(std::format("codebook {} is not in the codebook library", i));
+            }
+            os << BitUint<10>(static_cast<unsigned int>(codebook_id));
+        }
+
+        // time domain transforms, placeholders that WEMs omit
+        BitUint<6> time_count_less1;
+        ss >> time_count_less1;
+        for (unsigned int i = 0; i <= time_count_less1; ++i)
+        {
+            BitUint<16> time_value;
+            ss >> time_value;
+            if (time_value != 0)
+            {
+                throw ParseErrorStr("nonzero time domain transform");
+            }
+        }
+
+        // floor count
+        BitUint<6> floor_count_less1;
+        ss >> floor_count_less1;
+        const unsigned int floor_count = floor_count_less1 + 1;
+        os << floor_count_less1;
+
+        for (unsigned int i = 0; i < floor_count; ++i)
+        {
+            // WEMs only have type 1 floors, so the type is not stored
+            BitUint<16> floor_type;
+            ss >> floor_type;
+            if (floor_type != 1)
+            {
+                throw ParseErrorStr("only floor type 1 fits in a WEM");
+            }
+
+            BitUint<5> floor1_partitions;
+            ss >> floor1_partitions;
+            os << floor1_partitions;
+
+            std::vector<unsigned int> floor1_partition_class_list(floor1_partitions);
+
+            unsigned int maximum_class = 0;
+            for (unsigned int j = 0; j < floor1_partitions; ++j)
+            {
+                BitUint<4> floor1_partition_class;
+                ss >> floor1_partition_class;
+                os << floor1_partition_class;
+
+                floor1_partition_class_list[j] = floor1_partition_class;
+                maximum_class = std::max<unsigned int>(maximum_class, floor1_partition_class);
+            }
+
+            std::vector<unsigned int> floor1_class_dimensions_list(maximum_class + 1);
+
+            for (unsigned int j = 0; j <= maximum_class; ++j)
+            {
+                BitUint<3> class_dimensions_less1;
+                ss >> class_dimensions_less1;
+                os << class_dimensions_less1;
+
+                floor1_class_dimensions_list[j] = class_dimensions_less1 + 1;
+
+                BitUint<2> class_subclasses;
+                ss >> class_subclasses;
+                os << class_subclasses;
+
+                if (class_subclasses != 0)
+                {
+                    BitUint<8> masterbook;
+                    ss >> masterbook;
+                    os << masterbook;
+                }
+
+                for (unsigned int k = 0; k < (1U << class_subclasses); ++k)
+                {
+                    BitUint<8> subclass_book_plus1;
+                    ss >> subclass_book_plus1;
+                    os << subclass_book_plus1;
+                }
+            }
+
+            BitUint<2> floor1_multiplier_less1;
+            ss >> floor1_multiplier_less1;
+            os << floor1_multiplier_less1;
+
+            BitUint<4> rangebits;
+            ss >> rangebits;
+            os << rangebits;
+
+            for (unsigned int j = 0; j < floor1_partitions; ++j)
+            {
+                const unsigned int current_class_number = floor1_partition_class_list[j];
+                for (unsigned int k = 0; k < floor1_class_dimensions_list[current_class_number];
+                     ++k)
+                {
+                    BitUintv x(rangebits);
+                    ss >> x;
+                    os << x;
+                }
+            }
+        }
+
+        // residue count
+        BitUint<6> residue_count_less1;
+        ss >> residue_count_less1;
+        const unsigned int residue_count = residue_count_less1 + 1;
+        os << residue_count_less1;
+
+        for (unsigned int i = 0; i < residue_count; ++i)
+        {
+            // 16-bit type in Vorbis, 2 bits in a WEM
+            BitUint<16> residue_type;
+            ss >> residue_type;
+            if (residue_type > 2)
+            {
+                throw ParseErrorStr("invalid residue type");
+            }
+            os << BitUint<2>(residue_type);
+
+            BitUint<24> residue_begin;
+            BitUint<24> residue_end;
+            BitUint<24> residue_partition_size_less1;
+            BitUint<6> residue_classifications_less1;
+            BitUint<8> residue_classbook;
+
+            ss >> residue_begin >> residue_end >> residue_partition_size_less1 >>
+                residue_classifications_less1 >> residue_classbook;
+            const unsigned int residue_classifications = residue_classifications_less1 + 1;
+            os << residue_begin << residue_end << residue_partition_size_less1
+               << residue_classifications_less1 << residue_classbook;
+
+            std::vector<unsigned int> residue_cascade(residue_classifications);
+
+            for (unsigned int j = 0; j < residue_classifications; ++j)
+            {
+                BitUint<5> high_bits(0);
+                BitUint<3> low_bits;
+
+                ss >> low_bits;
+                os << low_bits;
+
+                BitUint<1> bitflag;
+                ss >> bitflag;
+                os << bitflag;
+                if (bitflag)
+                {
+                    ss >> high_bits;
+                    os << high_bits;
+                }
+
+                residue_cascade[j] = high_bits * 8 + low_bits;
+            }
+
+            for (unsigned int j = 0; j < residue_classifications; ++j)
+            {
+                for (unsigned int k = 0; k < 8; ++k)
+                {
+                    if ((residue_cascade[j] & (1 << k)) != 0)
+                    {
+                        BitUint<8> residue_book;
+                        ss >> residue_book;
+                        os << residue_book;
+                    }
+                }
+            }
+        }
+
+        // mapping count
+        BitUint<6> mapping_count_less1;
+        ss >> mapping_count_less1;
+        const unsigned int mapping_count = mapping_count_less1 + 1;
+        os << mapping_count_less1;
+
+        for (unsigned int i = 0; i < mapping_count; ++i)
+        {
+            // type 0 is the only mapping type, so the type is not stored
+            BitUint<16> mapping_type;
+            ss >> mapping_type;
+            if (mapping_type != 0)
+            {
+                throw ParseErrorStr("invalid mapping type");
+            }
+
+            BitUint<1> submaps_flag;
+            ss >> submaps_flag;
+            os << submaps_flag;
+
+            unsigned int submaps = 1;
+            if (submaps_flag)
+            {
+                BitUint<4> submaps_less1;
+                ss >> submaps_less1;
+                submaps = submaps_less1 + 1;
+                os << submaps_less1;
+            }
+
+            BitUint<1> square_polar_flag;
+            ss >> square_polar_flag;
+            os << square_polar_flag;
+
+            if (square_polar_flag)
+            {
+                BitUint<8> coupling_steps_less1;
+                ss >> coupling_steps_less1;
+                const unsigned int coupling_steps = coupling_steps_less1 + 1;
+                os << coupling_steps_less1;
+
+                for (unsigned int j = 0; j < coupling_steps; ++j)
+                {
+                    BitUintv magnitude(Ilog(channels - 1));
+                    BitUintv angle(Ilog(channels - 1));
+
+                    ss >> magnitude >> angle;
+                    os << magnitude << angle;
+                }
+            }
+
+            BitUint<2> mapping_reserved;
+            ss >> mapping_reserved;
+            os << mapping_reserved;
+            if (mapping_reserved != 0)
+            {
+                throw ParseErrorStr("mapping reserved field nonzero");
+            }
+
+            if (submaps > 1)
+            {
+                for (unsigned int j = 0; j < channels; ++j)
+                {
+                    BitUint<4> mapping_mux;
+                    ss >> mapping_mux;
+                    os << mapping_mux;
+                }
+            }
+
+            for (unsigned int j = 0; j < submaps; ++j)
+            {
+                BitUint<8> time_config;
+                BitUint<8> floor_number;
+                BitUint<8> residue_number;
+                ss >> time_config >> floor_number >> residue_number;
+                os << time_config << floor_number << residue_number;
+            }
+        }
+
+        // mode count
+        BitUint<6> mode_count_less1;
+        ss >> mode_count_less1;
+        const unsigned int mode_count = mode_count_less1 + 1;
+        os << mode_count_less1;
+
+        setup.mode_blockflag.resize(mode_count);
+        setup.mode_bits = Ilog(mode_count - 1);
+
+        for (unsigned int i = 0; i < mode_count; ++i)
+        {
+            BitUint<1> block_flag;
+            ss >> block_flag;
+            os << block_flag;
+
+            setup.mode_blockflag[i] = (block_flag != 0);
+
+            // window and transform types are always 0, so they are not stored
+            BitUint<16> windowtype;
+            BitUint<16> transformtype;
+            ss >> windowtype >> transformtype;
+            if (windowtype != 0 || transformtype != 0)
+            {
+                throw ParseErrorStr("invalid mode window or transform type");
+            }
+
+            BitUint<8> mapping;
+            ss >> mapping;
+            os << mapping;
+            if (mapping >= mapping_count)
+            {
+                throw ParseErrorStr("invalid mode mapping");
+            }
+        }
+
+        BitUint<1> framing;
+        ss >> framing;
+        if (framing != 1)
+        {
+            throw ParseErrorStr("setup header framing bit missing");
+        }
+
+        os.FlushPage();
+    }
+    catch (const Bitstream::OutOfBits&)
+    {
+        throw ParseErrorStr("setup header truncated");
+    }
+
+    setup.packet = std::move(sink.packet);
+    return setup;
+}
+
+// Bit `bit` of a packet, counting from the least significant bit of the first byte as Vorbis
+// packs them (0 past the end).
+[[nodiscard]] bool PacketBit(const std::span<const unsigned char> packet, const unsigned int bit)
+{
+    return bit / 8 < packet.size() && ((packet[bit / 8] >> (bit % 8)) & 1U) != 0;
+}
+
+// Size of `packet` once AppendModPacket has dropped the first `shift` bits.
+[[nodiscard]] std::size_t ModPacketSize(const std::span<const unsigned char> packet,
+                                        const unsigned int shift)
+{
+    return packet.size() > 1 && (packet.back() >> shift) == 0 ? packet.size() - 1 : packet.size();
+}
+
+// Appends a standard audio packet as Wwise modifies it: without the packet type bit before the
+// mode number and, for long blocks, the two window flags after it.  WwiseRiffVorbis puts them
+// back and pads the packet with zero bits, so the trailing byte is left out when that padding
+// restores it exactly.
+void AppendModPacket(std::string& out, const std::span<const unsigned char> packet,
+                     const int mode_bits, const bool long_block)
+{
+    const unsigned int shift = long_block ? 3 : 1;
+    const unsigned int mode_mask = (1U << static_cast<unsigned int>(mode_bits)) - 1U;
+    const std::size_t size = ModPacketSize(packet, shift);
+
+    const auto start = out.size();
+    out.resize(start + size);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        const unsigned int next = i + 1 < packet.size() ? packet[i + 1] : 0U;
+        out[start + i] = static_cast<char>((packet[i] >> shift) | (next << (8 - shift)));
+    }
+
+    // The mode number only loses the type bit in front of it
+    const auto mode = (static_cast<unsigned int>(packet[0]) >> 1U) & mode_mask;
+    out[start] = static_cast<char>(
+        (static_cast<unsigned int>(static_cast<unsigned char>(out[start])) & ~mode_mask) | mode);
+}
+
+// Appends integers in the byte order of the WEM being written.
+class ByteWriter
+{
+    std::string& m_out;
+    bool m_little_endian;
+
+public:
+    ByteWriter(std::string& out, const bool little_endian)
+        : m_out(out), m_little_endian(little_endian)
+    {
+    }
+
+    template <std::unsigned_integral T> ByteWriter& Put(const T value)
+    {
+        for (std::size_t i = 0; i < sizeof(T); ++i)
+        {
+            const std::size_t byte = m_little_endian ? i : sizeof(T) - 1 - i;
+            m_out += static_cast<char>((value >> (8 * byte)) & 0xFFU);
+        }
+        return *this;
+    }
+
+    ByteWriter& Tag(const std::string_view tag)
+    {
+        m_out += tag;
+        return *this;
+    }
+
+    ByteWriter& Zeros(const std::size_t count)
+    {
+        m_out.append(count, '\0');
+        return *this;
+    }
+};
+
+// The fmt channel mask WwiseRiffVorbis calls the subtype, for Vorbis channel counts.
+[[nodiscard]] std::uint32_t ChannelMask(const unsigned int channels)
+{
+    constexpr std::array<std::uint32_t, 9> masks = {0,    0x4,  0x3,   0x7,  0x33,
+                                                    0x37, 0x3F, 0x13F, 0x63F};
+    return channels < masks.size() ? masks[channels] : 0;
+}
+
+} // anonymous namespace
+
+std::string Ogg2Wem(const std::span<const std::byte> indata, const CodebookIndex& codebooks,
+                    const WemFormat& format)
+{
+    if (format.packet_headers == PacketHeaders::Old)
+    {
+        throw ArgumentError("8-byte packet headers need the full header triad");
+    }
+    if (format.mod_packets && format.packet_headers != PacketHeaders::NoGranule)
+    {
+        throw ArgumentError("modified packets need 2-byte packet headers");
+    }
+    const bool granules = format.packet_headers == PacketHeaders::Standard;
+
+    const auto ogg = ReadPackets(indata);
+    if (ogg.packets.size() < 3)
+    {
+        throw ParseErrorStr("missing Vorbis header packets");
+    }
+    const auto id = ReadIdentification(ogg.packets[0]);
+    const auto loop = ReadLoop(ogg.packets[1]);
+    const auto setup = StripSetup(ogg.packets[2], id.channels, codebooks);
+
+    const unsigned int mode_mask = (1U << static_cast<unsigned int>(setup.mode_bits)) - 1U;
+    const auto block_flag = [&](const std::span<const unsigned char> packet) {
+        if ((packet[0] & 1U) != 0)
+        {
+            throw ParseErrorStr("header packet among the audio packets");
+        }
+        const unsigned int mode_number = (static_cast<unsigned int>(packet[0]) >> 1U) & mode_mask;
+        if (mode_number >= setup.mode_blockflag.size())
+        {
+            throw ParseErrorStr("mode number out of range");
+        }
+        return static_cast<bool>(setup.mode_blockflag[mode_number]);
+    };
+
+    // Empty packets decode to nothing and a WEM cannot hold them, so they are left out
+    std::vector<std::span<const unsigned char>> audio;
+    audio.reserve(ogg.packets.size() - 3);
+    for (std::size_t i = 3; i < ogg.packets.size(); ++i)
+    {
+        if (!ogg.packets[i].empty())
+        {
+            audio.push_back(ogg.packets[i]);
+        }
+    }
+
+    std::string data;
+    data.reserve(indata.size());
+    ByteWriter data_out(data, format.little_endian);
+
+    const auto packet_header = [&](const std::size_t size, const std::uint32_t granule) {
+        if (size > g_max_packet_size)
+        {
+            throw ParseErrorStr("packet too large for a WEM");
+        }
+        data_out.Put(static_cast<std::uint16_t>(size));
+        if (granules)
+        {
+            data_out.Put(granule);
+        }
+    };
+
+    packet_header(setup.packet.size(), 0);
+    data += setup.packet;
+    const auto first_audio_packet_offset = static_cast<std::uint32_t>(data.size());
+
+    // Sample positions as revorb computes them, for the granules of 6-byte headers and the
+    // sample count of a stream that does not end with one
+    std::int64_t granpos = 0;
+    std::uint32_t lastbs = 0;
+    bool prev_blockflag = false;
+
+    for (std::size_t i = 0; i < audio.size(); ++i)
+    {
+        const auto packet = audio[i];
+        const bool long_block = block_flag(packet);
+
+        const std::uint32_t bs = 1U << (long_block ? id.blocksize_1_pow : id.blocksize_0_pow);
+        if (lastbs != 0)
+        {
+            granpos += (lastbs + bs) / 4;
+        }
+        lastbs = bs;
+        const auto granule = static_cast<std::uint32_t>(
+            std::min<std::int64_t>(granpos, std::numeric_limits<std::uint32_t>::max() - 1));
+
+        if (!format.mod_packets)
+        {
+            packet_header(packet.size(), granule);
+            data.append(packet.begin(), packet.end());
+            continue;
+        }
+
+        // Wwise's window flags are implied by the neighbouring blocks, so the packet's own
+        // have to agree with them
+        if (long_block)
+        {
+            const auto flag_bit = static_cast<unsigned int>(setup.mode_bits) + 1;
+            const bool next_blockflag = i + 1 < audio.size() && block_flag(audio[i + 1]);
+            if (PacketBit(packet, flag_bit) != prev_blockflag ||
+                PacketBit(packet, flag_bit + 1) != next_blockflag)
+            {
+                throw ParseErrorStr("window flags disagree with the neighbouring blocks, which "
+                                    "modified packets cannot store");
+            }
+        }
+        prev_blockflag = long_block;
+
+        packet_header(ModPacketSize(packet, long_block ? 3 : 1), granule);
+        AppendModPacket(data, packet, setup.mode_bits, long_block);
+    }
+
+    const std::int64_t sample_count = ogg.last_granule > 0 ? ogg.last_granule : granpos;
+    if (sample_count > std::numeric_limits<std::uint32_t>::max())
+    {
+        throw ParseErrorStr("too many samples for a WEM");
+    }
+    const bool looped = loop.end != 0 || loop.start != 0;
+    if (looped && (loop.start >= sample_count || loop.end > sample_count ||
+                   (loop.end != 0 && loop.start > loop.end)))
+    {
+        throw ParseErrorStr("loops out of range");
+    }
+
+    // Without a nominal bitrate, the average over the whole stream
+    std::uint32_t avg_bytes_per_second = 0;
+    if (id.bitrate_nominal > 0)
+    {
+        avg_bytes_per_second = static_cast<std::uint32_t>(id.bitrate_nominal / 8);
+    }
+    else if (sample_count > 0)
+    {
+        avg_bytes_per_second = static_cast<std::uint32_t>(static_cast<std::int64_t>(data.size()) *
+                                                          id.sample_rate / sample_count);
+    }
+
+    // fmt, then the vorb fields: inside a 0x42 fmt chunk for 2-byte headers, in a 0x34 vorb chunk
+    // for 6-byte ones
+    std::string fmt;
+    ByteWriter fmt_out(fmt, format.little_endian);
+    fmt_out.Put(std::uint16_t{0xFFFF}).Put(id.channels).Put(id.sample_rate);
+    fmt_out.Put(avg_bytes_per_second).Put(std::uint16_t{0}).Put(std::uint16_t{0});
+    fmt_out.Put(static_cast<std::uint16_t>(granules ? 6 : 0x30)).Put(std::uint16_t{0});
+    fmt_out.Put(ChannelMask(id.channels));
+
+    std::string vorb;
+    ByteWriter vorb_out(vorb, format.little_endian);
+    vorb_out.Put(static_cast<std::uint32_t>(sample_count));
+    if (granules)
+    {
+        vorb_out.Zeros(0x14).Put(std::uint32_t{0}).Put(first_audio_packet_offset).Zeros(0xC);
+        vorb_out.Put(ogg.serial).Put(id.blocksize_0_pow).Put(id.blocksize_1_pow).Zeros(2);
+    }
+    else
+    {
+        // a mod signal of 0x4A marks standard packets
+        vorb_out.Put(std::uint32_t{format.mod_packets ? 0U : 0x4AU}).Zeros(8);
+        vorb_out.Put(std::uint32_t{0}).Put(first_audio_packet_offset).Zeros(12);
+        vorb_out.Put(ogg.serial).Put(id.blocksize_0_pow).Put(id.blocksize_1_pow);
+        fmt += vorb;
+    }
+
+    // smpl with one loop; its end is stored inclusive
+    std::string smpl;
+    if (looped)
+    {
+        ByteWriter smpl_out(smpl, format.little_endian);
+        smpl_out.Zeros(8).Put(static_cast<std::uint32_t>(1000000000U / id.sample_rate));
+        smpl_out.Put(std::uint32_t{60}).Zeros(12).Put(std::uint32_t{1}).Zeros(12);
+        smpl_out.Put(loop.start).Put(loop.end == 0 ? 0U : loop.end - 1).Zeros(8);
+    }
+
+    std::string wem;
+    const auto chunk = [&](const std::string_view tag, const std::string& payload) {
+        ByteWriter(wem, format.little_endian)
+            .Tag(tag)
+            .Put(static_cast<std::uint32_t>(payload.size()));
+        wem += payload;
+    };
+
+    const std::size_t riff_size = 4 + (8 + fmt.size()) + (granules ? 8 + vorb.size() : 0) +
+                                  (looped ? 8 + smpl.size() : 0) + (8 + data.size());
+    if (riff_size > std::numeric_limits<std::uint32_t>::max())
+    {
+        throw ParseErrorStr("too much audio for a WEM");
+    }
+    wem.reserve(8 + riff_size);
+    ByteWriter(wem, format.little_endian)
+        .Tag(format.little_endian ? "RIFF" : "RIFX")
+        .Put(static_cast<std::uint32_t>(riff_size))
+        .Tag("WAVE");
+    chunk("fmt ", fmt);
+    if (looped)
+    {
+        chunk("smpl", smpl);
+    }
+    if (granules)
+    {
+        chunk("vorb", vorb);
+    }
+    chunk("data", data);
+    return wem;
+}
+
+} // namespace ww2ogg
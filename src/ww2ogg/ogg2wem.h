@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+
+#include "codebook.h"
+#include "wwriff.h"
+
+namespace ww2ogg
+{
+
+// Packet framing and byte order of a WEM written by Ogg2Wem.
+struct WemFormat
+{
+    PacketHeaders packet_headers = PacketHeaders::NoGranule; // NoGranule or Standard
+    bool mod_packets = true;   // Wwise "modified" packets; needs NoGranule headers
+    bool little_endian = true; // RIFF rather than RIFX
+};
+
+// Converts an OGG Vorbis stream to a Wwise WEM, the inverse of WwiseRiffVorbis: the setup header
+// is stripped to the compact form with every codebook replaced by its ID in `codebooks`, and the
+// audio packets get Wwise packet headers (losing their packet type and window bits when
+// modified).  The identification header only keeps what the fmt/vorb fields hold, and of the
+// comments only the LoopStart/LoopEnd tags ww2ogg writes survive, as a smpl loop.
+// Throws ArgumentError for an impossible `format`, and ParseError-derived exceptions when the OGG
+// is invalid or uses something a WEM cannot hold (floor 0, codebooks missing from the library).
+[[nodiscard]] std::string Ogg2Wem(std::span<const std::byte> indata,
+                                  const CodebookIndex& codebooks, const WemFormat& format = {});
+
+} // namespace ww2ogg
@@ -1,5 +1,6 @@
 #include <ostream>
 #include <string>
+#include <utility>
 
 #include "ww2ogg/errors.h"
 #include "ww2ogg/packed_codebooks.h"
@@ -11,16 +12,29 @@ namespace ww2ogg
 
 // Wraps the packed codebook data in a string, constructs WwiseRiffVorbis (which parses
 // the WEM), and writes the resulting OGG stream.
-void Ww2Ogg(const std::string& indata, std::ostream& outdata,
+void Ww2Ogg(std::string indata, std::ostream& outdata,
             const unsigned char* const codebooks_data, const bool inline_codebooks,
             const bool full_setup, const ForcePacketFormat force_packet_format)
 {
     // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
     const std::string codebooks_data_s(reinterpret_cast<const char*>(codebooks_data),
                                        g_packed_codebooks_bin_len);
-    WwiseRiffVorbis ww(indata, codebooks_data_s, inline_codebooks, full_setup, force_packet_format);
+    WwiseRiffVorbis ww(std::move(indata), codebooks_data_s, inline_codebooks, full_setup,
+                       force_packet_format);
+
+    ww.GenerateOgg(outdata);
+}
+
+[[nodiscard]] bool Ww2OggPrefix(std::string indata, std::ostream& outdata)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    std::string codebooks_data_s(reinterpret_cast<const char*>(g_packed_codebooks_bin),
+                                 g_packed_codebooks_bin_len);
+    WwiseRiffVorbis ww(std::move(indata), std::move(codebooks_data_s), false, false,
+                       K_NO_FORCE_PACKET_FORMAT, true);
 
     ww.GenerateOgg(outdata);
+    return !ww.Truncated();
 }
 
 [[nodiscard]] std::string WemInfo(const std::string& indata,
@@ -35,4 +49,17 @@ void Ww2Ogg(const std::string& indata, std::ostream& outdata,
     return ww.GetInfo();
 }
 
+[[nodiscard]] VorbisInfo ParseWemInfo(const std::string& indata,
+                                      const unsigned char* const codebooks_data,
+                                      const bool inline_codebooks, const bool full_setup,
+                                      const ForcePacketFormat force_packet_format)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const std::string codebooks_data_s(reinterpret_cast<const char*>(codebooks_data),
+                                       g_packed_codebooks_bin_len);
+    const WwiseRiffVorbis ww(indata, codebooks_data_s, inline_codebooks, full_setup,
+                             force_packet_format);
+    return ww.Info();
+}
+
 } // namespace ww2ogg
@@ -9,13 +9,19 @@
 namespace ww2ogg
 {
 
-// Converts a Wwise WEM byte buffer to OGG and writes the result to `outdata`.
+// Converts a Wwise WEM byte buffer to OGG and writes the result to `outdata`.  Takes the buffer
+// by value so callers that are done with it can move it in instead of copying.
 // Throws ParseError-derived exceptions when WEM data is invalid or unsupported.
-void Ww2Ogg(const std::string& indata, std::ostream& outdata,
+void Ww2Ogg(std::string indata, std::ostream& outdata,
             const unsigned char* codebooks_data = g_packed_codebooks_bin,
             bool inline_codebooks = false, bool full_setup = false,
             ForcePacketFormat force_packet_format = K_NO_FORCE_PACKET_FORMAT);
 
+// Like Ww2Ogg, but also accepts a WEM cut short inside its data chunk, such as the prefetch stub a
+// bank embeds for a streamed sound: the OGG ends with the last audio packet that is there in
+// full.  Returns false when the WEM was cut short, true when it converted whole.
+[[nodiscard]] bool Ww2OggPrefix(std::string indata, std::ostream& outdata);
+
 // Returns a human-readable metadata summary for a WEM buffer without producing OGG output.
 // Uses the same parsing path/options as Ww2Ogg and may throw the same ParseError-derived
 // exceptions.
@@ -24,4 +30,10 @@ void Ww2Ogg(const std::string& indata, std::ostream& outdata,
                                   bool inline_codebooks = false, bool full_setup = false,
                                   ForcePacketFormat force_packet_format = K_NO_FORCE_PACKET_FORMAT);
 
+// Returns the metadata WemInfo summarizes, for writing with WriteInfo or WriteInfoJson.
+[[nodiscard]] VorbisInfo ParseWemInfo(
+    const std::string& indata, const unsigned char* codebooks_data = g_packed_codebooks_bin,
+    bool inline_codebooks = false, bool full_setup = false,
+    ForcePacketFormat force_packet_format = K_NO_FORCE_PACKET_FORMAT);
+
 } // namespace ww2ogg
@@ -1,10 +1,19 @@
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <ostream>
+#include <span>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <utility>
 
+#include "json.h"
+#include "wem/byte_reader.h"
 #include "ww2ogg/bitstream.h"
 #include "ww2ogg/codebook.h"
 #include "ww2ogg/errors.h"
@@ -13,6 +22,36 @@
 namespace ww2ogg
 {
 
+namespace
+{
+
+// Reads a T stored in `Order` byte order at `offset`, failing when it lies past the end of the
+// file.
+template <typename T, std::endian Order>
+[[nodiscard]] T ReadAt(const std::span<const std::byte> data, const long offset)
+{
+    if (offset < 0 || static_cast<std::size_t>(offset) + sizeof(T) > data.size())
+    {
+        throw ParseErrorStr("file truncated");
+    }
+    return wwtools::wem::Load<T, Order>(data, static_cast<std::size_t>(offset));
+}
+
+// Writes the low `bits` bits of `value`, least significant first, as BitUintv does.
+void PutBits(Bitoggstream& os, const unsigned int value, const int bits)
+{
+    for (int i = 0; i < bits; ++i)
+    {
+        os.PutBit(((value >> static_cast<unsigned int>(i)) & 1U) != 0);
+    }
+}
+
+template <std::endian Order> using ByteOrder = std::integral_constant<std::endian, Order>;
+template <PacketHeaders Headers>
+using HeaderFormat = std::integral_constant<PacketHeaders, Headers>;
+
+} // anonymous namespace
+
 // Reads a Wwise audio packet header (6-byte or 2-byte variant).
 // Layout for 6-byte: [size:u16][granule:u32]
 // Layout for 2-byte (no_granule): [size:u16]
@@ -24,29 +63,31 @@ class Packet
     uint32_t m_absolute_granule{0};
     bool m_no_granule;
 
-public:
-    Packet(std::stringstream& i, const long o, const bool little_endian,
-           const bool no_granule = false)
-        : m_offset(o), m_no_granule(no_granule)
+    Packet(const long o, const bool no_granule) : m_offset(o), m_no_granule(no_granule)
     {
-        i.seekg(m_offset);
+    }
 
-        if (little_endian)
+public:
+    // The byte order is a template parameter so the audio packet loop, which reads one header
+    // per packet, is compiled once per order instead of branching on every read.
+    template <std::endian Order>
+    [[nodiscard]] static Packet Read(const std::span<const std::byte> data, const long o,
+                                     const bool no_granule = false)
+    {
+        Packet packet(o, no_granule);
+        packet.m_size = ReadAt<uint16_t, Order>(data, o);
+        if (!no_granule)
         {
-            m_size = Read16Le(i);
-            if (!m_no_granule)
-            {
-                m_absolute_granule = Read32Le(i);
-            }
-        }
-        else
-        {
-            m_size = Read16Be(i);
-            if (!m_no_granule)
-            {
-                m_absolute_granule = Read32Be(i);
-            }
+            packet.m_absolute_granule = ReadAt<uint32_t, Order>(data, o + 2);
         }
+        return packet;
+    }
+
+    [[nodiscard]] static Packet Read(const std::span<const std::byte> data, const long o,
+                                     const bool little_endian, const bool no_granule)
+    {
+        return little_endian ? Read<std::endian::little>(data, o, no_granule)
+                             : Read<std::endian::big>(data, o, no_granule);
     }
 
     [[nodiscard]] long HeaderSize() const
@@ -80,21 +121,25 @@ class Packet8
     uint32_t m_size{0};
     uint32_t m_absolute_granule{0};
 
+    explicit Packet8(const long o) : m_offset(o)
+    {
+    }
+
 public:
-    Packet8(std::stringstream& i, const long o, const bool little_endian) : m_offset(o)
+    template <std::endian Order>
+    [[nodiscard]] static Packet8 Read(const std::span<const std::byte> data, const long o)
     {
-        i.seekg(m_offset);
+        Packet8 packet(o);
+        packet.m_size = ReadAt<uint32_t, Order>(data, o);
+        packet.m_absolute_granule = ReadAt<uint32_t, Order>(data, o + 4);
+        return packet;
+    }
 
-        if (little_endian)
-        {
-            m_size = Read32Le(i);
-            m_absolute_granule = Read32Le(i);
-        }
-        else
-        {
-            m_size = Read32Be(i);
-            m_absolute_granule = Read32Be(i);
-        }
+    [[nodiscard]] static Packet8 Read(const std::span<const std::byte> data, const long o,
+                                      const bool little_endian)
+    {
+        return little_endian ? Read<std::endian::little>(data, o)
+                             : Read<std::endian::big>(data, o);
     }
 
     [[nodiscard]] long HeaderSize() const
@@ -147,110 +192,106 @@ public:
     }
 };
 
-WwiseRiffVorbis::WwiseRiffVorbis(const std::string& indata, std::string codebooks_data,
+WwiseRiffVorbis::WwiseRiffVorbis(std::string indata, std::string codebooks_data,
                                  const bool inline_codebooks, const bool full_setup,
-                                 const ForcePacketFormat force_packet_format)
-    : m_codebooks_data(std::move(codebooks_data)), m_indata(indata),
-      m_inline_codebooks(inline_codebooks), m_full_setup(full_setup)
+                                 const ForcePacketFormat force_packet_format,
+                                 const bool allow_truncated)
+    : m_codebooks_data(std::move(codebooks_data)), m_indata(std::move(indata)),
+      m_inline_codebooks(inline_codebooks), m_full_setup(full_setup),
+      m_allow_truncated(allow_truncated)
 {
+    const auto data = Bytes();
+    m_file_size = static_cast<long>(data.size());
 
-    m_indata.seekg(0, std::ios::end);
-    m_file_size = static_cast<long>(m_indata.tellg());
-
-    // check RIFF header
+    // check RIFF header; RIFF is little-endian, RIFX big-endian
+    if (data.size() >= 4 && std::memcmp(data.data(), "RIFX", 4) == 0)
     {
-        std::array<unsigned char, 4> riff_head{};
-        std::array<unsigned char, 4> wave_head{};
-        m_indata.seekg(0, std::ios::beg);
-        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-        m_indata.read(reinterpret_cast<char*>(riff_head.data()), 4);
-
-        if (std::memcmp(riff_head.data(), "RIFX", 4) != 0)
-        {
-            if (std::memcmp(riff_head.data(), "RIFF", 4) != 0)
-            {
-                throw ParseErrorStr("missing RIFF");
-            }
-            else
-            {
-                m_little_endian = true;
-            }
-        }
-        else
-        {
-            m_little_endian = false;
-        }
+        m_little_endian = false;
+        Parse<std::endian::big>(force_packet_format);
+    }
+    else if (data.size() >= 4 && std::memcmp(data.data(), "RIFF", 4) == 0)
+    {
+        m_little_endian = true;
+        Parse<std::endian::little>(force_packet_format);
+    }
+    else
+    {
+        throw ParseErrorStr("missing RIFF");
+    }
+}
 
-        if (m_little_endian)
-        {
-            m_read_16 = Read16Le;
-            m_read_32 = Read32Le;
-        }
-        else
-        {
-            m_read_16 = Read16Be;
-            m_read_32 = Read32Be;
-        }
+// Every integer of the RIFF structure is read through ReadAt<T, Order>, so the byte order is
+// fixed at compile time instead of going through a function pointer per field.
+template <std::endian Order>
+void WwiseRiffVorbis::Parse(const ForcePacketFormat force_packet_format)
+{
+    const auto data = Bytes();
+    const auto read_16 = [&](const long offset) { return ReadAt<uint16_t, Order>(data, offset); };
+    const auto read_32 = [&](const long offset) { return ReadAt<uint32_t, Order>(data, offset); };
 
-        m_riff_size = static_cast<long>(m_read_32(m_indata)) + 8;
+    m_riff_size = static_cast<long>(read_32(4)) + 8;
 
-        if (m_riff_size > m_file_size)
-        {
-            throw ParseErrorStr("RIFF truncated (header claims " + std::to_string(m_riff_size) +
-                                " bytes but only " + std::to_string(m_file_size) +
-                                " available, this is likely a streaming/prefetch WEM"
-                                " that requires the full .wem file)");
-        }
+    if (m_riff_size > m_file_size && m_allow_truncated)
+    {
+        // Parse what is there; the cut has to fall in the data chunk for any audio to survive
+        m_truncated = true;
+        m_riff_size = m_file_size;
+    }
+    else if (m_riff_size > m_file_size)
+    {
+        throw ParseErrorStr("RIFF truncated (header claims " + std::to_string(m_riff_size) +
+                            " bytes but only " + std::to_string(m_file_size) +
+                            " available, this is likely a streaming/prefetch WEM"
+                            " that requires the full .wem file)");
+    }
 
-        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-        m_indata.read(reinterpret_cast<char*>(wave_head.data()), 4);
-        if (std::memcmp(wave_head.data(), "WAVE", 4) != 0)
-        {
-            throw ParseErrorStr("missing WAVE");
-        }
+    if (data.size() < 12 || std::memcmp(data.data() + 8, "WAVE", 4) != 0)
+    {
+        throw ParseErrorStr("missing WAVE");
     }
 
     // read chunks
     long chunk_offset = 12;
     while (chunk_offset < m_riff_size)
     {
-        m_indata.seekg(chunk_offset, std::ios::beg);
-
+        if (chunk_offset + 8 > m_riff_size && m_truncated)
+        {
+            break;
+        }
         if (chunk_offset + 8 > m_riff_size)
         {
             throw ParseErrorStr("chunk header truncated");
         }
 
-        std::array<char, 4> chunk_type{};
-        m_indata.read(chunk_type.data(), 4);
-        const uint32_t chunk_size = m_read_32(m_indata);
+        const auto* chunk_type = data.data() + chunk_offset;
+        const uint32_t chunk_size = read_32(chunk_offset + 4);
 
-        if (std::memcmp(chunk_type.data(), "fmt ", 4) == 0)
+        if (std::memcmp(chunk_type, "fmt ", 4) == 0)
         {
             m_fmt_offset = chunk_offset + 8;
             m_fmt_size = static_cast<long>(chunk_size);
         }
-        else if (std::memcmp(chunk_type.data(), "cue ", 4) == 0)
+        else if (std::memcmp(chunk_type, "cue ", 4) == 0)
         {
             m_cue_offset = chunk_offset + 8;
             m_cue_size = static_cast<long>(chunk_size);
         }
-        else if (std::memcmp(chunk_type.data(), "LIST", 4) == 0)
+        else if (std::memcmp(chunk_type, "LIST", 4) == 0)
         {
             m_list_offset = chunk_offset + 8;
             m_list_size = static_cast<long>(chunk_size);
         }
-        else if (std::memcmp(chunk_type.data(), "smpl", 4) == 0)
+        else if (std::memcmp(chunk_type, "smpl", 4) == 0)
         {
             m_smpl_offset = chunk_offset + 8;
             m_smpl_size = static_cast<long>(chunk_size);
         }
-        else if (std::memcmp(chunk_type.data(), "vorb", 4) == 0)
+        else if (std::memcmp(chunk_type, "vorb", 4) == 0)
         {
             m_vorb_offset = chunk_offset + 8;
             m_vorb_size = static_cast<long>(chunk_size);
         }
-        else if (std::memcmp(chunk_type.data(), "data", 4) == 0)
+        else if (std::memcmp(chunk_type, "data", 4) == 0)
         {
             m_data_offset = chunk_offset + 8;
             m_data_size = static_cast<long>(chunk_size);
@@ -259,7 +300,20 @@ WwiseRiffVorbis::WwiseRiffVorbis(const std::string& indata, std::string codebook
         chunk_offset = chunk_offset + 8 + static_cast<long>(chunk_size);
     }
 
-    if (chunk_offset > m_riff_size)
+    if (chunk_offset > m_riff_size && m_truncated)
+    {
+        // The headers have to be there in full; only the part of the data chunk that made it
+        // into the file is read
+        if (m_fmt_offset != -1 && m_fmt_offset + m_fmt_size > m_file_size)
+        {
+            throw ParseErrorStr("file truncated inside fmt");
+        }
+        if (m_data_offset != -1 && m_data_offset + m_data_size > m_file_size)
+        {
+            m_data_size = std::max(m_file_size - m_data_offset, 0L);
+        }
+    }
+    else if (chunk_offset > m_riff_size)
     {
         throw ParseErrorStr("chunk truncated");
     }
@@ -287,23 +341,22 @@ WwiseRiffVorbis::WwiseRiffVorbis(const std::string& indata, std::string codebook
         m_vorb_offset = m_fmt_offset + 0x18;
     }
 
-    m_indata.seekg(m_fmt_offset, std::ios::beg);
-    if (UINT16_C(0xFFFF) != m_read_16(m_indata))
+    if (UINT16_C(0xFFFF) != read_16(m_fmt_offset))
     {
         throw ParseErrorStr("bad codec id");
     }
-    m_channels = m_read_16(m_indata);
-    m_sample_rate = m_read_32(m_indata);
-    m_avg_bytes_per_second = m_read_32(m_indata);
-    if (m_read_16(m_indata) != 0U)
+    m_channels = read_16(m_fmt_offset + 0x2);
+    m_sample_rate = read_32(m_fmt_offset + 0x4);
+    m_avg_bytes_per_second = read_32(m_fmt_offset + 0x8);
+    if (read_16(m_fmt_offset + 0xC) != 0U)
     {
         throw ParseErrorStr("bad block align");
     }
-    if (m_read_16(m_indata) != 0U)
+    if (read_16(m_fmt_offset + 0xE) != 0U)
     {
         throw ParseErrorStr("expected 0 bps");
     }
-    if (m_fmt_size - 0x12 != m_read_16(m_indata))
+    if (m_fmt_size - 0x12 != read_16(m_fmt_offset + 0x10))
     {
         throw ParseErrorStr("bad extra fmt length");
     }
@@ -311,20 +364,20 @@ WwiseRiffVorbis::WwiseRiffVorbis(const std::string& indata, std::string codebook
     if (m_fmt_size - 0x12 >= 2)
     {
         // read extra fmt
-        m_ext_unk = m_read_16(m_indata);
+        m_ext_unk = read_16(m_fmt_offset + 0x12);
         if (m_fmt_size - 0x12 >= 6)
         {
-            m_subtype = m_read_32(m_indata);
+            m_subtype = read_32(m_fmt_offset + 0x14);
         }
     }
 
     if (m_fmt_size == 0x28)
     {
-        std::array<char, 16> whoknowsbuf{};
+        // the whole fmt chunk is inside the file: the chunk walk above rejects one running past
+        // the end, truncated files included
         const std::array<unsigned char, 16> whoknowsbuf_check = {
             1, 0, 0, 0, 0, 0, 0x10, 0, 0x80, 0, 0, 0xAA, 0, 0x38, 0x9b, 0x71};
-        m_indata.read(whoknowsbuf.data(), 16);
-        if (std::memcmp(whoknowsbuf.data(), whoknowsbuf_check.data(), 16) != 0)
+        if (std::memcmp(data.data() + m_fmt_offset + 0x18, whoknowsbuf_check.data(), 16) != 0)
         {
             throw ParseErrorStr("expected signature in extra fmt?");
         }
@@ -333,24 +386,21 @@ WwiseRiffVorbis::WwiseRiffVorbis(const std::string& indata, std::string codebook
     // read cue
     if (m_cue_offset != -1)
     {
-        m_indata.seekg(m_cue_offset);
-        m_cue_count = m_read_32(m_indata);
+        m_cue_count = read_32(m_cue_offset);
     }
 
     // read smpl
     if (m_smpl_offset != -1)
     {
-        m_indata.seekg(m_smpl_offset + 0x1C);
-        m_loop_count = m_read_32(m_indata);
+        m_loop_count = read_32(m_smpl_offset + 0x1C);
 
         if (m_loop_count != 1)
         {
             throw ParseErrorStr("expected one loop");
         }
 
-        m_indata.seekg(m_smpl_offset + 0x2c);
-        m_loop_start = m_read_32(m_indata);
-        m_loop_end = m_read_32(m_indata);
+        m_loop_start = read_32(m_smpl_offset + 0x2C);
+        m_loop_end = read_32(m_smpl_offset + 0x30);
     }
 
     // read vorb
@@ -362,34 +412,32 @@ WwiseRiffVorbis::WwiseRiffVorbis(const std::string& indata, std::string codebook
     case 0x2C:
     case 0x32:
     case 0x34:
-        m_indata.seekg(m_vorb_offset + 0x00, std::ios::beg);
         break;
 
     default:
         throw ParseErrorStr("bad vorb size");
     }
 
-    m_sample_count = m_read_32(m_indata);
+    m_sample_count = read_32(m_vorb_offset + 0x00);
 
+    long packet_offsets_offset = m_vorb_offset + 0x18;
     switch (m_vorb_size)
     {
     case -1:
     case 0x2A: {
         m_no_granule = true;
 
-        m_indata.seekg(m_vorb_offset + 0x4, std::ios::beg);
-        const uint32_t mod_signal = m_read_32(m_indata);
+        const uint32_t mod_signal = read_32(m_vorb_offset + 0x4);
 
         if (mod_signal != 0x4A && mod_signal != 0x4B && mod_signal != 0x69 && mod_signal != 0x70)
         {
             m_mod_packets = true;
         }
-        m_indata.seekg(m_vorb_offset + 0x10, std::ios::beg);
+        packet_offsets_offset = m_vorb_offset + 0x10;
         break;
     }
 
     default:
-        m_indata.seekg(m_vorb_offset + 0x18, std::ios::beg);
         break;
     }
 
@@ -402,25 +450,8 @@ WwiseRiffVorbis::WwiseRiffVorbis(const std::string& indata, std::string codebook
         m_mod_packets = true;
     }
 
-    m_setup_packet_offset = m_read_32(m_indata);
-    m_first_audio_packet_offset = m_read_32(m_indata);
-
-    // NOLINTNEXTLINE(bugprone-branch-clone)
-    switch (m_vorb_size)
-    {
-    case -1:
-    case 0x2A:
-        m_indata.seekg(m_vorb_offset + 0x24, std::ios::beg);
-        break;
-
-    case 0x32:
-    case 0x34:
-        m_indata.seekg(m_vorb_offset + 0x2C, std::ios::beg);
-        break;
-
-    default:
-        break;
-    }
+    m_setup_packet_offset = read_32(packet_offsets_offset);
+    m_first_audio_packet_offset = read_32(packet_offsets_offset + 4);
 
     switch (m_vorb_size)
     {
@@ -434,11 +465,14 @@ WwiseRiffVorbis::WwiseRiffVorbis(const std::string& indata, std::string codebook
     case -1:
     case 0x2A:
     case 0x32:
-    case 0x34:
-        m_uid = m_read_32(m_indata);
-        m_blocksize_0_pow = static_cast<uint8_t>(m_indata.get());
-        m_blocksize_1_pow = static_cast<uint8_t>(m_indata.get());
+    case 0x34: {
+        const long uid_offset =
+            m_vorb_offset + ((m_vorb_size == 0x32 || m_vorb_size == 0x34) ? 0x2C : 0x24);
+        m_uid = read_32(uid_offset);
+        m_blocksize_0_pow = ReadAt<uint8_t, Order>(data, uid_offset + 4);
+        m_blocksize_1_pow = ReadAt<uint8_t, Order>(data, uid_offset + 5);
         break;
+    }
 
     default:
         break;
@@ -480,72 +514,110 @@ WwiseRiffVorbis::WwiseRiffVorbis(const std::string& indata, std::string codebook
     }
 }
 
-std::string WwiseRiffVorbis::GetInfo()
+VorbisInfo WwiseRiffVorbis::Info() const
 {
-    std::stringstream info_ss;
-    if (m_little_endian)
-    {
-        info_ss << "RIFF WAVE";
-    }
-    else
-    {
-        info_ss << "RIFX WAVE";
-    }
-    info_ss << " " << m_channels << " channel";
-    if (m_channels != 1)
-    {
-        info_ss << "s";
-    }
-    info_ss << " " << m_sample_rate << " Hz " << m_avg_bytes_per_second * 8 << " bps\n";
-    info_ss << m_sample_count << " samples\n";
-
-    if (m_loop_count != 0)
-    {
-        info_ss << "loop from " << m_loop_start << " to " << m_loop_end << "\n";
-    }
-
+    PacketHeaders packet_headers = PacketHeaders::Standard;
     if (m_old_packet_headers)
     {
-        info_ss << "- 8 byte (old) packet headers\n";
+        packet_headers = PacketHeaders::Old;
     }
     else if (m_no_granule)
     {
-        info_ss << "- 2 byte packet headers, no granule\n";
-    }
-    else
-    {
-        info_ss << "- 6 byte packet headers\n";
+        packet_headers = PacketHeaders::NoGranule;
     }
 
-    if (m_header_triad_present)
+    return {.little_endian = m_little_endian,
+            .channels = m_channels,
+            .sample_rate = m_sample_rate,
+            .avg_bytes_per_second = m_avg_bytes_per_second,
+            .sample_count = m_sample_count,
+            .loop_count = m_loop_count,
+            .loop_start = m_loop_start,
+            .loop_end = m_loop_end,
+            .packet_headers = packet_headers,
+            .header_triad = m_header_triad_present,
+            .full_setup = m_full_setup || m_header_triad_present,
+            .inline_codebooks = m_inline_codebooks || m_header_triad_present,
+            .mod_packets = m_mod_packets};
+}
+
+std::string WwiseRiffVorbis::GetInfo()
+{
+    std::ostringstream info_ss;
+    WriteInfo(Info(), info_ss);
+    return info_ss.str();
+}
+
+void WriteInfo(const VorbisInfo& info, std::ostream& os)
+{
+    os << (info.little_endian ? "RIFF WAVE" : "RIFX WAVE");
+    os << " " << info.channels << " channel";
+    if (info.channels != 1)
     {
-        info_ss << "- Vorbis header triad present\n";
+        os << "s";
     }
+    os << " " << info.sample_rate << " Hz " << info.avg_bytes_per_second * 8 << " bps\n";
+    os << info.sample_count << " samples\n";
 
-    if (m_full_setup || m_header_triad_present)
+    if (info.loop_count != 0)
     {
-        info_ss << "- full setup header\n";
+        os << "loop from " << info.loop_start << " to " << info.loop_end << "\n";
     }
-    else
+
+    switch (info.packet_headers)
     {
-        info_ss << "- stripped setup header\n";
+    case PacketHeaders::Old:
+        os << "- 8 byte (old) packet headers\n";
+        break;
+    case PacketHeaders::NoGranule:
+        os << "- 2 byte packet headers, no granule\n";
+        break;
+    case PacketHeaders::Standard:
+        os << "- 6 byte packet headers\n";
+        break;
     }
 
-    if (m_inline_codebooks || m_header_triad_present)
+    if (info.header_triad)
     {
-        info_ss << "- inline codebooks\n";
+        os << "- Vorbis header triad present\n";
     }
 
-    if (m_mod_packets)
+    os << (info.full_setup ? "- full setup header\n" : "- stripped setup header\n");
+
+    if (info.inline_codebooks)
     {
-        info_ss << "- modified Vorbis packets\n";
+        os << "- inline codebooks\n";
     }
-    else
+
+    os << (info.mod_packets ? "- modified Vorbis packets\n" : "- standard Vorbis packets\n");
+}
+
+void WriteInfoJson(const VorbisInfo& info, std::ostream& os)
+{
+    constexpr std::array<std::string_view, 3> packet_headers = {"old", "no_granule", "standard"};
+
+    wwtools::json::Writer json(os);
+    json.BeginObject()
+        .Member("container", info.little_endian ? "RIFF" : "RIFX")
+        .Member("channels", info.channels)
+        .Member("sample_rate", info.sample_rate)
+        .Member("bitrate", static_cast<std::uint64_t>(info.avg_bytes_per_second) * 8)
+        .Member("sample_count", info.sample_count);
+    if (info.loop_count != 0)
     {
-        info_ss << "- standard Vorbis packets\n";
+        json.Key("loop")
+            .BeginObject()
+            .Member("start", info.loop_start)
+            .Member("end", info.loop_end)
+            .EndObject();
     }
-
-    return info_ss.str();
+    json.Member("packet_headers", packet_headers[static_cast<std::size_t>(info.packet_headers)])
+        .Member("header_triad", info.header_triad)
+        .Member("full_setup", info.full_setup)
+        .Member("inline_codebooks", info.inline_codebooks)
+        .Member("mod_packets", info.mod_packets)
+        .EndObject();
+    os << '\n';
 }
 
 // Reconstructs Vorbis header packets for WEMs where Wwise stripped them.
@@ -668,14 +740,19 @@ void WwiseRiffVorbis::GenerateOggHeader(Bitoggstream& os, std::vector<bool>& mod
 
         os << vhead;
 
-        Packet setup_packet(m_indata, m_data_offset + static_cast<long>(m_setup_packet_offset),
-                            m_little_endian, m_no_granule);
+        const auto setup_packet =
+            Packet::Read(Bytes(), m_data_offset + static_cast<long>(m_setup_packet_offset),
+                         m_little_endian, m_no_granule);
 
         m_indata.seekg(setup_packet.Offset());
         if (setup_packet.Granule() != 0)
         {
             throw ParseErrorStr("setup packet granule != 0");
         }
+        if (m_truncated && setup_packet.NextOffset() > m_file_size)
+        {
+            throw ParseErrorStr("file truncated inside the setup packet");
+        }
         Bitstream ss(m_indata);
 
         // codebook count
@@ -1076,6 +1153,20 @@ void WwiseRiffVorbis::GenerateOggHeader(Bitoggstream& os, std::vector<bool>& mod
 }
 
 // Main entry point: writes a complete OGG Vorbis stream.
+void WwiseRiffVorbis::GenerateOgg(std::ostream& oss)
+{
+    Bitoggstream os(oss);
+    Generate(os);
+}
+
+// Same reconstruction as GenerateOgg, but each packet goes to `sink` unframed.
+void WwiseRiffVorbis::GeneratePackets(PacketSink& sink)
+{
+    Bitoggstream os(sink);
+    Generate(os);
+}
+
+// Shared packet reconstruction behind GenerateOgg and GeneratePackets.
 // First emits the header pages (via triad path or reconstruction), then iterates over
 // all audio packets in the data chunk, translating Wwise framing to OGG pages.
 //
@@ -1083,13 +1174,10 @@ void WwiseRiffVorbis::GenerateOggHeader(Bitoggstream& os, std::vector<bool>& mod
 // reconstruction: Wwise strips the packet-type bit and window-type bits, so we read
 // the mode number, determine block flags, peek at the next packet's mode to figure out
 // the next-window type, and re-emit the correct Vorbis first byte.
-void WwiseRiffVorbis::GenerateOgg(std::ostream& oss)
+void WwiseRiffVorbis::Generate(Bitoggstream& os)
 {
-    Bitoggstream os(oss);
-
     std::vector<bool> mode_blockflag;
     int mode_bits = 0;
-    bool prev_blockflag = false;
 
     if (m_header_triad_present)
     {
@@ -1100,160 +1188,177 @@ void WwiseRiffVorbis::GenerateOgg(std::ostream& oss)
         GenerateOggHeader(os, mode_blockflag, mode_bits);
     }
 
-    // Audio pages
-    {
-        long offset = m_data_offset + static_cast<long>(m_first_audio_packet_offset);
-
-        while (offset < m_data_offset + m_data_size)
+    // Bind the packet format one parameter at a time; each combination is its own instantiation
+    // of the audio loop
+    const auto with_mod_packets = [&](auto order, auto headers) {
+        constexpr auto order_v = decltype(order)::value;
+        constexpr auto headers_v = decltype(headers)::value;
+        if (m_mod_packets)
         {
-            uint32_t size = 0;
-            uint32_t granule = 0;
-            long packet_header_size = 0;
-            long packet_payload_offset = 0;
-            long next_offset = 0;
-
-            if (m_old_packet_headers)
-            {
-                Packet8 audio_packet(m_indata, offset, m_little_endian);
-                packet_header_size = audio_packet.HeaderSize();
-                size = audio_packet.Size();
-                packet_payload_offset = audio_packet.Offset();
-                granule = audio_packet.Granule();
-                next_offset = audio_packet.NextOffset();
-            }
-            else
-            {
-                Packet audio_packet(m_indata, offset, m_little_endian, m_no_granule);
-                packet_header_size = audio_packet.HeaderSize();
-                size = audio_packet.Size();
-                packet_payload_offset = audio_packet.Offset();
-                granule = audio_packet.Granule();
-                next_offset = audio_packet.NextOffset();
-            }
-
-            if (offset + packet_header_size > m_data_offset + m_data_size)
-            {
-                throw ParseErrorStr("page header truncated");
-            }
-
-            offset = packet_payload_offset;
-
-            m_indata.seekg(offset);
-            // HACK: don't know what to do here
-            if (granule == UINT32_C(0xFFFFFFFF))
-            {
-                os.SetGranule(1);
-            }
-            else
-            {
-                os.SetGranule(granule);
-            }
-
-            // first byte
-            if (m_mod_packets)
-            {
-                // need to rebuild packet type and window info
-
-                if (mode_blockflag.empty())
-                {
-                    throw ParseErrorStr("didn't load mode_blockflag");
-                }
-
-                // OUT: 1 bit packet type (0 == audio)
-                BitUint<1> packet_type(0);
-                os << packet_type;
+            GenerateAudio<order_v, headers_v, true>(os, mode_blockflag, mode_bits);
+        }
+        else
+        {
+            GenerateAudio<order_v, headers_v, false>(os, mode_blockflag, mode_bits);
+        }
+    };
+    const auto with_headers = [&](auto order) {
+        switch (Info().packet_headers)
+        {
+        case PacketHeaders::Old:
+            with_mod_packets(order, HeaderFormat<PacketHeaders::Old>{});
+            break;
+        case PacketHeaders::NoGranule:
+            with_mod_packets(order, HeaderFormat<PacketHeaders::NoGranule>{});
+            break;
+        case PacketHeaders::Standard:
+            with_mod_packets(order, HeaderFormat<PacketHeaders::Standard>{});
+            break;
+        }
+    };
 
-                BitUintv mode_number(mode_bits);
-                BitUintv remainder(8 - mode_bits);
+    if (m_little_endian)
+    {
+        with_headers(ByteOrder<std::endian::little>{});
+    }
+    else
+    {
+        with_headers(ByteOrder<std::endian::big>{});
+    }
+}
 
-                {
-                    // collect mode number from first byte
-                    Bitstream ss(m_indata);
+// Audio half of Generate.  The byte order, header format and packet modification are template
+// parameters, so the per-packet loop reads headers with plain loads and has no format branches.
+template <std::endian Order, PacketHeaders Headers, bool ModPackets>
+void WwiseRiffVorbis::GenerateAudio(Bitoggstream& os, const std::vector<bool>& mode_blockflag,
+                                    const int mode_bits)
+{
+    constexpr bool no_granule = Headers == PacketHeaders::NoGranule;
 
-                    // IN/OUT: N bit mode number (max 6 bits)
-                    ss >> mode_number;
-                    os << mode_number;
+    const auto data = Bytes();
+    const long data_end = m_data_offset + m_data_size;
+    const unsigned int mode_mask = (1U << static_cast<unsigned int>(mode_bits)) - 1U;
 
-                    // IN: remaining bits of first (input) byte
-                    ss >> remainder;
-                }
+    const auto read_header = [&](const long header_offset) {
+        if constexpr (Headers == PacketHeaders::Old)
+        {
+            return Packet8::Read<Order>(data, header_offset);
+        }
+        else
+        {
+            return Packet::Read<Order>(data, header_offset, no_granule);
+        }
+    };
+    const auto block_flag = [&](const unsigned int mode_number) {
+        if (mode_number >= mode_blockflag.size())
+        {
+            throw ParseErrorStr("mode number out of range");
+        }
+        return static_cast<bool>(mode_blockflag[mode_number]);
+    };
 
-                if (mode_blockflag[mode_number])
-                {
-                    // long window, peek at next frame
+    long offset = m_data_offset + static_cast<long>(m_first_audio_packet_offset);
+    bool prev_blockflag = false;
 
-                    m_indata.seekg(next_offset);
-                    bool next_blockflag = false;
-                    if (next_offset + packet_header_size <= m_data_offset + m_data_size)
-                    {
+    // In a truncated file the stream ends with the last packet that is there in full (including
+    // the first byte read even for an empty packet)
+    constexpr long header_size = Headers == PacketHeaders::Old ? 8 : (no_granule ? 2 : 6);
+    const auto complete = [&](const long header_offset) {
+        if (header_offset + header_size > data_end)
+        {
+            return false;
+        }
+        const auto packet = read_header(header_offset);
+        return packet.Offset() + std::max(static_cast<long>(packet.Size()), 1L) <= data_end;
+    };
 
-                        // mod_packets always goes with 6-byte headers
-                        Packet audio_packet(m_indata, next_offset, m_little_endian, m_no_granule);
-                        const uint32_t next_packet_size = audio_packet.Size();
-                        if (next_packet_size > 0)
-                        {
-                            m_indata.seekg(audio_packet.Offset());
+    if constexpr (ModPackets)
+    {
+        if (mode_blockflag.empty() && offset < data_end)
+        {
+            throw ParseErrorStr("didn't load mode_blockflag");
+        }
+    }
 
-                            Bitstream ss(m_indata);
-                            BitUintv next_mode_number(mode_bits);
+    while (offset < data_end && (!m_truncated || complete(offset)))
+    {
+        const auto audio_packet = read_header(offset);
+        if (offset + audio_packet.HeaderSize() > data_end)
+        {
+            throw ParseErrorStr("page header truncated");
+        }
 
-                            ss >> next_mode_number;
+        const auto size = static_cast<uint32_t>(audio_packet.Size());
+        const long next_offset = audio_packet.NextOffset();
+        offset = audio_packet.Offset();
 
-                            next_blockflag = mode_blockflag[next_mode_number];
-                        }
-                    }
+        // the first byte is read even for an empty packet
+        if (offset + std::max(static_cast<long>(size), 1L) > m_file_size)
+        {
+            throw ParseErrorStr("file truncated");
+        }
+        const auto first = std::to_integer<unsigned int>(data[static_cast<std::size_t>(offset)]);
 
-                    // OUT: previous window type bit
-                    BitUint<1> prev_window_type(prev_blockflag ? 1 : 0);
-                    os << prev_window_type;
+        // HACK: don't know what to do here
+        const uint32_t granule = audio_packet.Granule();
+        os.SetGranule(granule == UINT32_C(0xFFFFFFFF) ? 1 : granule);
 
-                    // OUT: next window type bit
-                    BitUint<1> next_window_type(next_blockflag ? 1 : 0);
-                    os << next_window_type;
+        if constexpr (ModPackets)
+        {
+            // need to rebuild packet type and window info
 
-                    // fix seek for rest of stream
-                    m_indata.seekg(offset + 1);
-                }
+            // OUT: 1 bit packet type (0 == audio)
+            os.PutBit(false);
 
-                prev_blockflag = mode_blockflag[mode_number];
+            // IN/OUT: N bit mode number (max 6 bits)
+            const unsigned int mode_number = first & mode_mask;
+            PutBits(os, mode_number, mode_bits);
 
-                // OUT: remaining bits of first (input) byte
-                os << remainder;
-            }
-            else
+            if (block_flag(mode_number))
             {
-                // nothing unusual for first byte
-                int v = m_indata.get();
-                if (v < 0)
+                // long window, peek at next frame
+                bool next_blockflag = false;
+                if (next_offset + audio_packet.HeaderSize() <= data_end &&
+                    (!m_truncated || complete(next_offset)))
                 {
-                    throw ParseErrorStr("file truncated");
+                    // mod_packets always goes with 6-byte headers
+                    const auto next_packet = Packet::Read<Order>(data, next_offset, no_granule);
+                    if (next_packet.Size() > 0)
+                    {
+                        const auto next_first = ReadAt<uint8_t, Order>(data, next_packet.Offset());
+                        next_blockflag = block_flag(next_first & mode_mask);
+                    }
                 }
-                BitUint<8> c(static_cast<unsigned int>(v));
-                os << c;
-            }
 
-            // remainder of packet
-            for (unsigned int i = 1; i < size; ++i)
-            {
-                int v = m_indata.get();
-                if (v < 0)
-                {
-                    throw ParseErrorStr("file truncated");
-                }
-                BitUint<8> c(static_cast<unsigned int>(v));
-                os << c;
+                // OUT: previous and next window type bits
+                os.PutBit(prev_blockflag);
+                os.PutBit(next_blockflag);
             }
 
-            offset = next_offset;
-            os.FlushPage(false, (offset == m_data_offset + m_data_size));
+            prev_blockflag = block_flag(mode_number);
+
+            // OUT: remaining bits of first (input) byte
+            PutBits(os, first >> static_cast<unsigned int>(mode_bits), 8 - mode_bits);
+        }
+        else
+        {
+            // nothing unusual for first byte
+            PutBits(os, first, 8);
         }
-        if (offset > m_data_offset + m_data_size)
+
+        // remainder of packet
+        if (size > 1)
         {
-            throw ParseErrorStr("page truncated");
+            os.PutBytes(data.subspan(static_cast<std::size_t>(offset) + 1, size - 1));
         }
-    }
 
-    mode_blockflag.clear();
+        offset = next_offset;
+        os.FlushPage(false, offset == data_end || (m_truncated && !complete(offset)));
+    }
+    if (offset > data_end && !m_truncated)
+    {
+        throw ParseErrorStr("page truncated");
+    }
 }
 
 // Copies the Vorbis header triad verbatim from older WEM files that already include
@@ -1267,7 +1372,7 @@ void WwiseRiffVorbis::GenerateOggHeaderWithTriad(Bitoggstream& os)
 
         // copy information packet
         {
-            Packet8 information_packet(m_indata, offset, m_little_endian);
+            const auto information_packet = Packet8::Read(Bytes(), offset, m_little_endian);
             const uint32_t size = information_packet.Size();
 
             if (information_packet.Granule() != 0)
@@ -1299,7 +1404,7 @@ void WwiseRiffVorbis::GenerateOggHeaderWithTriad(Bitoggstream& os)
 
         // copy comment packet
         {
-            Packet8 comment_packet(m_indata, offset, m_little_endian);
+            const auto comment_packet = Packet8::Read(Bytes(), offset, m_little_endian);
             const auto size = static_cast<uint16_t>(comment_packet.Size());
 
             if (comment_packet.Granule() != 0)
@@ -1331,7 +1436,7 @@ void WwiseRiffVorbis::GenerateOggHeaderWithTriad(Bitoggstream& os)
 
         // copy setup packet
         {
-            Packet8 setup_packet(m_indata, offset, m_little_endian);
+            const auto setup_packet = Packet8::Read(Bytes(), offset, m_little_endian);
 
             m_indata.seekg(setup_packet.Offset());
             if (setup_packet.Granule() != 0)
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <bit>
+#include <cstddef>
 #include <cstdint>
 #include <istream>
 #include <memory>
 #include <ostream>
+#include <span>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -24,6 +27,32 @@ enum ForcePacketFormat
     K_FORCE_NO_MOD_PACKETS    // force standard Vorbis packets
 };
 
+// Audio packet header layouts found in WEMs.
+enum class PacketHeaders : std::uint8_t
+{
+    Old,       // 8 bytes: size u32 + granule u32 (older WEMs with the header triad)
+    NoGranule, // 2 bytes: size u16
+    Standard,  // 6 bytes: size u16 + granule u32
+};
+
+// Stream parameters and packet format of a parsed WEM, see WwiseRiffVorbis::Info.
+struct VorbisInfo
+{
+    bool little_endian; // RIFF rather than RIFX
+    uint16_t channels;
+    uint32_t sample_rate;
+    uint32_t avg_bytes_per_second;
+    uint32_t sample_count;
+    uint32_t loop_count;
+    uint32_t loop_start; // in samples
+    uint32_t loop_end;   // in samples (exclusive)
+    PacketHeaders packet_headers;
+    bool header_triad;     // the full id/comment/setup triad is stored in the WEM
+    bool full_setup;       // the setup header is complete rather than stripped
+    bool inline_codebooks; // codebooks are stored in the setup header rather than referenced
+    bool mod_packets;      // Wwise "modified" packets needing window-bit reconstruction
+};
+
 // Parses a Wwise RIFF/RIFX Vorbis WEM file and reconstructs a valid OGG Vorbis stream.
 //
 // Wwise strips parts of the Vorbis setup (codebooks, floor/residue configs) and uses its
@@ -36,7 +65,7 @@ enum ForcePacketFormat
 class WwiseRiffVorbis
 {
     std::string m_codebooks_data; // external packed codebook data (or empty if inline)
-    std::stringstream m_indata;   // in-memory copy of the WEM file
+    std::istringstream m_indata;  // the WEM file, read through Bytes() or as a bit stream
     long m_file_size = -1;
 
     bool m_little_endian = true; // RIFF = LE, RIFX = BE
@@ -84,19 +113,39 @@ class WwiseRiffVorbis
 
     const bool m_inline_codebooks;       // true: codebooks are in the WEM, not external
     const bool m_full_setup;             // true: full Vorbis setup header (not stripped)
+    const bool m_allow_truncated;        // true: a file cut short converts as far as it goes
+    bool m_truncated = false;            // the file ends before the RIFF size says it does
     bool m_header_triad_present = false; // older WEMs include the full id/comment/setup triad
     bool m_old_packet_headers = false;   // older 8-byte packet headers (size:u32 + granule:u32)
     bool m_no_granule = false;           // 2-byte headers with no granule field
     bool m_mod_packets = false; // Wwise "modified" packets needing window-bit reconstruction
 
-    // Endian-aware read functions, set once based on RIFF vs RIFX
-    uint16_t (*m_read_16)(std::istream& is) = nullptr;
-    uint32_t (*m_read_32)(std::istream& is) = nullptr;
+    // The WEM file as contiguous bytes, without copying them out of m_indata.
+    [[nodiscard]] std::span<const std::byte> Bytes() const
+    {
+        return std::as_bytes(std::span(m_indata.view()));
+    }
+
+    // Reads the chunks and format fields, in the byte order selected by the RIFF/RIFX magic.
+    template <std::endian Order> void Parse(ForcePacketFormat force_packet_format);
+
+    // Emits the header packets followed by every audio packet into `os`.
+    void Generate(Bitoggstream& os);
+
+    template <std::endian Order, PacketHeaders Headers, bool ModPackets>
+    void GenerateAudio(Bitoggstream& os, const std::vector<bool>& mode_blockflag, int mode_bits);
 
 public:
     // Parses the entire RIFF structure and validates chunks.  Throws ParseError on malformed input.
-    WwiseRiffVorbis(const std::string& indata, std::string codebooks_data, bool inline_codebooks,
-                    bool full_setup, ForcePacketFormat force_packet_format);
+    // With `allow_truncated`, a file ending inside its data chunk (such as the prefetch stub a
+    // bank embeds for a streamed sound) is accepted, and only its complete audio packets are
+    // converted, the last of them ending the stream.
+    WwiseRiffVorbis(std::string indata, std::string codebooks_data, bool inline_codebooks,
+                    bool full_setup, ForcePacketFormat force_packet_format,
+                    bool allow_truncated = false);
+
+    // Returns the parsed WEM metadata.
+    [[nodiscard]] VorbisInfo Info() const;
 
     // Returns a human-readable summary of the parsed WEM metadata.
     [[nodiscard]] std::string GetInfo();
@@ -104,6 +153,28 @@ public:
     // Writes a complete OGG Vorbis stream (headers + audio) to `os`.
     void GenerateOgg(std::ostream& os);
 
+    // Hands the reconstructed Vorbis packets (3 headers, then audio) to `sink` without
+    // wrapping them in OGG pages.
+    void GeneratePackets(PacketSink& sink);
+
+    [[nodiscard]] uint16_t Channels() const
+    {
+        return m_channels;
+    }
+    [[nodiscard]] uint32_t SampleRate() const
+    {
+        return m_sample_rate;
+    }
+    [[nodiscard]] uint32_t SampleCount() const
+    {
+        return m_sample_count;
+    }
+    // True when the file is shorter than its RIFF header says (only with `allow_truncated`).
+    [[nodiscard]] bool Truncated() const
+    {
+        return m_truncated;
+    }
+
     // Rebuilds the Vorbis header packets (id, comment, setup) for stripped WEMs.
     // Outputs mode_blockflag and mode_bits needed by GenerateOgg for modified-packet decoding.
     void GenerateOggHeader(Bitoggstream& os, std::vector<bool>& mode_blockflag, int& mode_bits);
@@ -112,4 +183,9 @@ public:
     void GenerateOggHeaderWithTriad(Bitoggstream& os);
 };
 
+// Writes the metadata in the format of WwiseRiffVorbis::GetInfo, or as a JSON object followed by a
+// newline.
+void WriteInfo(const VorbisInfo& info, std::ostream& os);
+void WriteInfoJson(const VorbisInfo& info, std::ostream& os);
+
 } // namespace ww2ogg
@@ -1,57 +1,340 @@
 #include <algorithm>
+#include <bit>
+#include <cstddef>
 #include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <unordered_map>
 #include <vector>
 
-#include "bnk.h"
+#include "file_sink.h"
+#include "output_sink.h"
+#include "parallel.h"
+#include "pcm/convert.h"
+#include "pcm/decoder.h"
+#include "pcm/envelope.h"
 #include "revorb/revorb.h"
+#include "soundbank.h"
+#include "soundbank_writer.h"
+#include "wem/byte_reader.h"
+#include "wem/probe.h"
+#include "ww2ogg/ogg2wem.h"
 #include "ww2ogg/ww2ogg.h"
 #include "wwtools/wwtools.h"
 
+namespace
+{
+
+// Collects decoded blocks into an interleaved Pcm<Sample>, reserving the full size up front.
+template <typename Sample> class InterleavingHandler final : public wwtools::pcm::PcmHandler
+{
+    wwtools::Pcm<Sample>& m_out;
+
+public:
+    explicit InterleavingHandler(wwtools::Pcm<Sample>& out) : m_out(out)
+    {
+    }
+
+    void OnStart(const std::uint16_t channels, const std::uint32_t sample_rate,
+                 const std::uint64_t frames) override
+    {
+        m_out.channels = channels;
+        m_out.sample_rate = sample_rate;
+        m_out.samples.reserve(static_cast<std::size_t>(frames) * channels);
+    }
+
+    void OnBlock(const float* const* planar, const std::size_t frames) override
+    {
+        const auto offset = m_out.samples.size();
+        m_out.samples.resize(offset + frames * m_out.channels);
+
+        const std::span<Sample> dst(m_out.samples.data() + offset, frames * m_out.channels);
+        if constexpr (std::is_same_v<Sample, std::int16_t>)
+        {
+            wwtools::pcm::InterleaveInt16(planar, m_out.channels, frames, dst);
+        }
+        else
+        {
+            wwtools::pcm::InterleaveFloat(planar, m_out.channels, frames, dst);
+        }
+    }
+};
+
+template <typename Sample>
+[[nodiscard]] wwtools::Pcm<Sample> DecodeInterleaved(const std::string_view indata)
+{
+    wwtools::Pcm<Sample> result{};
+    InterleavingHandler<Sample> handler(result);
+    wwtools::pcm::DecodeWem(indata, handler);
+    return result;
+}
+
+// Rewrites the granule positions of an OGG stream, reading its pages where they are.
+[[nodiscard]] std::string Revorbed(const std::string_view ogg)
+{
+    wwtools::MemorySink revorb_out;
+    if (!revorb::Revorb(std::as_bytes(std::span(ogg)), revorb_out))
+    {
+        throw std::runtime_error("revorb failed to fix OGG granule positions");
+    }
+    return revorb_out.Take();
+}
+
+// Granule position of the last page of an OGG stream, which after Revorb is the number of samples
+// it decodes to (0 without audio pages).
+[[nodiscard]] std::uint64_t FinalGranule(const std::string_view ogg)
+{
+    constexpr std::size_t page_header_size = 27;
+
+    const auto data = std::as_bytes(std::span(ogg));
+    std::int64_t granule = 0;
+    for (std::size_t offset = 0; offset + page_header_size <= data.size();)
+    {
+        const auto page_granule = wwtools::wem::Load<std::int64_t, std::endian::little>(data,
+                                                                                        offset + 6);
+        if (page_granule != -1)
+        {
+            granule = page_granule;
+        }
+
+        const auto segments = std::to_integer<std::size_t>(data[offset + 26]);
+        std::size_t page_size = page_header_size + segments;
+        for (std::size_t i = 0; i < segments && offset + page_header_size + i < data.size(); ++i)
+        {
+            page_size += std::to_integer<std::size_t>(data[offset + page_header_size + i]);
+        }
+        offset += page_size;
+    }
+    return static_cast<std::uint64_t>(std::max<std::int64_t>(granule, 0));
+}
+
+// Placeholder for entries that carry no decodable audio.
+[[nodiscard]] wwtools::Waveform EmptyWaveform(const std::size_t resolution)
+{
+    return wwtools::Waveform{
+        .channels = 0, .sample_rate = 0, .frames = 0, .resolution = resolution, .points = {}};
+}
+
+// Lays out `indata` with `wems` replaced; the bank and the WEMs must outlive the writer.
+[[nodiscard]] wwtools::bnk::SoundbankWriter ReplacedBank(
+    const std::string_view indata, const std::unordered_map<std::uint32_t, std::string_view>& wems)
+{
+    std::unordered_map<std::uint32_t, std::span<const std::byte>> payloads;
+    payloads.reserve(wems.size());
+    for (const auto& [id, wem] : wems)
+    {
+        payloads.emplace(id, std::as_bytes(std::span(wem)));
+    }
+    return {std::as_bytes(std::span(indata)), payloads};
+}
+
+} // anonymous namespace
+
 namespace wwtools
 {
 
 [[nodiscard]] std::string Wem2Ogg(const std::string_view indata)
 {
-    std::stringstream wem_out;
-    std::stringstream revorb_out;
+    std::ostringstream wem_out;
 
     // Convert WEM to intermediate OGG format
     ww2ogg::Ww2Ogg(std::string{indata}, wem_out);
 
     // Fix granule positions in the OGG stream
-    if (!revorb::Revorb(wem_out, revorb_out))
+    return Revorbed(wem_out.view());
+}
+
+[[nodiscard]] PartialOgg Wem2OggPrefix(const std::string_view indata)
+{
+    std::ostringstream wem_out;
+    const bool complete = ww2ogg::Ww2OggPrefix(std::string{indata}, wem_out);
+
+    auto ogg = Revorbed(wem_out.view());
+    const auto samples = FinalGranule(ogg);
+    return PartialOgg{.ogg = std::move(ogg), .samples = samples, .complete = complete};
+}
+
+void Wem2OggFile(const std::string_view indata, const std::filesystem::path& outpath)
+{
+    std::ostringstream wem_out;
+    ww2ogg::Ww2Ogg(std::string{indata}, wem_out);
+
+    try
     {
-        throw std::runtime_error("revorb failed to fix OGG granule positions");
+        FileSink out(outpath);
+        if (!revorb::Revorb(std::as_bytes(std::span(wem_out.view())), out))
+        {
+            throw std::runtime_error("revorb failed to fix OGG granule positions");
+        }
+        out.Close();
+    }
+    catch (const std::exception&)
+    {
+        std::error_code ec;
+        std::filesystem::remove(outpath, ec);
+        throw;
     }
+}
+
+[[nodiscard]] std::optional<std::string> FixOggGranules(const std::string_view indata)
+{
+    if (revorb::GranulesCorrect(std::as_bytes(std::span(indata))))
+    {
+        return std::nullopt;
+    }
+    return Revorbed(indata);
+}
+
+[[nodiscard]] std::string Ogg2Wem(const std::string_view indata, const WemEncoding& encoding)
+{
+    // Rebuilding every codebook of the library is worth doing once for all conversions
+    static const ww2ogg::CodebookIndex g_codebooks(
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        std::string(reinterpret_cast<const char*>(ww2ogg::g_packed_codebooks_bin),
+                    ww2ogg::g_packed_codebooks_bin_len));
+
+    return ww2ogg::Ogg2Wem(std::as_bytes(std::span(indata)), g_codebooks,
+                           {.packet_headers = encoding.granules ? ww2ogg::PacketHeaders::Standard
+                                                                : ww2ogg::PacketHeaders::NoGranule,
+                            .mod_packets = encoding.mod_packets,
+                            .little_endian = !encoding.big_endian});
+}
+
+[[nodiscard]] OggVerification VerifyOgg(const std::string_view indata)
+{
+    return revorb::Verify(std::as_bytes(std::span(indata)));
+}
+
+[[nodiscard]] std::vector<OggVerification> VerifyOggs(const std::span<const std::string_view> oggs,
+                                                      const unsigned int threads)
+{
+    std::vector<OggVerification> result(oggs.size());
+    parallel::ForEachIndex(
+        oggs.size(), [&](const std::size_t i) { result[i] = VerifyOgg(oggs[i]); }, threads);
+    return result;
+}
+
+[[nodiscard]] Pcm<std::int16_t> Wem2Pcm(const std::string_view indata)
+{
+    return DecodeInterleaved<std::int16_t>(indata);
+}
+
+[[nodiscard]] Pcm<float> Wem2PcmFloat(const std::string_view indata)
+{
+    return DecodeInterleaved<float>(indata);
+}
+
+[[nodiscard]] WemMetadata ProbeWem(const std::span<const std::byte> data)
+{
+    return wem::Probe(data);
+}
 
-    return revorb_out.str();
+[[nodiscard]] Waveform WemWaveform(const std::string_view indata, const std::size_t resolution)
+{
+    if (resolution == 0)
+    {
+        throw std::invalid_argument("waveform resolution must be non-zero");
+    }
+
+    Waveform result = EmptyWaveform(resolution);
+    pcm::EnvelopeHandler handler(result);
+    pcm::DecodeWem(indata, handler);
+    handler.Finish();
+    return result;
 }
 
 [[nodiscard]] std::vector<BnkEntry> BnkExtract(const std::string_view indata)
 {
-    const auto ids = bnk::GetWemIds(indata);
-    const auto streamed_ids = bnk::GetStreamedWemIds(indata);
+    // One zero-copy parse serves the data index and the streamed flags
+    const bnk::Soundbank bank(std::as_bytes(std::span(indata)));
 
-    std::vector<std::string> raw_wems;
-    bnk::Extract(indata, raw_wems);
+    const auto streamed_ids = bank.StreamedWemIds();
 
     std::vector<BnkEntry> result;
-    result.reserve(ids.size());
+    result.reserve(bank.DataIndex().size());
 
-    for (std::size_t i = 0; i < ids.size(); ++i)
+    for (const auto& entry : bank.DataIndex())
     {
         result.push_back({
-            .id = ids[i],
-            .streamed = std::ranges::contains(streamed_ids, ids[i]),
-            .data = (i < raw_wems.size()) ? std::move(raw_wems[i]) : std::string{},
+            .id = entry.id,
+            .streamed = std::ranges::contains(streamed_ids, entry.id),
+            .data = bank.HasData() ? std::string{indata.substr(entry.offset, entry.size)}
+                                   : std::string{},
         });
     }
 
     return result;
 }
 
+void BnkReplace(const std::string_view indata,
+                const std::unordered_map<std::uint32_t, std::string_view>& wems, std::ostream& os)
+{
+    const auto writer = ReplacedBank(indata, wems);
+    StreamSink sink(os);
+    writer.Write(sink);
+    if (!os.flush())
+    {
+        throw std::runtime_error("failed to write BNK");
+    }
+}
+
+void BnkReplaceFile(const std::string_view indata,
+                    const std::unordered_map<std::uint32_t, std::string_view>& wems,
+                    const std::filesystem::path& outpath)
+{
+    const auto writer = ReplacedBank(indata, wems);
+    try
+    {
+        FileSink out(outpath);
+        writer.Write(out);
+        out.Close();
+    }
+    catch (const std::exception&)
+    {
+        std::error_code ec;
+        std::filesystem::remove(outpath, ec);
+        throw;
+    }
+}
+
+[[nodiscard]] std::vector<Waveform> BnkWaveforms(const std::span<const BnkEntry> entries,
+                                                 const std::size_t resolution,
+                                                 const unsigned int threads)
+{
+    if (resolution == 0)
+    {
+        throw std::invalid_argument("waveform resolution must be non-zero");
+    }
+
+    std::vector<Waveform> result(entries.size(), EmptyWaveform(resolution));
+
+    parallel::ForEachIndex(
+        entries.size(),
+        [&](const std::size_t i) {
+            if (entries[i].streamed)
+            {
+                return;
+            }
+            try
+            {
+                result[i] = WemWaveform(entries[i].data, resolution);
+            }
+            catch (const std::exception&)
+            {
+                result[i] = EmptyWaveform(resolution);
+            }
+        },
+        threads);
+
+    return result;
+}
+
 } // namespace wwtools
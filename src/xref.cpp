@@ -0,0 +1,413 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "manifest.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include "scan.h"
+#include "soundbank.h"
+#include "version.h"
+#include "wwtools/wwtools.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+constexpr std::array<char, 4> g_xref_magic = {'W', 'W', 'X', 'R'};
+constexpr std::uint32_t g_xref_version = 1;
+
+// Bound on the strings and lists of a stored index, so a corrupt length fails instead of
+// allocating gigabytes
+constexpr std::uint32_t g_max_stored_length = 1U << 20U;
+
+// Object IDs from an action's target down to the object playing `wem`, found by walking the
+// parent links back up from that object.
+[[nodiscard]] std::vector<std::uint32_t> PathTo(const wwtools::bnk::Soundbank& bank,
+                                                const wwtools::bnk::ResolvedWem& wem,
+                                                const std::uint32_t target_id)
+{
+    std::vector<std::uint32_t> path;
+    path.reserve(wem.depth + 1);
+
+    std::uint32_t object = wem.object;
+    for (std::uint32_t step = 0; step <= wem.depth; ++step)
+    {
+        if (object == wwtools::bnk::g_no_object)
+        {
+            // The target is a container stored in another bank
+            path.push_back(target_id);
+            break;
+        }
+        path.push_back(bank.Objects()[object].id);
+        object = bank.Parent(object);
+    }
+
+    std::ranges::reverse(path);
+    return path;
+}
+
+// Every (event, action, WEM) triple of a bank, in event order.
+[[nodiscard]] std::vector<wwtools::WemReference> ReadReferences(
+    const std::span<const std::byte> data)
+{
+    using wwtools::bnk::EventActionRecord;
+    using wwtools::bnk::EventRecord;
+
+    const wwtools::bnk::Soundbank bank(data);
+
+    std::unordered_map<std::uint32_t, std::string_view> names;
+    for (const auto& name : bank.Names())
+    {
+        names.try_emplace(name.id, name.name);
+    }
+
+    std::vector<wwtools::WemReference> references;
+    std::vector<wwtools::bnk::ResolvedWem> wems;
+    for (const auto& object : bank.Objects())
+    {
+        const auto* event = std::get_if<EventRecord>(&object.data);
+        if (event == nullptr)
+        {
+            continue;
+        }
+
+        const auto name = names.find(object.id);
+        const auto event_name = name != names.end() ? name->second : std::string_view{};
+
+        for (std::size_t i = 0; i < event->action_count; ++i)
+        {
+            const auto index = bank.Find(bank.EventActionId(*event, i));
+            if (!index)
+            {
+                continue;
+            }
+            const auto* action = std::get_if<EventActionRecord>(&bank.Objects()[*index].data);
+            if (action == nullptr || action->target_id == 0)
+            {
+                continue;
+            }
+
+            wems.clear();
+            bank.ResolveTarget(action->target_id, wems);
+            for (const auto& wem : wems)
+            {
+                references.push_back({.wem_id = wem.wem_id,
+                                      .event_id = object.id,
+                                      .event_name = std::string{event_name},
+                                      .action_type = static_cast<std::uint8_t>(action->type),
+                                      .path = PathTo(bank, wem, action->target_id)});
+            }
+        }
+    }
+
+    return references;
+}
+
+void BuildHits(wwtools::WemXref& xref)
+{
+    std::size_t total = 0;
+    for (const auto& bank : xref.banks)
+    {
+        total += bank.references.size();
+    }
+
+    xref.hits.clear();
+    xref.hits.reserve(total);
+    for (std::size_t b = 0; b < xref.banks.size(); ++b)
+    {
+        const auto& references = xref.banks[b].references;
+        for (std::size_t r = 0; r < references.size(); ++r)
+        {
+            xref.hits.push_back({.wem_id = references[r].wem_id,
+                                 .bank = static_cast<std::uint32_t>(b),
+                                 .reference = static_cast<std::uint32_t>(r)});
+        }
+    }
+
+    // Stable, so the hits of one WEM stay in bank and reference order
+    std::ranges::stable_sort(xref.hits, {}, &wwtools::XrefHit::wem_id);
+}
+
+template <typename T> void Put(std::ostream& os, const T value)
+{
+    T stored = value;
+    if constexpr (std::endian::native != std::endian::little)
+    {
+        stored = std::byteswap(stored);
+    }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    os.write(reinterpret_cast<const char*>(&stored), sizeof(T));
+}
+
+void PutString(std::ostream& os, const std::string_view text)
+{
+    Put(os, static_cast<std::uint32_t>(text.size()));
+    os.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+template <typename T> [[nodiscard]] T Get(std::istream& is)
+{
+    T value{};
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (!is.read(reinterpret_cast<char*>(&value), sizeof(T)))
+    {
+        throw std::runtime_error("reverse index is truncated");
+    }
+    if constexpr (std::endian::native != std::endian::little)
+    {
+        value = std::byteswap(value);
+    }
+    return value;
+}
+
+[[nodiscard]] std::uint32_t GetLength(std::istream& is)
+{
+    const auto length = Get<std::uint32_t>(is);
+    if (length > g_max_stored_length)
+    {
+        throw std::runtime_error(std::format("reverse index holds a length of {}", length));
+    }
+    return length;
+}
+
+[[nodiscard]] std::string GetString(std::istream& is)
+{
+    std::string text(GetLength(is), '\0');
+    if (!is.read(text.data(), static_cast<std::streamsize>(text.size())))
+    {
+        throw std::runtime_error("reverse index is truncated");
+    }
+    return text;
+}
+
+} // anonymous namespace
+
+namespace wwtools
+{
+
+[[nodiscard]] std::span<const XrefHit> WemXref::Find(const std::uint32_t wem_id) const
+{
+    const auto [first, last] = std::ranges::equal_range(hits, wem_id, {}, &XrefHit::wem_id);
+    return {first, last};
+}
+
+[[nodiscard]] std::size_t UpdateXref(WemXref& xref, const fs::path& root,
+                                    const unsigned int threads)
+{
+    const auto files = scan::FindFiles(root, {".bnk"});
+
+    std::unordered_map<std::string, std::size_t> previous;
+    for (std::size_t i = 0; i < xref.banks.size(); ++i)
+    {
+        previous.try_emplace(xref.banks[i].path, i);
+    }
+
+    // Banks whose size and mtime are unchanged are carried over here; the others are read below
+    std::vector<XrefBank> banks(files.size());
+    std::vector<std::optional<std::size_t>> old_index(files.size());
+    std::vector<std::size_t> stale;
+    for (std::size_t i = 0; i < files.size(); ++i)
+    {
+        auto& bank = banks[i];
+        bank.path = files[i].lexically_relative(root).generic_string();
+        bank.size = fs::file_size(files[i]);
+        bank.mtime = manifest::ModificationTime(files[i]);
+
+        if (const auto it = previous.find(bank.path); it != previous.end())
+        {
+            old_index[i] = it->second;
+            auto& old = xref.banks[it->second];
+            if (old.size == bank.size && old.mtime == bank.mtime)
+            {
+                bank.hash = old.hash;
+                bank.references = std::move(old.references);
+                continue;
+            }
+        }
+        stale.push_back(i);
+    }
+
+    // Touched banks keep their references when their bytes did not change.  Unreadable banks are
+    // reported and left out of the index, so the next update tries them again.
+    std::vector<std::string> errors(files.size());
+    parallel::ForEachIndex(
+        stale.size(),
+        [&](const std::size_t s) {
+            const auto i = stale[s];
+            auto& bank = banks[i];
+            try
+            {
+                const MappedFile file(files[i]);
+                bank.hash = manifest::Hash(file.Bytes());
+
+                if (old_index[i])
+                {
+                    auto& old = xref.banks[*old_index[i]];
+                    if (old.size == bank.size && old.hash == bank.hash)
+                    {
+                        bank.references = std::move(old.references);
+                        return;
+                    }
+                }
+                bank.references = ReadReferences(file.Bytes());
+            }
+            catch (const std::exception& e)
+            {
+                errors[i] = e.what();
+            }
+        },
+        threads);
+
+    const auto matched = static_cast<std::size_t>(
+        std::ranges::count_if(old_index, [](const auto& index) { return index.has_value(); }));
+    const auto dropped = xref.banks.size() - matched;
+
+    xref.banks.clear();
+    xref.failed.clear();
+    xref.errors.clear();
+    for (std::size_t i = 0; i < files.size(); ++i)
+    {
+        if (errors[i].empty())
+        {
+            xref.banks.push_back(std::move(banks[i]));
+        }
+        else
+        {
+            xref.failed.push_back(std::move(banks[i].path));
+            xref.errors.push_back(std::move(errors[i]));
+        }
+    }
+    BuildHits(xref);
+    return stale.size() + dropped;
+}
+
+void WriteXref(const WemXref& xref, std::ostream& os)
+{
+    os.write(g_xref_magic.data(), g_xref_magic.size());
+    Put(os, g_xref_version);
+    PutString(os, g_tool_version);
+    Put(os, static_cast<std::uint32_t>(xref.banks.size()));
+
+    for (const auto& bank : xref.banks)
+    {
+        PutString(os, bank.path);
+        Put(os, bank.size);
+        Put(os, bank.mtime);
+        Put(os, bank.hash);
+        Put(os, static_cast<std::uint32_t>(bank.references.size()));
+
+        for (const auto& reference : bank.references)
+        {
+            Put(os, reference.wem_id);
+            Put(os, reference.event_id);
+            Put(os, reference.action_type);
+            PutString(os, reference.event_name);
+            Put(os, static_cast<std::uint32_t>(reference.path.size()));
+            for (const auto id : reference.path)
+            {
+                Put(os, id);
+            }
+        }
+    }
+}
+
+[[nodiscard]] WemXref ReadXref(std::istream& is)
+{
+    std::array<char, 4> magic{};
+    if (!is.read(magic.data(), magic.size()) || magic != g_xref_magic ||
+        Get<std::uint32_t>(is) != g_xref_version)
+    {
+        throw std::runtime_error("not a reverse index");
+    }
+
+    WemXref xref;
+    if (GetString(is) != g_tool_version)
+    {
+        return xref;
+    }
+
+    const auto bank_count = Get<std::uint32_t>(is);
+    for (std::uint32_t b = 0; b < bank_count; ++b)
+    {
+        auto& bank = xref.banks.emplace_back();
+        bank.path = GetString(is);
+        bank.size = Get<std::uint64_t>(is);
+        bank.mtime = Get<std::int64_t>(is);
+        bank.hash = Get<std::uint64_t>(is);
+
+        const auto reference_count = Get<std::uint32_t>(is);
+        for (std::uint32_t r = 0; r < reference_count; ++r)
+        {
+            auto& reference = bank.references.emplace_back();
+            reference.wem_id = Get<std::uint32_t>(is);
+            reference.event_id = Get<std::uint32_t>(is);
+            reference.action_type = Get<std::uint8_t>(is);
+            reference.event_name = GetString(is);
+
+            const auto path_length = GetLength(is);
+            reference.path.resize(path_length);
+            for (auto& id : reference.path)
+            {
+                id = Get<std::uint32_t>(is);
+            }
+        }
+    }
+
+    BuildHits(xref);
+    return xref;
+}
+
+void WriteXrefCsv(const WemXref& xref, std::ostream& os,
+                  const std::span<const std::uint32_t> wem_ids)
+{
+    const auto write = [&](const XrefHit& hit) {
+        const auto& reference = xref.Reference(hit);
+
+        auto action = std::string{bnk::ActionTypeName(bnk::ActionType{reference.action_type})};
+        if (action.empty())
+        {
+            action = std::to_string(reference.action_type);
+        }
+
+        std::string path;
+        for (const auto id : reference.path)
+        {
+            path += std::format("{}{}", path.empty() ? "" : "/", id);
+        }
+
+        os << std::format("{},{},{},{},{},{}\n", reference.wem_id,
+                          scan::CsvField(xref.banks[hit.bank].path), reference.event_id,
+                          scan::CsvField(reference.event_name), action, path);
+    };
+
+    os << "wem,bank,event,event_name,action,path\n";
+    if (wem_ids.empty())
+    {
+        std::ranges::for_each(xref.hits, write);
+        return;
+    }
+    for (const auto wem_id : wem_ids)
+    {
+        std::ranges::for_each(xref.Find(wem_id), write);
+    }
+}
+
+} // namespace wwtools
@@ -0,0 +1,762 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory_resource>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "kaitai/kaitaistream.h"
+#include "kaitai/structs/bnk.h"
+#include "bnk.h"
+#include "soundbank.h"
+#include "soundbank_writer.h"
+#include "wem/byte_reader.h"
+
+namespace
+{
+
+// Little-endian byte sink for assembling synthetic banks.
+class Bytes
+{
+    std::string m_bytes;
+
+public:
+    Bytes& U8(const std::uint8_t value)
+    {
+        m_bytes += static_cast<char>(value);
+        return *this;
+    }
+
+    Bytes& U32(const std::uint32_t value)
+    {
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            U8(static_cast<std::uint8_t>(value >> shift));
+        }
+        return *this;
+    }
+
+    Bytes& Raw(const std::string_view bytes)
+    {
+        m_bytes += bytes;
+        return *this;
+    }
+
+    [[nodiscard]] const std::string& Str() const
+    {
+        return m_bytes;
+    }
+};
+
+[[nodiscard]] Bytes Section(const std::string_view tag, const Bytes& payload)
+{
+    Bytes section;
+    section.Raw(tag).U32(static_cast<std::uint32_t>(payload.Str().size())).Raw(payload.Str());
+    return section;
+}
+
+[[nodiscard]] Bytes HircObject(const std::uint8_t type, const std::uint32_t id, const Bytes& body)
+{
+    Bytes object;
+    object.U8(type).U32(static_cast<std::uint32_t>(body.Str().size() + 4)).U32(id);
+    object.Raw(body.Str());
+    return object;
+}
+
+// Sound structure holding `effects` effects followed by the output bus and parent IDs.
+[[nodiscard]] Bytes SoundStructure(const std::uint8_t effects, const std::uint32_t parent_id)
+{
+    Bytes structure;
+    structure.U8(0).U8(effects);
+    if (effects > 0)
+    {
+        structure.U8(0);
+        for (std::uint8_t i = 0; i < effects; ++i)
+        {
+            structure.U8(i).U32(1000 + i).U8(0).U8(0);
+        }
+    }
+    structure.U32(0).U32(parent_id).Raw(std::string(12, '\0'));
+    return structure;
+}
+
+[[nodiscard]] Bytes Sound(const std::uint32_t stream_type, const std::uint32_t wem_id,
+                          const std::uint8_t effects, const std::uint32_t parent_id)
+{
+    Bytes body;
+    body.U32(0x00040001).U32(stream_type).U32(wem_id).U32(wem_id + 1);
+    if (stream_type == 0)
+    {
+        body.U32(0).U32(0);
+    }
+    body.U8(0).Raw(SoundStructure(effects, parent_id).Str());
+    return body;
+}
+
+// Sound playing the embedded WEM stored at [offset, offset + size) of DATA.
+[[nodiscard]] Bytes EmbeddedSound(const std::uint32_t wem_id, const std::uint32_t offset,
+                                  const std::uint32_t size)
+{
+    Bytes body;
+    body.U32(0x00040001).U32(0).U32(wem_id).U32(wem_id + 1).U32(offset).U32(size);
+    body.U8(0).Raw(SoundStructure(0, 0).Str());
+    return body;
+}
+
+[[nodiscard]] Bytes EventAction(const std::uint8_t type, const std::uint32_t target_id)
+{
+    Bytes body;
+    body.U8(3).U8(type).U32(target_id).U8(0).U8(0).U8(0).Raw(std::string(4, '\0'));
+    return body;
+}
+
+// Event with a u4 action count, or a VLQ count from version 123 on.
+[[nodiscard]] Bytes Event(const std::uint32_t version, const std::span<const std::uint32_t> ids)
+{
+    Bytes body;
+    if (version >= 123)
+    {
+        body.U8(static_cast<std::uint8_t>(ids.size()));
+    }
+    else
+    {
+        body.U32(static_cast<std::uint32_t>(ids.size()));
+    }
+    for (const auto id : ids)
+    {
+        body.U32(id);
+    }
+    return body;
+}
+
+// BKHD, DIDX, DATA, HIRC and STID in the order the Kaitai parser expects.
+[[nodiscard]] std::string SyntheticBank(const std::uint32_t version)
+{
+    Bytes header;
+    header.U32(version).U32(0xBA4C).U32(0).U32(0);
+
+    Bytes didx;
+    didx.U32(5).U32(0).U32(6).U32(6).U32(16).U32(3);
+    Bytes data;
+    data.Raw("RIFF..").Raw(std::string(10, '\0')).Raw("abc");
+
+    const std::uint32_t actions_400[] = {300, 301};
+    const std::uint32_t actions_401[] = {302};
+    Bytes hirc;
+    hirc.U32(7);
+    hirc.Raw(HircObject(2, 100, Sound(0, 5, 0, 200)).Str());
+    hirc.Raw(HircObject(2, 101, Sound(2, 6, 2, 200)).Str());
+    hirc.Raw(HircObject(3, 300, EventAction(4, 100)).Str());
+    hirc.Raw(HircObject(3, 301, EventAction(1, 200)).Str());
+    hirc.Raw(HircObject(3, 302, EventAction(2, 101)).Str());
+    hirc.Raw(HircObject(4, 400, Event(version, actions_400)).Str());
+    hirc.Raw(HircObject(4, 401, Event(version, actions_401)).Str());
+
+    Bytes stid;
+    stid.U32(1).U32(1).U32(400).U8(4).Raw("Play");
+
+    Bytes bank;
+    bank.Raw(Section("BKHD", header).Str());
+    bank.Raw(Section("DIDX", didx).Str());
+    bank.Raw(Section("DATA", data).Str());
+    bank.Raw(Section("HIRC", hirc).Str());
+    bank.Raw(Section("STID", stid).Str());
+    return bank.Str();
+}
+
+template <typename T> [[nodiscard]] T* FindSection(bnk_t& bnk, const std::string_view type)
+{
+    for (const auto* section : *bnk.data())
+    {
+        if (section->type() == type)
+        {
+            return static_cast<T*>(section->section_data());
+        }
+    }
+    return nullptr;
+}
+
+// Parent ID read from Kaitai's raw sound_structure blob the way the old parser did.
+[[nodiscard]] std::uint32_t KaitaiParentId(const std::string& structure)
+{
+    if (structure.size() < 2)
+    {
+        return 0;
+    }
+    const auto effects = static_cast<std::uint8_t>(structure[1]);
+    const std::size_t offset = 6 + (effects > 0 ? 1 + effects * 7 : 0);
+    if (structure.size() < offset + 4)
+    {
+        return 0;
+    }
+    std::uint32_t value = 0;
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+        value |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(structure[offset + i]))
+                 << (8 * i);
+    }
+    return value;
+}
+
+void CheckAgainstKaitai(const std::string& bytes)
+{
+    kaitai::kstream ks(bytes);
+    bnk_t kaitai_bank(&ks);
+    const wwtools::bnk::Soundbank bank(std::as_bytes(std::span(bytes)));
+
+    if (auto* bkhd = FindSection<bnk_t::bkhd_data_t>(kaitai_bank, "BKHD"))
+    {
+        REQUIRE(bank.HasHeader());
+        REQUIRE(bank.Version() == bkhd->version());
+        REQUIRE(bank.Id() == bkhd->id());
+    }
+
+    if (auto* didx = FindSection<bnk_t::didx_data_t>(kaitai_bank, "DIDX"))
+    {
+        const auto entries = bank.DataIndex();
+        REQUIRE(entries.size() == didx->objs()->size());
+        auto* data = FindSection<bnk_t::data_data_t>(kaitai_bank, "DATA");
+        for (std::size_t i = 0; i < entries.size(); ++i)
+        {
+            REQUIRE(entries[i].id == didx->objs()->at(i)->id());
+            REQUIRE(entries[i].size == didx->objs()->at(i)->length());
+            if (data != nullptr)
+            {
+                const auto wem = bank.Wem(entries[i]);
+                // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+                const std::string_view view(reinterpret_cast<const char*>(wem.data()), wem.size());
+                REQUIRE(view == data->data_obj_section()->data()->at(i)->file());
+            }
+        }
+    }
+
+    if (auto* stid = FindSection<bnk_t::stid_data_t>(kaitai_bank, "STID"))
+    {
+        REQUIRE(bank.Names().size() == stid->objs()->size());
+        for (std::size_t i = 0; i < bank.Names().size(); ++i)
+        {
+            REQUIRE(bank.Names()[i].id == stid->objs()->at(i)->id());
+            REQUIRE(bank.Names()[i].name == stid->objs()->at(i)->name());
+        }
+    }
+
+    auto* hirc = FindSection<bnk_t::hirc_data_t>(kaitai_bank, "HIRC");
+    REQUIRE(bank.HasHirc() == (hirc != nullptr));
+    if (hirc == nullptr)
+    {
+        return;
+    }
+
+    const auto objects = bank.Objects();
+    REQUIRE(objects.size() == hirc->objs()->size());
+    for (std::size_t i = 0; i < objects.size(); ++i)
+    {
+        const auto& object = objects[i];
+        const auto* expected = hirc->objs()->at(i);
+        INFO("HIRC object " << i << " (ID " << expected->id() << ")");
+        REQUIRE(static_cast<int>(object.type) == static_cast<int>(expected->type()));
+        REQUIRE(object.id == expected->id());
+        REQUIRE(object.size + 4 == expected->length());
+
+        switch (expected->type())
+        {
+        case bnk_t::OBJECT_TYPE_SOUND_EFFECT_OR_VOICE: {
+            const auto* sfx =
+                dynamic_cast<bnk_t::sound_effect_or_voice_t*>(expected->object_data());
+            const auto* sound = std::get_if<wwtools::bnk::SoundRecord>(&object.data);
+            REQUIRE(sound != nullptr);
+            REQUIRE(sound->stream_type == sfx->included_or_streamed());
+            REQUIRE(sound->wem_id == sfx->audio_file_id());
+            REQUIRE(sound->source_id == sfx->source_id());
+            REQUIRE(sound->parent_id == KaitaiParentId(sfx->sound_structure()));
+            break;
+        }
+        case bnk_t::OBJECT_TYPE_EVENT_ACTION: {
+            const auto* action = dynamic_cast<bnk_t::event_action_t*>(expected->object_data());
+            const auto* record = std::get_if<wwtools::bnk::EventActionRecord>(&object.data);
+            REQUIRE(record != nullptr);
+            REQUIRE(record->scope == static_cast<std::uint8_t>(action->scope()));
+            REQUIRE(static_cast<int>(record->type) == static_cast<int>(action->type()));
+            REQUIRE(record->target_id == action->game_object_id());
+            break;
+        }
+        case bnk_t::OBJECT_TYPE_EVENT: {
+            const auto* event = dynamic_cast<bnk_t::event_t*>(expected->object_data());
+            const auto* record = std::get_if<wwtools::bnk::EventRecord>(&object.data);
+            REQUIRE(record != nullptr);
+            REQUIRE(record->action_count == event->event_actions()->size());
+            for (std::size_t j = 0; j < record->action_count; ++j)
+            {
+                REQUIRE(bank.EventActionId(*record, j) == event->event_actions()->at(j));
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+// Container body: node parameters naming the parent, then container-specific bytes.
+[[nodiscard]] Bytes Node(const std::uint32_t parent_id)
+{
+    Bytes body;
+    body.Raw(SoundStructure(1, parent_id).Str()).Raw(std::string(9, '\x01'));
+    return body;
+}
+
+// Music track with one streamed and one embedded source (stored at [media_offset, media_offset
+// + media_size) of DATA), a playlist item, a clip automation and then the node parameters.
+[[nodiscard]] Bytes MusicTrack(const std::uint32_t wem_id, const std::uint32_t parent_id,
+                               const std::uint32_t media_offset = 0,
+                               const std::uint32_t media_size = 0)
+{
+    Bytes body;
+    body.U32(2);
+    body.U32(0x00040001).U32(2).U32(wem_id).U32(wem_id + 1).U8(0);
+    body.U32(0x00040001).U32(0).U32(wem_id + 2).U32(wem_id + 3);
+    body.U32(media_offset).U32(media_size).U8(0);
+    body.U32(1).U32(1).U32(wem_id + 1).Raw(std::string(32, '\0')).U32(1);
+    body.U32(1).U32(0).U32(2).U32(1).Raw(std::string(12, '\0'));
+    body.Raw(SoundStructure(0, parent_id).Str());
+    return body;
+}
+
+// A bank with `count` HIRC objects cycling through sounds, event actions and events.
+[[nodiscard]] std::string LargeBank(const std::uint32_t count)
+{
+    Bytes hirc;
+    hirc.U32(count);
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        const std::uint32_t action[] = {i - 1};
+        switch (i % 3)
+        {
+        case 0:
+            hirc.Raw(HircObject(2, i, Sound(i % 2, i, 1, i / 2)).Str());
+            break;
+        case 1:
+            hirc.Raw(HircObject(3, i, EventAction(4, i - 1)).Str());
+            break;
+        default:
+            hirc.Raw(HircObject(4, i, Event(88, action)).Str());
+            break;
+        }
+    }
+
+    Bytes header;
+    header.U32(88).U32(1).U32(0).U32(0);
+
+    Bytes bank;
+    bank.Raw(Section("BKHD", header).Str());
+    bank.Raw(Section("HIRC", hirc).Str());
+    return bank.Str();
+}
+
+// Upstream resource recording how many blocks the arena requests.
+class CountingResource final : public std::pmr::memory_resource
+{
+    std::size_t m_allocations = 0;
+    std::size_t m_outstanding = 0;
+
+    void* do_allocate(const std::size_t bytes, const std::size_t alignment) override
+    {
+        ++m_allocations;
+        ++m_outstanding;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, const std::size_t bytes, const std::size_t alignment) override
+    {
+        --m_outstanding;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+public:
+    [[nodiscard]] std::size_t Allocations() const
+    {
+        return m_allocations;
+    }
+
+    [[nodiscard]] std::size_t Outstanding() const
+    {
+        return m_outstanding;
+    }
+};
+
+} // anonymous namespace
+
+// The hand-written parser must agree with the Kaitai-generated one it replaced.  Besides the
+// synthetic banks, every .bnk under $WWTOOLS_BNK_CORPUS is compared when the variable is set
+// (banks the Kaitai parser itself rejects are skipped).
+TEST_CASE("Hand-written BNK parser matches the Kaitai parser", "[soundbank]")
+{
+    SECTION("u4 event action counts")
+    {
+        CheckAgainstKaitai(SyntheticBank(88));
+    }
+
+    SECTION("VLQ event action counts")
+    {
+        CheckAgainstKaitai(SyntheticBank(140));
+    }
+
+    SECTION("Corpus")
+    {
+        const char* corpus = std::getenv("WWTOOLS_BNK_CORPUS");
+        if (corpus == nullptr)
+        {
+            SKIP("WWTOOLS_BNK_CORPUS not set");
+        }
+
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(corpus))
+        {
+            if (!entry.is_regular_file() || entry.path().extension() != ".bnk")
+            {
+                continue;
+            }
+
+            std::ifstream file(entry.path(), std::ios::binary);
+            const std::string bytes{std::istreambuf_iterator<char>(file), {}};
+            try
+            {
+                kaitai::kstream ks(bytes);
+                bnk_t kaitai_bank(&ks);
+            }
+            catch (const std::exception&)
+            {
+                continue;
+            }
+
+            INFO(entry.path().string());
+            CheckAgainstKaitai(bytes);
+        }
+    }
+}
+
+// Malformed input throws instead of reading past the buffer.
+TEST_CASE("Hand-written BNK parser rejects truncated banks", "[soundbank]")
+{
+    const auto bytes = SyntheticBank(88);
+    const auto hirc = bytes.find("HIRC");
+    REQUIRE(hirc != std::string::npos);
+
+    const auto truncated = bytes.substr(0, hirc + 20);
+    REQUIRE_THROWS(wwtools::bnk::Soundbank(std::as_bytes(std::span(truncated))));
+}
+
+// The parse tables come from the Soundbank's arena: a handful of upstream blocks however many
+// objects there are, all returned when the (possibly moved) Soundbank is destroyed.
+TEST_CASE("Soundbank tables are allocated from one arena", "[soundbank]")
+{
+    const auto bytes = LargeBank(30000);
+    CountingResource upstream;
+    {
+        wwtools::bnk::Soundbank parsed(std::as_bytes(std::span(bytes)), &upstream);
+        const wwtools::bnk::Soundbank bank(std::move(parsed));
+        REQUIRE(bank.Objects().size() == 30000);
+        REQUIRE(upstream.Allocations() <= 2);
+    }
+    REQUIRE(upstream.Outstanding() == 0);
+}
+
+// Parse and teardown cost of the generated Kaitai object graph against the arena-backed
+// Soundbank.  Hidden; run with `soundbank_tests "[benchmark]"`.
+TEST_CASE("Soundbank parse and destroy benchmarks", "[.][benchmark]")
+{
+    const auto bytes = LargeBank(300000);
+    const auto data = std::as_bytes(std::span(bytes));
+
+    BENCHMARK("Kaitai parse + destroy")
+    {
+        kaitai::kstream ks(bytes);
+        const bnk_t bank(&ks);
+        return bank.data()->size();
+    };
+
+    BENCHMARK("Soundbank parse + destroy")
+    {
+        const wwtools::bnk::Soundbank bank(data);
+        return bank.Objects().size();
+    };
+
+    BENCHMARK_ADVANCED("Kaitai destroy")(Catch::Benchmark::Chronometer meter)
+    {
+        std::deque<kaitai::kstream> streams;
+        std::vector<Catch::Benchmark::destructable_object<bnk_t>> banks(
+            static_cast<std::size_t>(meter.runs()));
+        for (auto& bank : banks)
+        {
+            bank.construct(&streams.emplace_back(bytes));
+        }
+        meter.measure([&](const int i) { banks[static_cast<std::size_t>(i)].destruct(); });
+    };
+
+    BENCHMARK_ADVANCED("Soundbank destroy")(Catch::Benchmark::Chronometer meter)
+    {
+        std::vector<Catch::Benchmark::destructable_object<wwtools::bnk::Soundbank>> banks(
+            static_cast<std::size_t>(meter.runs()));
+        for (auto& bank : banks)
+        {
+            bank.construct(data);
+        }
+        meter.measure([&](const int i) { banks[static_cast<std::size_t>(i)].destruct(); });
+    };
+}
+
+// Events resolve through containers of any depth and through music segments to track sources;
+// parent links are turned into children lists and cycles in malformed banks are cut.
+TEST_CASE("Soundbank resolves events through the object hierarchy", "[soundbank]")
+{
+    const std::uint32_t actions_500[] = {400};
+    const std::uint32_t actions_501[] = {401};
+
+    Bytes hirc;
+    hirc.U32(12);
+    // actor-mixer > random container > switch container, a sound in each of the last two and
+    // one whose parent lives in another bank
+    hirc.Raw(HircObject(7, 10, Node(0)).Str());
+    hirc.Raw(HircObject(5, 11, Node(10)).Str());
+    hirc.Raw(HircObject(6, 12, Node(11)).Str());
+    hirc.Raw(HircObject(2, 20, Sound(0, 7, 0, 11)).Str());
+    hirc.Raw(HircObject(2, 21, Sound(2, 8, 1, 12)).Str());
+    hirc.Raw(HircObject(2, 22, Sound(0, 6, 0, 77)).Str());
+    // music segment > music track
+    hirc.Raw(HircObject(10, 30, Node(0)).Str());
+    hirc.Raw(HircObject(11, 31, MusicTrack(900, 30)).Str());
+    hirc.Raw(HircObject(3, 400, EventAction(4, 10)).Str());
+    hirc.Raw(HircObject(3, 401, EventAction(4, 30)).Str());
+    hirc.Raw(HircObject(4, 500, Event(88, actions_500)).Str());
+    hirc.Raw(HircObject(4, 501, Event(88, actions_501)).Str());
+
+    Bytes header;
+    header.U32(88).U32(1).U32(0).U32(0);
+    Bytes bytes;
+    bytes.Raw(Section("BKHD", header).Str()).Raw(Section("HIRC", hirc).Str());
+
+    const wwtools::bnk::Soundbank bank(std::as_bytes(std::span(bytes.Str())));
+
+    const auto track = bank.Find(31);
+    REQUIRE(track);
+    const auto* record = std::get_if<wwtools::bnk::MusicTrackRecord>(&bank.Objects()[*track].data);
+    REQUIRE(record != nullptr);
+    REQUIRE(record->parent_id == 30);
+    REQUIRE(bank.TrackSources(*record).size() == 2);
+    REQUIRE(bank.TrackSources(*record)[1].wem_id == 902);
+
+    const auto mixer = bank.Find(10);
+    REQUIRE(mixer);
+    REQUIRE(bank.Children(*mixer).size() == 1);
+    REQUIRE(bank.Parent(*bank.Find(21)) == *bank.Find(12));
+
+    std::vector<wwtools::bnk::ResolvedWem> wems;
+    bank.ResolveWems(*mixer, wems);
+    REQUIRE(wems.size() == 2);
+    REQUIRE(wems[0].wem_id == 8); // via the switch container, which comes first in HIRC
+    REQUIRE(wems[0].depth == 3);
+    REQUIRE(wems[0].streamed);
+    REQUIRE(wems[1].wem_id == 7);
+    REQUIRE(wems[1].depth == 2);
+
+    wems.clear();
+    bank.ResolveWems(*bank.Find(30), wems);
+    REQUIRE(wems.size() == 2);
+    REQUIRE(wems[0].wem_id == 900);
+    REQUIRE(wems[0].streamed);
+    REQUIRE(wems[1].wem_id == 902);
+    REQUIRE_FALSE(wems[1].streamed);
+
+    wems.clear();
+    bank.ResolveTarget(77, wems);
+    REQUIRE(wems.size() == 1);
+    REQUIRE(wems[0].wem_id == 6);
+    REQUIRE(wems[0].depth == 1);
+
+    const auto streamed = bank.StreamedWemIds();
+    REQUIRE(streamed == std::vector<std::uint32_t>{8, 900});
+}
+
+TEST_CASE("Soundbank cuts parent cycles", "[soundbank]")
+{
+    Bytes hirc;
+    hirc.U32(3);
+    hirc.Raw(HircObject(5, 1, Node(2)).Str());
+    hirc.Raw(HircObject(5, 2, Node(1)).Str());
+    hirc.Raw(HircObject(2, 3, Sound(0, 9, 0, 3)).Str());
+
+    Bytes bytes;
+    bytes.Raw(Section("HIRC", hirc).Str());
+    const wwtools::bnk::Soundbank bank(std::as_bytes(std::span(bytes.Str())));
+
+    REQUIRE(bank.Parent(0) == 1);
+    REQUIRE(bank.Parent(1) == wwtools::bnk::g_no_object);
+    REQUIRE(bank.Parent(2) == wwtools::bnk::g_no_object);
+
+    std::vector<wwtools::bnk::ResolvedWem> wems;
+    bank.ResolveWems(1, wems);
+    REQUIRE(wems.empty());
+    bank.ResolveWems(2, wems);
+    REQUIRE(wems.size() == 1);
+}
+
+// Replacing WEMs moves the ones after them to the bank's 16-byte alignment and relocates the
+// DIDX entries and the embedded sources pointing at them; everything else is copied as it was.
+TEST_CASE("Soundbank writer replaces embedded WEMs", "[soundbank]")
+{
+    Bytes header;
+    header.U32(88).U32(1).U32(0).U32(0);
+
+    Bytes didx;
+    didx.U32(12).U32(0).U32(10).U32(20).U32(16).U32(5).U32(30).U32(32).U32(7);
+    Bytes data;
+    data.Raw("aaaaaaaaaa").Raw(std::string(6, '\0')).Raw("bbbbb").Raw(std::string(11, '\0'));
+    data.Raw("ccccccc");
+
+    Bytes hirc;
+    hirc.U32(4);
+    hirc.Raw(HircObject(2, 1, EmbeddedSound(20, 16, 5)).Str());
+    hirc.Raw(HircObject(2, 2, EmbeddedSound(30, 32, 7)).Str());
+    hirc.Raw(HircObject(2, 3, EmbeddedSound(30, 0, 0)).Str()); // not where WEM 30 is
+    hirc.Raw(HircObject(11, 4, MusicTrack(10, 0, 0, 10)).Str());
+
+    Bytes stid;
+    stid.U32(1).U32(1).U32(4).U8(5).Raw("Track");
+
+    Bytes bytes;
+    bytes.Raw(Section("BKHD", header).Str()).Raw(Section("DIDX", didx).Str());
+    bytes.Raw(Section("DATA", data).Str()).Raw(Section("HIRC", hirc).Str());
+    bytes.Raw(Section("STID", stid).Str());
+    const auto input = std::as_bytes(std::span(bytes.Str()));
+
+    const auto write = [](const wwtools::bnk::SoundbankWriter& writer) {
+        wwtools::MemorySink sink;
+        writer.Write(sink);
+        REQUIRE(sink.View().size() == writer.Size());
+        return sink.Take();
+    };
+
+    SECTION("Nothing replaced")
+    {
+        const wwtools::bnk::SoundbankWriter writer(input, {});
+        REQUIRE(writer.Pieces().size() == 1);
+        REQUIRE(write(writer) == bytes.Str());
+    }
+
+    SECTION("WEMs replaced")
+    {
+        const std::string short_wem = "xyz";
+        const std::string long_wem(20, 'y');
+        const wwtools::bnk::SoundbankWriter writer(
+            input, {{12, std::as_bytes(std::span(short_wem))},
+                    {20, std::as_bytes(std::span(long_wem))}});
+        const auto output = write(writer);
+        const auto out = std::as_bytes(std::span(output));
+        const wwtools::bnk::Soundbank bank(out);
+
+        const auto wem = [&](const std::size_t i) {
+            const auto bytes = bank.Wem(bank.DataIndex()[i]);
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            return std::string(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        };
+        REQUIRE(bank.DataIndex().size() == 3);
+        REQUIRE(wem(0) == short_wem);
+        REQUIRE(wem(1) == long_wem);
+        REQUIRE(wem(2) == "ccccccc");
+
+        // DATA payload offset of each WEM, and the media fields of the sources
+        const auto data_offset = bank.DataIndex()[0].offset;
+        REQUIRE(bank.DataIndex()[1].offset - data_offset == 16);
+        REQUIRE(bank.DataIndex()[2].offset - data_offset == 48);
+
+        const auto media = [&](const std::size_t source) {
+            using wwtools::wem::Load;
+            return std::pair(Load<std::uint32_t, std::endian::little>(out, source + 16),
+                             Load<std::uint32_t, std::endian::little>(out, source + 20));
+        };
+        const auto objects = bank.Objects();
+        REQUIRE(media(objects[0].offset) == std::pair(16U, 20U));
+        REQUIRE(media(objects[1].offset) == std::pair(48U, 7U));
+        REQUIRE(media(objects[2].offset) == std::pair(0U, 0U));
+        const auto& track = std::get<wwtools::bnk::MusicTrackRecord>(objects[3].data);
+        REQUIRE(media(bank.TrackSources(track)[1].offset) == std::pair(0U, 3U));
+
+        REQUIRE(bank.Names().size() == 1);
+        REQUIRE(bank.Names()[0].name == "Track");
+    }
+
+    SECTION("WEM not in the bank")
+    {
+        const std::string wem = "x";
+        REQUIRE_THROWS(wwtools::bnk::SoundbankWriter(input, {{99, std::as_bytes(std::span(wem))}}));
+    }
+}
+
+// The typed event report streams as JSON, escaping the names taken from STID.
+TEST_CASE("Event reports are written as JSON", "[soundbank]")
+{
+    const std::uint32_t actions[] = {400, 401};
+
+    Bytes hirc;
+    hirc.U32(5);
+    hirc.Raw(HircObject(7, 10, Node(0)).Str());
+    hirc.Raw(HircObject(2, 20, Sound(2, 7, 0, 10)).Str());
+    hirc.Raw(HircObject(3, 400, EventAction(4, 10)).Str());
+    hirc.Raw(HircObject(3, 401, EventAction(1, 20)).Str());
+    hirc.Raw(HircObject(4, 500, Event(88, actions)).Str());
+
+    const std::string_view name = "Play \"Step\"\t";
+    Bytes stid;
+    stid.U32(1).U32(1).U32(500).U8(static_cast<std::uint8_t>(name.size())).Raw(name);
+
+    Bytes header;
+    header.U32(88).U32(1).U32(0).U32(0);
+    Bytes bytes;
+    bytes.Raw(Section("BKHD", header).Str())
+        .Raw(Section("HIRC", hirc).Str())
+        .Raw(Section("STID", stid).Str());
+
+    const auto report = wwtools::bnk::GetEvents(bytes.Str(), "");
+    REQUIRE(report.event_count == 1);
+    REQUIRE(report.events.size() == 1);
+    REQUIRE(report.events[0].name == name);
+    REQUIRE(report.events[0].wems.size() == 2);
+    REQUIRE(report.events[0].wems[0].child);
+    REQUIRE_FALSE(report.events[0].wems[1].child);
+
+    std::ostringstream json;
+    wwtools::bnk::WriteEventsJson(report, json);
+    REQUIRE(json.str() ==
+            R"({"event_count":1,"events":[{"id":500,"name":"Play \"Step\"\t","wems":[)"
+            R"({"action":"play","action_type":4,"wem_id":7,"child":true},)"
+            R"({"action":"stop","action_type":1,"wem_id":7,"child":false}]}]})"
+            "\n");
+
+    std::ostringstream text;
+    wwtools::bnk::WriteEvents(report, text);
+    REQUIRE(text.str() == wwtools::bnk::GetEventIdInfo(bytes.Str(), ""));
+    REQUIRE(text.str().starts_with("Found 1 event(s)\n1 of them point to files in this BNK\n"));
+
+    std::ostringstream info;
+    wwtools::bnk::WriteBankInfoJson(wwtools::bnk::GetBankInfo(bytes.Str()), info);
+    REQUIRE(info.str() == "{\"version\":88,\"id\":1,\"wem_ids\":[]}\n");
+}
+
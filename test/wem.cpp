@@ -1,15 +1,43 @@
 #include <catch2/catch_test_macros.hpp>
+#include <zlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
 #include <fstream>
+#include <initializer_list>
+#include <limits>
+#include <optional>
+#include <span>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "bundle.h"
+#include "manifest.h"
+#include "media_index.h"
+#include "pack.h"
+#include "pcm/convert.h"
+#include "pipeline.h"
+#include "revorb/revorb.h"
+#include "w3sc.h"
 #include "wwtools/wwtools.h"
 
 namespace
 {
 
-// Reads a WEM file from disk and converts it to OGG via the public API.
-[[nodiscard]] std::string Convert(const std::string& path)
+// Reads a whole file from disk into a string.
+[[nodiscard]] std::string ReadFile(const std::string& path)
 {
     std::ifstream filein(path, std::ios::binary);
 
@@ -21,7 +49,305 @@ namespace
 
     indata.assign(std::istreambuf_iterator<char>(filein), std::istreambuf_iterator<char>());
 
-    return wwtools::Wem2Ogg(indata);
+    return indata;
+}
+
+// Writes a string to a file, replacing it.
+void WriteFile(const std::filesystem::path& path, const std::string_view data)
+{
+    std::ofstream fileout(path, std::ios::binary | std::ios::trunc);
+    fileout.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+// A fresh directory under the system temporary directory, removed with its contents when the test
+// ends, whether or not it passed.
+class TempDir
+{
+    std::filesystem::path m_path;
+
+public:
+    explicit TempDir(const std::string_view name)
+        : m_path(std::filesystem::temp_directory_path() / name)
+    {
+        std::filesystem::remove_all(m_path);
+        std::filesystem::create_directories(m_path);
+    }
+
+    ~TempDir()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(m_path, ec);
+    }
+
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+
+    [[nodiscard]] const std::filesystem::path& Path() const
+    {
+        return m_path;
+    }
+};
+
+// Appends little-endian u32 values to a byte string.
+void AppendU32(std::string& out, const std::initializer_list<std::uint32_t> values)
+{
+    for (const auto value : values)
+    {
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            out += static_cast<char>((value >> shift) & 0xFF);
+        }
+    }
+}
+
+// Appends `value` as `width` little-endian bytes.
+void AppendLe(std::string& out, const std::uint64_t value, const std::size_t width)
+{
+    for (std::size_t i = 0; i < width; ++i)
+    {
+        out += static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+// Witcher 3 sound cache holding `files` as (name, payload) pairs: the header, the names, the
+// payloads and then the file_info table, whose offset and size fields are u4 in version 1 and u8
+// afterwards.
+[[nodiscard]] std::string SoundCacheFile(
+    const std::uint32_t version, const std::vector<std::pair<std::string, std::string>>& files)
+{
+    const std::size_t width = version == 1 ? 4 : 8;
+    const std::size_t names_offset = 16 + 4 * width;
+
+    std::string names;
+    for (const auto& [name, payload] : files)
+    {
+        names += name + '\0';
+    }
+
+    const auto payloads_offset = names_offset + names.size();
+    std::string payloads;
+    std::string info;
+    std::size_t name_offset = 0;
+    for (const auto& [name, payload] : files)
+    {
+        AppendLe(info, name_offset, width);
+        AppendLe(info, payloads_offset + payloads.size(), width);
+        AppendLe(info, payload.size(), width);
+        name_offset += name.size() + 1;
+        payloads += payload;
+    }
+
+    std::string out = "CS3W";
+    AppendLe(out, version, 4);
+    AppendLe(out, 0, 8);
+    AppendLe(out, payloads_offset + payloads.size(), width);
+    AppendLe(out, files.size(), width);
+    AppendLe(out, names_offset, width);
+    AppendLe(out, names.size(), width);
+    return out + names + payloads + info;
+}
+
+// One file of a REDengine bundle: its name, stored bytes, decompressed size and compression type.
+struct BundleFile
+{
+    std::string name;
+    std::string stored;
+    std::size_t size;
+    std::uint32_t compression;
+};
+
+// REDengine bundle holding `files`: the 32-byte header, one 320-byte embedded_file record per
+// file, then the stored payloads.
+[[nodiscard]] std::string BundleFileData(const std::vector<BundleFile>& files)
+{
+    const std::size_t data_offset = 32 + files.size() * 0x140;
+
+    std::string records;
+    std::string payloads;
+    for (const auto& file : files)
+    {
+        auto record = file.name;
+        record.resize(0x100, '\0');
+        record.append(16 + 4, '\0'); // hash and zero
+        AppendLe(record, file.size, 4);
+        AppendLe(record, file.stored.size(), 4);
+        AppendLe(record, data_offset + payloads.size(), 4);
+        record.append(8 + 16 + 4, '\0'); // timestamp, zeros and dummy
+        AppendLe(record, file.compression, 4);
+        records += record;
+        payloads += file.stored;
+    }
+
+    std::string out = "POTATO70";
+    AppendLe(out, data_offset + payloads.size(), 4);
+    AppendLe(out, 0, 4);
+    AppendLe(out, data_offset, 4);
+    out.append(12, '\0');
+    return out + records + payloads;
+}
+
+// Version 88 bank with an actor-mixer (10) holding a streamed sound (20) of WEM `wem_id`, and an
+// event (500, named "Play_Step") whose play action (400) targets the actor-mixer.
+[[nodiscard]] std::string XrefBank(const std::uint32_t wem_id)
+{
+    const auto section = [](const std::string_view tag, const std::string& payload) {
+        std::string out{tag};
+        AppendU32(out, {static_cast<std::uint32_t>(payload.size())});
+        return out + payload;
+    };
+    const auto object = [](const char type, const std::uint32_t id, const std::string& body) {
+        std::string out(1, type);
+        AppendU32(out, {static_cast<std::uint32_t>(body.size() + 4), id});
+        return out + body;
+    };
+    // Override flag and no effects, then the output bus and parent IDs
+    const auto node = [](const std::uint32_t parent_id) {
+        std::string out(2, '\0');
+        AppendU32(out, {0, parent_id});
+        return out;
+    };
+
+    std::string header;
+    AppendU32(header, {88, 1, 0, 0});
+
+    std::string sound;
+    AppendU32(sound, {0x00040001, 2, wem_id, wem_id});
+    sound += '\0';
+    sound += node(10);
+
+    std::string action = "\x03\x04";
+    AppendU32(action, {10});
+
+    std::string event;
+    AppendU32(event, {1, 400});
+
+    std::string hirc;
+    AppendU32(hirc, {4});
+    hirc += object(7, 10, node(0)) + object(2, 20, sound) + object(3, 400, action) +
+            object(4, 500, event);
+
+    std::string stid;
+    AppendU32(stid, {1, 1, 500});
+    stid += "\x09Play_Step";
+
+    return section("BKHD", header) + section("HIRC", hirc) + section("STID", stid);
+}
+
+// Reads a WEM file from disk and converts it to OGG via the public API.
+[[nodiscard]] std::string Convert(const std::string& path)
+{
+    return wwtools::Wem2Ogg(ReadFile(path));
+}
+
+// Rewrites a RIFF WEM whose vorb fields live in a 0x42 fmt chunk (as in test1.wem) as the RIFX
+// file a big-endian platform would ship, by byte-swapping every header the converter reads.
+[[nodiscard]] std::string ToRifx(std::string data)
+{
+    const auto swap = [&](const std::size_t offset, const std::size_t size) {
+        std::reverse(data.begin() + static_cast<std::ptrdiff_t>(offset),
+                     data.begin() + static_cast<std::ptrdiff_t>(offset + size));
+    };
+    const auto load = [&](const std::size_t offset, const std::size_t size) {
+        std::uint32_t value = 0;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            value |= static_cast<std::uint32_t>(static_cast<unsigned char>(data[offset + i]))
+                     << (8 * i);
+        }
+        return value;
+    };
+
+    data.replace(0, 4, "RIFX");
+    swap(4, 4);
+
+    std::size_t fmt = 0;
+    std::size_t data_chunk = 0;
+    for (std::size_t offset = 12; offset < data.size();)
+    {
+        const auto size = load(offset + 4, 4);
+        const auto type = std::string_view(data).substr(offset, 4);
+        if (type == "fmt ")
+        {
+            fmt = offset + 8;
+        }
+        else if (type == "data")
+        {
+            data_chunk = offset + 8;
+        }
+        else if (type == "cue ")
+        {
+            swap(offset + 8, 4);
+        }
+        swap(offset + 4, 4);
+        offset += 8 + size;
+    }
+
+    for (const auto& [field, size] : {std::pair{0, 2}, {2, 2}, {4, 4}, {8, 4}, {12, 2}, {14, 2},
+                                      {16, 2}, {18, 2}, {20, 4}})
+    {
+        swap(fmt + field, size);
+    }
+
+    const auto vorb = fmt + 0x18;
+    const auto setup = data_chunk + load(vorb + 0x10, 4);
+    const auto first_audio = data_chunk + load(vorb + 0x14, 4);
+    for (const auto field : {0x0, 0x4, 0x10, 0x14, 0x24})
+    {
+        swap(vorb + field, 4);
+    }
+
+    // 2-byte packet headers: the setup packet, then every audio packet up to the end
+    swap(setup, 2);
+    for (auto offset = first_audio; offset < data.size();)
+    {
+        const auto size = load(offset, 2);
+        swap(offset, 2);
+        offset += 2 + size;
+    }
+
+    return data;
+}
+
+// OGG page checksum: CRC-32, polynomial 0x04C11DB7, MSB first, no reflection or final xor.
+[[nodiscard]] std::uint32_t OggChecksum(const std::string_view page)
+{
+    std::uint32_t crc = 0;
+    for (const unsigned char byte : page)
+    {
+        crc ^= static_cast<std::uint32_t>(byte) << 24;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc & 0x80000000U) != 0 ? (crc << 1) ^ 0x04C11DB7U : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// Sets the granule position of the last page to 0, as a broken converter might leave it, and
+// recomputes that page's checksum.
+[[nodiscard]] std::string BreakLastGranule(std::string ogg)
+{
+    std::size_t page = 0;
+    std::size_t page_size = 0;
+    for (std::size_t offset = 0; offset < ogg.size(); offset += page_size)
+    {
+        const auto segments = static_cast<unsigned char>(ogg[offset + 26]);
+        page_size = 27 + segments;
+        for (std::size_t i = 0; i < segments; ++i)
+        {
+            page_size += static_cast<unsigned char>(ogg[offset + 27 + i]);
+        }
+        page = offset;
+    }
+
+    std::fill_n(ogg.begin() + static_cast<std::ptrdiff_t>(page + 6), 8, '\0');
+    std::fill_n(ogg.begin() + static_cast<std::ptrdiff_t>(page + 22), 4, '\0');
+    const auto crc = OggChecksum(std::string_view(ogg).substr(page));
+    for (int i = 0; i < 4; ++i)
+    {
+        ogg[page + 22 + i] = static_cast<char>((crc >> (8 * i)) & 0xFF);
+    }
+    return ogg;
 }
 
 } // anonymous namespace
@@ -37,3 +363,695 @@ TEST_CASE("Compare WEM converted with WwiseAudioTools to those converted with st
 
     REQUIRE(Convert("testdata/wem/test1.wem") == ogg_in_s.str());
 }
+
+// Console WEMs are RIFX: every header field and packet header is big-endian, but the Vorbis
+// payload is the same, so the conversion must match the little-endian original.
+TEST_CASE("Convert a big-endian RIFX WEM", "[wwise-audio-tools]")
+{
+    const auto indata = ReadFile("testdata/wem/test1.wem");
+    const auto rifx = ToRifx(indata);
+    REQUIRE(rifx.starts_with("RIFX"));
+
+    CHECK(wwtools::Wem2Ogg(rifx) == wwtools::Wem2Ogg(indata));
+}
+
+// The file writer buffers the page-sized writes and preallocates the file, but the bytes must be
+// those Wem2Ogg returns.
+TEST_CASE("Convert a WEM straight to a file", "[wwise-audio-tools]")
+{
+    const auto indata = ReadFile("testdata/wem/test1.wem");
+    const auto outpath = std::filesystem::temp_directory_path() / "wwtools_file_sink_test.ogg";
+
+    wwtools::Wem2OggFile(indata, outpath);
+    CHECK(ReadFile(outpath.string()) == wwtools::Wem2Ogg(indata));
+    std::filesystem::remove(outpath);
+
+    CHECK_THROWS(wwtools::Wem2OggFile(indata, outpath.parent_path() / "missing" / "out.ogg"));
+}
+
+// A prefetch stub is the start of a WEM whose RIFF header still gives the size of the whole file.
+// It converts to a shorter stream that must pass verification on its own and end on the sample
+// count reported for it.
+TEST_CASE("Convert the prefetch stub of a streamed WEM", "[wwise-audio-tools]")
+{
+    const auto indata = ReadFile("testdata/wem/test1.wem");
+    const auto whole = wwtools::Wem2OggPrefix(indata);
+    CHECK(whole.complete);
+    CHECK(whole.samples == 1459392);
+    CHECK(whole.ogg == wwtools::Wem2Ogg(indata));
+
+    const auto stub = std::string_view(indata).substr(0, indata.size() / 4);
+    CHECK_THROWS(wwtools::Wem2Ogg(stub));
+
+    const auto preview = wwtools::Wem2OggPrefix(stub);
+    CHECK_FALSE(preview.complete);
+    CHECK(preview.samples > 0);
+    CHECK(preview.samples < whole.samples);
+
+    const auto verification = wwtools::VerifyOgg(preview.ogg);
+    CHECK(verification.valid);
+    CHECK(verification.granule == static_cast<std::int64_t>(preview.samples));
+
+    CHECK_THROWS(wwtools::Wem2OggPrefix(stub.substr(0, 64)));
+}
+
+// test1.ogg came out of revorb, so it needs no fixing; once a granule is broken it does, and the
+// fixed stream must then pass the check itself.
+TEST_CASE("Fix the granule positions of an OGG", "[wwise-audio-tools]")
+{
+    const auto ogg = ReadFile("testdata/wem/test1.ogg");
+    CHECK_FALSE(wwtools::FixOggGranules(ogg).has_value());
+
+    const auto broken = BreakLastGranule(ogg);
+    REQUIRE(broken.size() == ogg.size());
+    const auto fixed = wwtools::FixOggGranules(broken);
+    REQUIRE(fixed.has_value());
+    CHECK_FALSE(wwtools::FixOggGranules(*fixed).has_value());
+
+    CHECK_THROWS(wwtools::FixOggGranules(ogg.substr(0, ogg.size() / 2)));
+}
+
+// Revorb reads pages in place from a buffer and writes to any sink.  Its output depends only on
+// the packets, so test1.ogg comes back as it is and a broken granule is repaired to match it.
+TEST_CASE("Revorb an in-memory OGG into a memory sink", "[wwise-audio-tools]")
+{
+    const auto ogg = ReadFile("testdata/wem/test1.ogg");
+
+    wwtools::MemorySink same;
+    REQUIRE(revorb::Revorb(std::as_bytes(std::span(ogg)), same));
+    CHECK(same.View() == ogg);
+
+    const auto broken = BreakLastGranule(ogg);
+    wwtools::MemorySink fixed;
+    REQUIRE(revorb::Revorb(std::as_bytes(std::span(broken)), fixed));
+    CHECK(fixed.View() == ogg);
+    CHECK(fixed.Take() == ogg);
+    CHECK(fixed.View().empty());
+
+    auto corrupt = ogg;
+    corrupt[corrupt.size() / 2] ^= 0x01;
+    wwtools::MemorySink rejected;
+    CHECK_FALSE(revorb::Revorb(std::as_bytes(std::span(corrupt)), rejected));
+}
+
+TEST_CASE("Verify OGG output without decoding it", "[wwise-audio-tools]")
+{
+    const auto ogg = ReadFile("testdata/wem/test1.ogg");
+    auto corrupt = ogg;
+    corrupt[corrupt.size() / 2] ^= 0x01;
+    const auto truncated = ogg.substr(0, ogg.size() - 100);
+
+    const std::vector<std::string_view> oggs{ogg, corrupt, truncated};
+    const auto results = wwtools::VerifyOggs(oggs);
+    REQUIRE(results.size() == 3);
+
+    CHECK(results[0].valid);
+    CHECK(results[0].error.empty());
+    CHECK(results[0].pages == 257);
+    CHECK(results[0].granule == 1459392);
+
+    CHECK_FALSE(results[1].valid);
+    CHECK(results[1].error.find("checksum") != std::string::npos);
+    CHECK_FALSE(results[2].valid);
+    CHECK(results[2].pages == 256);
+}
+
+// The int16 and float decode paths share synthesis, so the int16 output must be exactly the
+// float output scaled, rounded and clipped (this also checks the SIMD kernels against the
+// scalar definition).
+TEST_CASE("Decode WEM directly to PCM", "[wwise-audio-tools]")
+{
+    const auto indata = ReadFile("testdata/wem/test1.wem");
+
+    const auto pcm16 = wwtools::Wem2Pcm(indata);
+    const auto pcmf = wwtools::Wem2PcmFloat(indata);
+
+    REQUIRE(pcm16.channels > 0);
+    REQUIRE(pcm16.sample_rate > 0);
+    REQUIRE_FALSE(pcm16.samples.empty());
+    REQUIRE(pcm16.samples.size() % pcm16.channels == 0);
+    REQUIRE(pcm16.channels == pcmf.channels);
+    REQUIRE(pcm16.sample_rate == pcmf.sample_rate);
+    REQUIRE(pcm16.samples.size() == pcmf.samples.size());
+
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < pcmf.samples.size(); ++i)
+    {
+        const float scaled = std::clamp(pcmf.samples[i] * 32768.0F, -32768.0F, 32767.0F);
+        if (pcm16.samples[i] != static_cast<std::int16_t>(std::lrint(scaled)))
+        {
+            ++mismatches;
+        }
+    }
+    REQUIRE(mismatches == 0);
+}
+
+// Each bucket's envelope must lie within the decoded signal's range, and RMS can never exceed the
+// bucket's peak magnitude.
+TEST_CASE("Compute a WEM waveform envelope", "[wwise-audio-tools]")
+{
+    const auto indata = ReadFile("testdata/wem/test1.wem");
+    constexpr std::size_t resolution = 64;
+
+    const auto pcm = wwtools::Wem2PcmFloat(indata);
+    const auto waveform = wwtools::WemWaveform(indata, resolution);
+
+    REQUIRE(waveform.channels == pcm.channels);
+    REQUIRE(waveform.sample_rate == pcm.sample_rate);
+    REQUIRE(waveform.frames == pcm.samples.size() / pcm.channels);
+    REQUIRE(waveform.resolution == resolution);
+    REQUIRE(waveform.points.size() == resolution * waveform.channels);
+
+    const auto [lowest, highest] = std::ranges::minmax(pcm.samples);
+    float envelope_min = waveform.points.front().min;
+    float envelope_max = waveform.points.front().max;
+    for (const auto& point : waveform.points)
+    {
+        REQUIRE(point.min <= point.max);
+        REQUIRE(point.rms <= std::max(-point.min, point.max) + 1e-6F);
+        envelope_min = std::min(envelope_min, point.min);
+        envelope_max = std::max(envelope_max, point.max);
+    }
+    REQUIRE(envelope_min == lowest);
+    REQUIRE(envelope_max == highest);
+
+    REQUIRE_THROWS(wwtools::WemWaveform(indata, 0));
+}
+
+// The probe must agree with a full decode, and a prefix holding only the headers (as in a BNK
+// prefetch stub) must yield the same stream metadata.
+TEST_CASE("Probe WEM metadata from the RIFF headers", "[wwise-audio-tools]")
+{
+    const auto indata = ReadFile("testdata/wem/test1.wem");
+    const auto bytes = std::as_bytes(std::span(indata));
+
+    const auto meta = wwtools::ProbeWem(bytes);
+    const auto pcm = wwtools::Wem2PcmFloat(indata);
+
+    REQUIRE(meta.codec == 0xFFFF);
+    REQUIRE(meta.complete);
+    REQUIRE(meta.riff_size == indata.size());
+    REQUIRE(meta.channels == pcm.channels);
+    REQUIRE(meta.sample_rate == pcm.sample_rate);
+    REQUIRE(meta.sample_count == pcm.samples.size() / pcm.channels);
+    REQUIRE(meta.data_offset + meta.data_size <= indata.size());
+
+    const auto prefix = wwtools::ProbeWem(bytes.first(256));
+    REQUIRE_FALSE(prefix.complete);
+    REQUIRE(prefix.channels == meta.channels);
+    REQUIRE(prefix.sample_rate == meta.sample_rate);
+    REQUIRE(prefix.sample_count == meta.sample_count);
+
+    REQUIRE_THROWS(wwtools::ProbeWem(bytes.subspan(4)));
+}
+
+// A directory holding one loose WEM indexes to a single row matching the probe; a file that is
+// not a WEM is reported rather than indexed.
+TEST_CASE("Index a directory of WEMs", "[wwise-audio-tools]")
+{
+    const TempDir temp("wwtools_index_test");
+    const auto& root = temp.Path();
+    std::filesystem::create_directories(root / "sub" / "deeper");
+    std::filesystem::copy_file("testdata/wem/test1.wem", root / "sub" / "1234.wem");
+    WriteFile(root / "sub" / "deeper" / "broken.wem", "RIFF");
+
+    const auto index = wwtools::IndexDirectory(root);
+    const auto indata = ReadFile("testdata/wem/test1.wem");
+    const auto meta = wwtools::ProbeWem(std::as_bytes(std::span(indata)));
+
+    REQUIRE(index.Rows() == 1);
+    REQUIRE(index.sources == std::vector<std::string>{"sub/1234.wem"});
+    REQUIRE(index.id[0] == 1234);
+    REQUIRE(index.channels[0] == meta.channels);
+    REQUIRE(index.sample_rate[0] == meta.sample_rate);
+    REQUIRE(index.sample_count[0] == meta.sample_count);
+    REQUIRE(index.streamed[0] == 0);
+    REQUIRE(index.failed == std::vector<std::string>{"sub/deeper/broken.wem"});
+    REQUIRE(index.errors.size() == 1);
+
+    std::ostringstream csv;
+    wwtools::WriteIndexCsv(index, csv);
+    REQUIRE(csv.str().starts_with("id,source,"));
+}
+
+// Only "<id>.wem" names count as streamed media.  An ID found twice resolves to the earlier root,
+// and within a root a top-level file wins over one in a subdirectory.
+TEST_CASE("Resolve streamed WEMs through media roots", "[wwise-audio-tools]")
+{
+    using wwtools::media::StreamedWemId;
+    CHECK(StreamedWemId("sfx/1234.wem") == 1234U);
+    CHECK(StreamedWemId("1234.WEM") == 1234U);
+    CHECK_FALSE(StreamedWemId("1234.ogg").has_value());
+    CHECK_FALSE(StreamedWemId("music.wem").has_value());
+    CHECK_FALSE(StreamedWemId("12ab.wem").has_value());
+    CHECK_FALSE(StreamedWemId(".wem").has_value());
+    CHECK_FALSE(StreamedWemId("4294967296.wem").has_value());
+
+    const TempDir temp("wwtools_media_test");
+    const auto& root = temp.Path();
+    std::filesystem::create_directories(root / "first" / "sub");
+    std::filesystem::create_directories(root / "second" / "deeper" / "still");
+    WriteFile(root / "first" / "1.wem", "");
+    WriteFile(root / "first" / "sub" / "1.wem", "");
+    WriteFile(root / "first" / "sub" / "2.WEM", "");
+    WriteFile(root / "first" / "notes.txt", "");
+    WriteFile(root / "second" / "2.wem", "");
+    WriteFile(root / "second" / "deeper" / "still" / "3.wem", "");
+
+    const std::vector<std::filesystem::path> roots{root / "first", root / "second"};
+    const wwtools::media::MediaIndex media(roots, 2);
+    REQUIRE(media.Size() == 3);
+    REQUIRE(media.Find(1) != nullptr);
+    CHECK(*media.Find(1) == root / "first" / "1.wem");
+    REQUIRE(media.Find(2) != nullptr);
+    CHECK(*media.Find(2) == root / "first" / "sub" / "2.WEM");
+    REQUIRE(media.Find(3) != nullptr);
+    CHECK(*media.Find(3) == root / "second" / "deeper" / "still" / "3.wem");
+    CHECK(media.Find(4) == nullptr);
+
+    const std::vector<std::filesystem::path> missing{root / "missing"};
+    CHECK_THROWS_AS(wwtools::media::MediaIndex(missing), std::filesystem::filesystem_error);
+}
+
+// The reverse index follows events through containers, survives a round trip through its binary
+// format and only re-reads banks that changed.
+TEST_CASE("Cross-reference WEMs with the events of a directory of banks", "[wwise-audio-tools]")
+{
+    const TempDir temp("wwtools_xref_test");
+    const auto& root = temp.Path();
+    std::filesystem::create_directories(root / "sub");
+    WriteFile(root / "a.bnk", XrefBank(7));
+    WriteFile(root / "sub" / "b.bnk", XrefBank(8));
+
+    wwtools::WemXref xref;
+    REQUIRE(wwtools::UpdateXref(xref, root) == 2);
+    REQUIRE(xref.banks.size() == 2);
+
+    const auto hits = xref.Find(7);
+    REQUIRE(hits.size() == 1);
+    REQUIRE(xref.banks[hits[0].bank].path == "a.bnk");
+    const auto& reference = xref.Reference(hits[0]);
+    REQUIRE(reference.event_id == 500);
+    REQUIRE(reference.event_name == "Play_Step");
+    REQUIRE(reference.action_type == 4);
+    REQUIRE(reference.path == std::vector<std::uint32_t>{10, 20});
+    REQUIRE(xref.Find(9).empty());
+
+    std::stringstream stored;
+    wwtools::WriteXref(xref, stored);
+    auto reloaded = wwtools::ReadXref(stored);
+    REQUIRE(reloaded.hits.size() == 2);
+    REQUIRE(wwtools::UpdateXref(reloaded, root) == 0);
+
+    // Same size, so only the (explicitly moved on) mtime tells the rewrite apart
+    std::filesystem::remove(root / "a.bnk");
+    const auto mtime = std::filesystem::last_write_time(root / "sub" / "b.bnk");
+    WriteFile(root / "sub" / "b.bnk", XrefBank(9));
+    std::filesystem::last_write_time(root / "sub" / "b.bnk", mtime + std::chrono::seconds(1));
+    REQUIRE(wwtools::UpdateXref(reloaded, root) == 2);
+    REQUIRE(reloaded.banks.size() == 1);
+    REQUIRE(reloaded.Find(8).empty());
+    REQUIRE(reloaded.Find(9).size() == 1);
+
+    std::ostringstream csv;
+    const std::vector<std::uint32_t> wanted{9};
+    wwtools::WriteXrefCsv(reloaded, csv, wanted);
+    REQUIRE(csv.str() ==
+            "wem,bank,event,event_name,action,path\n9,sub/b.bnk,500,Play_Step,play,10/20\n");
+
+    // A bank that fails to parse is reported and read again on every update until it is fixed
+    std::string broken = "HIRC";
+    AppendU32(broken, {64});
+    WriteFile(root / "c.bnk", broken);
+    REQUIRE(wwtools::UpdateXref(reloaded, root) == 1);
+    REQUIRE(reloaded.banks.size() == 1);
+    REQUIRE(reloaded.failed == std::vector<std::string>{"c.bnk"});
+    REQUIRE(reloaded.errors.size() == 1);
+    REQUIRE(wwtools::UpdateXref(reloaded, root) == 1);
+    REQUIRE(reloaded.failed.size() == 1);
+
+    WriteFile(root / "c.bnk", XrefBank(7));
+    REQUIRE(wwtools::UpdateXref(reloaded, root) == 1);
+    REQUIRE(reloaded.failed.empty());
+    REQUIRE(reloaded.banks.size() == 2);
+    REQUIRE(reloaded.Find(7).size() == 1);
+}
+
+// Unchanged size and mtime skip without hashing, a touched file is re-hashed, and a record made in
+// another mode or by another tool version or codebook library never matches.  Records survive a
+// save and reload.
+TEST_CASE("Track converted inputs in a manifest", "[wwise-audio-tools]")
+{
+    const TempDir temp("wwtools_manifest_test");
+    const auto& root = temp.Path();
+    const auto path = root / ".wwtools-manifest";
+
+    const std::string data = "RIFF wem bytes";
+    const std::string edited = "RIFF WEM BYTES";
+    const auto input = [](const std::string& bytes, const std::int64_t mtime) {
+        return wwtools::manifest::Input{.key = "sfx/1234.wem",
+                                        .size = bytes.size(),
+                                        .mtime = mtime,
+                                        .data = std::as_bytes(std::span(bytes))};
+    };
+
+    {
+        wwtools::manifest::Manifest manifest(path);
+        REQUIRE(manifest.Size() == 0);
+        REQUIRE_FALSE(manifest.Unchanged(input(data, 100), "sfx/1234.ogg", "convert"));
+        manifest.Update(input(data, 100), "sfx/1234.ogg", "convert");
+        REQUIRE(manifest.Unchanged(input(data, 100), "sfx/1234.ogg", "convert"));
+        REQUIRE_FALSE(manifest.Unchanged(input(data, 100), "other/1234.ogg", "convert"));
+        REQUIRE_FALSE(manifest.Unchanged(input(data, 100), "sfx/1234.ogg", "prefetch"));
+
+        // Same size and mtime are trusted, so different bytes are not even hashed
+        REQUIRE(manifest.Unchanged(input(edited, 100), "sfx/1234.ogg", "convert"));
+
+        // A new mtime falls back to the hash: the same bytes still match, new ones do not
+        REQUIRE(manifest.Unchanged(input(data, 200), "sfx/1234.ogg", "convert"));
+        REQUIRE_FALSE(manifest.Unchanged(input(edited, 300), "sfx/1234.ogg", "convert"));
+        manifest.Save();
+    }
+
+    // The re-hash above refreshed the stored mtime
+    {
+        wwtools::manifest::Manifest manifest(path);
+        REQUIRE(manifest.Size() == 1);
+        REQUIRE(manifest.Unchanged(input(edited, 200), "sfx/1234.ogg", "convert"));
+    }
+
+    // Fields are tab-separated: key, hash, size, mtime, tool version, codebooks hash, mode, output
+    const auto rewrite_field = [&](const std::size_t field, const std::string_view value) {
+        auto text = ReadFile(path.string());
+        auto start = text.find('\n') + 1;
+        for (std::size_t i = 0; i < field; ++i)
+        {
+            start = text.find('\t', start) + 1;
+        }
+        text.replace(start, text.find_first_of("\t\n", start) - start, value);
+        WriteFile(path, text);
+    };
+    const auto saved = ReadFile(path.string());
+    const auto unchanged = [&] {
+        return wwtools::manifest::Manifest(path).Unchanged(input(data, 200), "sfx/1234.ogg",
+                                                           "convert");
+    };
+
+    rewrite_field(4, "0.0.0");
+    REQUIRE_FALSE(unchanged());
+
+    WriteFile(path, saved);
+    rewrite_field(5, "0");
+    REQUIRE_FALSE(unchanged());
+
+    WriteFile(path, saved);
+    rewrite_field(6, "prefetch");
+    REQUIRE_FALSE(unchanged());
+
+    WriteFile(path, saved);
+    REQUIRE(unchanged());
+}
+
+// Both field widths index the same entries with zero-copy views of their payloads, and a table
+// pointing outside the file is rejected instead of read.
+TEST_CASE("Read Witcher 3 sound caches", "[wwise-audio-tools]")
+{
+    const TempDir temp("wwtools_cache_test");
+    const auto& root = temp.Path();
+    const auto path = root / "soundspc.cache";
+
+    const std::vector<std::pair<std::string, std::string>> files{
+        {"music/1.wem", "RIFF one"}, {"sfx/2.bnk", "BKHD two"}, {"empty.wem", ""}};
+    for (const std::uint32_t version : {1U, 2U})
+    {
+        WriteFile(path, SoundCacheFile(version, files));
+        const wwtools::w3sc::SoundCache cache(path);
+        REQUIRE(cache.Version() == version);
+        REQUIRE(cache.Entries().size() == files.size());
+        for (std::size_t i = 0; i < files.size(); ++i)
+        {
+            const auto& entry = cache.Entries()[i];
+            REQUIRE(entry.name == files[i].first);
+            REQUIRE(entry.size == files[i].second.size());
+            REQUIRE(cache.View(entry) == files[i].second);
+        }
+    }
+
+    // The file_info table closes the file: (name_offset, offset, size) per entry
+    const auto corrupt = [&](const std::size_t field) {
+        auto data = SoundCacheFile(2, files);
+        const auto info_offset = data.size() - files.size() * 3 * 8;
+        data.replace(info_offset + field * 8, 8, 8, '\x7F');
+        WriteFile(path, data);
+    };
+    corrupt(0);
+    REQUIRE_THROWS_AS(wwtools::w3sc::SoundCache(path), std::runtime_error);
+    corrupt(1);
+    REQUIRE_THROWS_AS(wwtools::w3sc::SoundCache(path), std::runtime_error);
+
+    auto truncated = SoundCacheFile(1, files);
+    truncated.resize(truncated.size() - 1);
+    WriteFile(path, truncated);
+    REQUIRE_THROWS_AS(wwtools::w3sc::SoundCache(path), std::runtime_error);
+}
+
+// A stored entry loads as a view of the file and a zlib entry through the scratch buffer; an entry
+// pointing outside the file is rejected instead of read.
+TEST_CASE("Read REDengine bundles", "[wwise-audio-tools]")
+{
+    const TempDir temp("wwtools_bundle_test");
+    const auto& root = temp.Path();
+    const auto path = root / "blob0.bundle";
+
+    const std::string stored = "RIFF stored wem";
+    const std::string text(1000, 'w');
+    std::string deflated(compressBound(static_cast<uLong>(text.size())), '\0');
+    auto deflated_size = static_cast<uLongf>(deflated.size());
+    // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+    REQUIRE(compress(reinterpret_cast<Bytef*>(deflated.data()), &deflated_size,
+                     reinterpret_cast<const Bytef*>(text.data()),
+                     static_cast<uLong>(text.size())) == Z_OK);
+    // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+    deflated.resize(deflated_size);
+
+    const std::vector<BundleFile> files{
+        {.name = "sound/1.wem", .stored = stored, .size = stored.size(), .compression = 0},
+        {.name = "sound/2.bnk", .stored = deflated, .size = text.size(), .compression = 1}};
+    WriteFile(path, BundleFileData(files));
+    {
+        const wwtools::bundle::Bundle bundle(path);
+        REQUIRE(bundle.Entries().size() == 2);
+
+        const auto& plain = bundle.Entries()[0];
+        REQUIRE(plain.name == "sound/1.wem");
+        REQUIRE(plain.compression == wwtools::bundle::Compression::None);
+        std::string scratch;
+        REQUIRE(bundle.Load(plain, scratch) == stored);
+        REQUIRE(scratch.empty());
+
+        const auto& zlib = bundle.Entries()[1];
+        REQUIRE(zlib.name == "sound/2.bnk");
+        REQUIRE(zlib.compression == wwtools::bundle::Compression::Zlib);
+        REQUIRE(zlib.size == text.size());
+        REQUIRE(bundle.Load(zlib, scratch) == text);
+    }
+
+    // Moves the payload of the second entry past the end of the file
+    auto data = BundleFileData(files);
+    data.replace(32 + 0x140 + 0x11C, 4, "\x00\x00\x01\x00", 4);
+    WriteFile(path, data);
+    REQUIRE_THROWS_AS(wwtools::bundle::Bundle(path), std::runtime_error);
+}
+
+// The file writer gathers the copied and rebuilt ranges into one write, but the bank must be the
+// one BnkReplace streams; a failed replacement leaves no file behind.
+TEST_CASE("Replace WEMs of a bank straight into a file", "[wwise-audio-tools]")
+{
+    const auto section = [](const std::string_view tag, const std::string& payload) {
+        std::string out{tag};
+        AppendU32(out, {static_cast<std::uint32_t>(payload.size())});
+        return out + payload;
+    };
+    std::string header;
+    AppendU32(header, {88, 1, 0, 0});
+    std::string didx;
+    AppendU32(didx, {12, 0, 10, 20, 16, 5});
+    const std::string data = "aaaaaaaaaa" + std::string(6, '\0') + "bbbbb";
+    const auto bank = section("BKHD", header) + section("DIDX", didx) + section("DATA", data);
+
+    const TempDir temp("wwtools_replace_test");
+    const auto& root = temp.Path();
+    const auto path = root / "out.bnk";
+
+    const std::string wem(40, 'x');
+    const std::unordered_map<std::uint32_t, std::string_view> wems{{12, wem}};
+    std::ostringstream streamed;
+    wwtools::BnkReplace(bank, wems, streamed);
+    wwtools::BnkReplaceFile(bank, wems, path);
+    REQUIRE(ReadFile(path.string()) == streamed.str());
+
+    const std::unordered_map<std::uint32_t, std::string_view> missing{{99, wem}};
+    REQUIRE_THROWS(wwtools::BnkReplaceFile(bank, missing, root / "missing.bnk"));
+    REQUIRE_FALSE(std::filesystem::exists(root / "missing.bnk"));
+}
+
+// A pack reads back its entries in the order they were added, with the first entry of a repeated
+// WEM ID found by ID and every payload checked against its hash.  Names must be unique, and a
+// pack whose trailer was never written is rejected.
+TEST_CASE("Write and read back a pack", "[wwise-audio-tools]")
+{
+    const TempDir temp("wwtools_pack_test");
+    const auto& root = temp.Path();
+    const auto path = root / "banks.wwpack";
+
+    const std::vector<std::tuple<std::uint32_t, std::string, std::string>> files{
+        {12, "a/x_12.ogg", "OggS twelve"}, {20, "a/x_20.ogg", ""}, {12, "b/x_12.ogg", "OggS b"}};
+    {
+        wwtools::pack::PackWriter writer(path);
+        for (const auto& [id, name, payload] : files)
+        {
+            writer.Add(id, name, std::as_bytes(std::span(payload)));
+        }
+        const std::string again = "OggS again";
+        REQUIRE_THROWS_AS(writer.Add(30, "a/x_12.ogg", std::as_bytes(std::span(again))),
+                          std::runtime_error);
+        writer.Finish();
+    }
+
+    {
+        const wwtools::pack::Pack pack(path);
+        REQUIRE(pack.Entries().size() == files.size());
+        for (std::size_t i = 0; i < files.size(); ++i)
+        {
+            const auto& entry = pack.Entries()[i];
+            REQUIRE(entry.id == std::get<0>(files[i]));
+            REQUIRE(entry.name == std::get<1>(files[i]));
+            REQUIRE(pack.View(entry) == std::get<2>(files[i]));
+            REQUIRE(pack.Verify(entry));
+        }
+        REQUIRE(pack.Find(12) == pack.Entries().data());
+        REQUIRE(pack.Find(20)->name == "a/x_20.ogg");
+        REQUIRE(pack.Find(99) == nullptr);
+    }
+
+    // Damage the first payload, right after the 8-byte header
+    auto data = ReadFile(path.string());
+    data[8] ^= 1;
+    WriteFile(path, data);
+    {
+        const wwtools::pack::Pack pack(path);
+        REQUIRE_FALSE(pack.Verify(pack.Entries()[0]));
+        REQUIRE(pack.Verify(pack.Entries()[2]));
+    }
+
+    data.resize(data.size() - 24);
+    WriteFile(path, data);
+    REQUIRE_THROWS_AS(wwtools::pack::Pack(path), std::runtime_error);
+
+    // /dev/full opens but fails every write, and one failed payload spends the writer
+    if (std::filesystem::exists("/dev/full"))
+    {
+        wwtools::pack::PackWriter full("/dev/full");
+        const std::vector<std::byte> large(std::size_t{2} << 20U);
+        REQUIRE_THROWS_AS(full.Add(1, "a.ogg", large), std::system_error);
+        REQUIRE_THROWS_WITH(full.Add(2, "b.ogg", std::span(large).first(4)),
+                            "pack cannot be added to after a failed write");
+        REQUIRE_THROWS_WITH(full.Finish(), "pack cannot be finished after a failed write");
+    }
+}
+
+// Acquire waits for a release once the budget is spent, but lets an item larger than the whole
+// budget through when nothing else is in flight.  Charge never waits.
+TEST_CASE("Cap the bytes in flight with a byte budget", "[wwise-audio-tools]")
+{
+    wwtools::pipeline::ByteBudget budget(100);
+    budget.Acquire(60);
+    budget.Charge(60);
+
+    std::atomic<bool> acquired{false};
+    std::jthread producer([&] {
+        budget.Acquire(50);
+        acquired = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    REQUIRE_FALSE(acquired);
+
+    budget.Release(60);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    REQUIRE_FALSE(acquired);
+
+    budget.Release(60);
+    producer.join();
+    REQUIRE(acquired);
+
+    budget.Release(50);
+    budget.Acquire(1000);
+    budget.Release(1000);
+}
+
+// Push waits while the queue is full, and after Close the consumers get what is left, in order,
+// before Pop reports the end.
+TEST_CASE("Pass items through a bounded queue", "[wwise-audio-tools]")
+{
+    wwtools::pipeline::BoundedQueue<int> queue(2);
+    queue.Push(1);
+    queue.Push(2);
+
+    std::atomic<int> pushed{0};
+    std::jthread producer([&] {
+        for (int i = 3; i <= 5; ++i)
+        {
+            queue.Push(i);
+            pushed = i;
+        }
+        queue.Close();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    REQUIRE(pushed == 0);
+
+    std::vector<int> popped;
+    while (auto item = queue.Pop())
+    {
+        popped.push_back(*item);
+    }
+    producer.join();
+    REQUIRE(popped == std::vector<int>{1, 2, 3, 4, 5});
+    REQUIRE_FALSE(queue.Pop().has_value());
+}
+
+// Every kernel (16- and 8-sample SIMD blocks, then the scalar tail) scales, rounds and clips the
+// same way, and maps NaN to -32768.
+TEST_CASE("Convert planar float samples to interleaved int16", "[wwise-audio-tools]")
+{
+    constexpr auto g_inf = std::numeric_limits<float>::infinity();
+    const std::vector<std::pair<float, std::int16_t>> cases = {
+        {0.0F, 0},        {0.5F, 16384},     {-0.5F, -16384}, {1.0F, 32767},
+        {-1.0F, -32768},  {2.0F, 32767},     {-2.0F, -32768}, {g_inf, 32767},
+        {-g_inf, -32768}, {std::numeric_limits<float>::quiet_NaN(), -32768}};
+
+    // 29 frames reach every kernel, and each channel is shifted so columns differ
+    constexpr std::size_t g_frames = 29;
+    for (const int channels : {1, 2, 3})
+    {
+        std::vector<std::vector<float>> planes(static_cast<std::size_t>(channels));
+        std::vector<std::int16_t> expected;
+        for (std::size_t i = 0; i < g_frames; ++i)
+        {
+            for (std::size_t ch = 0; ch < planes.size(); ++ch)
+            {
+                const auto& [sample, converted] = cases[(i + ch) % cases.size()];
+                planes[ch].push_back(sample);
+                expected.push_back(converted);
+            }
+        }
+
+        std::vector<const float*> planar;
+        for (const auto& plane : planes)
+        {
+            planar.push_back(plane.data());
+        }
+        std::vector<std::int16_t> out(expected.size());
+        wwtools::pcm::InterleaveInt16(planar.data(), channels, g_frames, out);
+        REQUIRE(out == expected);
+    }
+}
@@ -0,0 +1,459 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ww2ogg/errors.h"
+#include "ww2ogg/ogg2wem.h"
+#include "ww2ogg/ww2ogg.h"
+
+namespace
+{
+
+using ww2ogg::PacketHeaders;
+
+[[nodiscard]] std::string ReadFile(const std::string& path)
+{
+    std::ifstream filein(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(filein), std::istreambuf_iterator<char>()};
+}
+
+// Byte sink writing integers in a fixed byte order, for assembling WEMs.
+class Bytes
+{
+    std::string m_bytes;
+    std::endian m_order;
+
+    Bytes& Int(const std::uint32_t value, const int size)
+    {
+        for (int i = 0; i < size; ++i)
+        {
+            const int byte = m_order == std::endian::little ? i : size - 1 - i;
+            m_bytes += static_cast<char>((value >> (8 * byte)) & 0xFF);
+        }
+        return *this;
+    }
+
+public:
+    explicit Bytes(const std::endian order) : m_order(order)
+    {
+    }
+
+    Bytes& U8(const std::uint8_t value)
+    {
+        return Int(value, 1);
+    }
+
+    Bytes& U16(const std::uint16_t value)
+    {
+        return Int(value, 2);
+    }
+
+    Bytes& U32(const std::uint32_t value)
+    {
+        return Int(value, 4);
+    }
+
+    Bytes& Raw(const std::string_view bytes)
+    {
+        m_bytes += bytes;
+        return *this;
+    }
+
+    Bytes& Zeros(const std::size_t count)
+    {
+        m_bytes.append(count, '\0');
+        return *this;
+    }
+
+    Bytes& Chunk(const std::string_view tag, const Bytes& payload)
+    {
+        return Raw(tag).U32(static_cast<std::uint32_t>(payload.Str().size())).Raw(payload.Str());
+    }
+
+    [[nodiscard]] const std::string& Str() const
+    {
+        return m_bytes;
+    }
+};
+
+[[nodiscard]] std::uint32_t LoadLe(const std::string_view data, const std::size_t offset,
+                                   const std::size_t size)
+{
+    std::uint32_t value = 0;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        value |= static_cast<std::uint32_t>(static_cast<unsigned char>(data[offset + i]))
+                 << (8 * i);
+    }
+    return value;
+}
+
+class CollectPackets : public ww2ogg::PacketSink
+{
+public:
+    std::vector<std::string> packets;
+
+    void WritePacket(const std::span<const unsigned char> packet, const std::uint32_t /*granule*/,
+                     const bool /*last*/) override
+    {
+        packets.emplace_back(packet.begin(), packet.end());
+    }
+};
+
+// The parts of a WEM (with the vorb fields in a 0x42 fmt chunk, as test1.wem) that WEMs of every
+// other packet framing are assembled from.
+struct Source
+{
+    std::uint16_t channels = 0;
+    std::uint32_t sample_rate = 0;
+    std::uint32_t avg_bytes_per_second = 0;
+    std::uint16_t ext_unk = 0;
+    std::uint32_t subtype = 0;
+    std::uint32_t sample_count = 0;
+    std::uint32_t uid = 0;
+    std::uint8_t blocksize_0_pow = 0;
+    std::uint8_t blocksize_1_pow = 0;
+    std::string setup;                    // setup packet as Wwise strips it
+    std::vector<std::string> mod_packets; // audio packets as Wwise stores them
+    std::vector<std::string> headers;     // rebuilt identification, comment and setup packets
+    std::vector<std::string> packets;     // rebuilt standard Vorbis audio packets
+};
+
+// The identification, comment, setup and audio packets a WEM converts to.
+[[nodiscard]] std::vector<std::string> RebuildPackets(const std::string& wem)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    std::string codebooks(reinterpret_cast<const char*>(ww2ogg::g_packed_codebooks_bin),
+                          ww2ogg::g_packed_codebooks_bin_len);
+    CollectPackets rebuilt;
+    ww2ogg::WwiseRiffVorbis(wem, std::move(codebooks), false, false,
+                            ww2ogg::K_NO_FORCE_PACKET_FORMAT)
+        .GeneratePackets(rebuilt);
+    return std::move(rebuilt.packets);
+}
+
+[[nodiscard]] Source ReadSource(const std::string& wem)
+{
+    std::size_t fmt = 0;
+    std::size_t data = 0;
+    std::size_t data_size = 0;
+    for (std::size_t offset = 12; offset < wem.size();)
+    {
+        const auto size = LoadLe(wem, offset + 4, 4);
+        const auto tag = std::string_view(wem).substr(offset, 4);
+        if (tag == "fmt ")
+        {
+            fmt = offset + 8;
+        }
+        else if (tag == "data")
+        {
+            data = offset + 8;
+            data_size = size;
+        }
+        offset += 8 + size;
+    }
+    const auto vorb = fmt + 0x18;
+
+    Source source;
+    source.channels = static_cast<std::uint16_t>(LoadLe(wem, fmt + 0x2, 2));
+    source.sample_rate = LoadLe(wem, fmt + 0x4, 4);
+    source.avg_bytes_per_second = LoadLe(wem, fmt + 0x8, 4);
+    source.ext_unk = static_cast<std::uint16_t>(LoadLe(wem, fmt + 0x12, 2));
+    source.subtype = LoadLe(wem, fmt + 0x14, 4);
+    source.sample_count = LoadLe(wem, vorb, 4);
+    source.uid = LoadLe(wem, vorb + 0x24, 4);
+    source.blocksize_0_pow = static_cast<std::uint8_t>(wem[vorb + 0x28]);
+    source.blocksize_1_pow = static_cast<std::uint8_t>(wem[vorb + 0x29]);
+
+    // 2-byte packet headers: the setup packet, then the audio packets up to the end of data
+    const auto setup = data + LoadLe(wem, vorb + 0x10, 4);
+    source.setup = wem.substr(setup + 2, LoadLe(wem, setup, 2));
+    for (auto offset = data + LoadLe(wem, vorb + 0x14, 4); offset < data + data_size;)
+    {
+        const auto size = LoadLe(wem, offset, 2);
+        source.mod_packets.push_back(wem.substr(offset + 2, size));
+        offset += 2 + size;
+    }
+
+    auto rebuilt = RebuildPackets(wem);
+    source.packets.assign(rebuilt.begin() + 3, rebuilt.end());
+    rebuilt.resize(3);
+    source.headers = std::move(rebuilt);
+    return source;
+}
+
+// One of the packet framings the converter is specialized on.
+struct Variant
+{
+    PacketHeaders headers;
+    bool mod_packets;
+    std::endian order;
+
+    [[nodiscard]] std::string Name() const
+    {
+        std::string_view header_size = "2-byte";
+        if (headers == PacketHeaders::Old)
+        {
+            header_size = "8-byte";
+        }
+        else if (headers == PacketHeaders::Standard)
+        {
+            header_size = "6-byte";
+        }
+        return std::format("{} headers, {} packets, {}", header_size,
+                           mod_packets ? "modified" : "standard",
+                           order == std::endian::little ? "RIFF" : "RIFX");
+    }
+
+    [[nodiscard]] ww2ogg::ForcePacketFormat Force() const
+    {
+        return mod_packets ? ww2ogg::K_FORCE_MOD_PACKETS : ww2ogg::K_FORCE_NO_MOD_PACKETS;
+    }
+};
+
+// Every framing found in real files.  8-byte headers only come with the full header triad,
+// whose audio packets are never modified.
+[[nodiscard]] std::vector<Variant> Variants()
+{
+    std::vector<Variant> variants;
+    for (const auto order : {std::endian::little, std::endian::big})
+    {
+        for (const auto headers :
+             {PacketHeaders::Old, PacketHeaders::NoGranule, PacketHeaders::Standard})
+        {
+            for (const bool mod_packets : {false, true})
+            {
+                if (headers != PacketHeaders::Old || !mod_packets)
+                {
+                    variants.push_back({headers, mod_packets, order});
+                }
+            }
+        }
+    }
+    return variants;
+}
+
+// Assembles `source` as a WEM of the given framing.  Granules are left at 0, as 2-byte headers
+// imply, so every variant converts to the same OGG.
+[[nodiscard]] std::string BuildWem(const Source& source, const Variant& variant)
+{
+    const auto framed = [&](Bytes& out, const std::string& packet) {
+        const auto size = static_cast<std::uint32_t>(packet.size());
+        switch (variant.headers)
+        {
+        case PacketHeaders::Old:
+            out.U32(size).U32(0);
+            break;
+        case PacketHeaders::Standard:
+            out.U16(static_cast<std::uint16_t>(size)).U32(0);
+            break;
+        case PacketHeaders::NoGranule:
+            out.U16(static_cast<std::uint16_t>(size));
+            break;
+        }
+        out.Raw(packet);
+    };
+
+    Bytes data(variant.order);
+    if (variant.headers == PacketHeaders::Old)
+    {
+        for (const auto& packet : source.headers)
+        {
+            framed(data, packet);
+        }
+    }
+    else
+    {
+        framed(data, source.setup);
+    }
+    const auto first_audio = static_cast<std::uint32_t>(data.Str().size());
+    for (const auto& packet : variant.mod_packets ? source.mod_packets : source.packets)
+    {
+        framed(data, packet);
+    }
+
+    Bytes fmt(variant.order);
+    fmt.U16(0xFFFF).U16(source.channels).U32(source.sample_rate);
+    fmt.U32(source.avg_bytes_per_second).U16(0).U16(0);
+
+    Bytes body(variant.order);
+    body.Raw("WAVE");
+    if (variant.headers == PacketHeaders::NoGranule)
+    {
+        // 0x42 fmt chunk holding the vorb fields; mod signal 0x4A marks standard packets
+        fmt.U16(0x30).U16(source.ext_unk).U32(source.subtype);
+        fmt.U32(source.sample_count).U32(variant.mod_packets ? 0 : 0x4A).Zeros(8);
+        fmt.U32(0).U32(first_audio).Zeros(12);
+        fmt.U32(source.uid).U8(source.blocksize_0_pow).U8(source.blocksize_1_pow);
+        body.Chunk("fmt ", fmt);
+    }
+    else
+    {
+        fmt.U16(6).U16(source.ext_unk).U32(source.subtype);
+
+        // 0x2C vorb chunk for the header triad, 0x34 otherwise
+        Bytes vorb(variant.order);
+        vorb.U32(source.sample_count).Zeros(0x14).U32(0).U32(first_audio);
+        if (variant.headers == PacketHeaders::Old)
+        {
+            vorb.Zeros(0xC);
+        }
+        else
+        {
+            vorb.Zeros(0xC).U32(source.uid);
+            vorb.U8(source.blocksize_0_pow).U8(source.blocksize_1_pow).Zeros(2);
+        }
+        body.Chunk("fmt ", fmt).Chunk("vorb", vorb);
+    }
+    body.Chunk("data", data);
+
+    Bytes riff(variant.order);
+    riff.Raw(variant.order == std::endian::little ? "RIFF" : "RIFX");
+    riff.U32(static_cast<std::uint32_t>(body.Str().size())).Raw(body.Str());
+    return riff.Str();
+}
+
+[[nodiscard]] std::string Convert(const std::string& wem, const ww2ogg::ForcePacketFormat force)
+{
+    std::ostringstream out;
+    ww2ogg::Ww2Ogg(wem, out, ww2ogg::g_packed_codebooks_bin, false, false, force);
+    return out.str();
+}
+
+[[nodiscard]] const ww2ogg::CodebookIndex& Codebooks()
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    static const ww2ogg::CodebookIndex g_codebooks(std::string(
+        reinterpret_cast<const char*>(ww2ogg::g_packed_codebooks_bin),
+        ww2ogg::g_packed_codebooks_bin_len));
+    return g_codebooks;
+}
+
+[[nodiscard]] std::string ToWem(const std::string& ogg, const Variant& variant)
+{
+    return ww2ogg::Ogg2Wem(std::as_bytes(std::span(ogg)), Codebooks(),
+                           {.packet_headers = variant.headers,
+                            .mod_packets = variant.mod_packets,
+                            .little_endian = variant.order == std::endian::little});
+}
+
+// The framings Ogg2Wem writes: modified packets only come with 2-byte headers, which leaves 8-byte
+// headers (that need the header triad) out entirely.
+[[nodiscard]] std::vector<Variant> WritableVariants()
+{
+    std::vector<Variant> variants;
+    for (const auto& variant : Variants())
+    {
+        if (variant.headers == PacketHeaders::NoGranule ||
+            (variant.headers == PacketHeaders::Standard && !variant.mod_packets))
+        {
+            variants.push_back(variant);
+        }
+    }
+    return variants;
+}
+
+} // anonymous namespace
+
+// The converter is compiled once per byte order, header size and packet modification; every
+// combination has to rebuild the same stream.
+TEST_CASE("Every packet framing converts to the same OGG", "[ww2ogg]")
+{
+    const auto wem = ReadFile("testdata/wem/test1.wem");
+    const auto expected = Convert(wem, ww2ogg::K_NO_FORCE_PACKET_FORMAT);
+    const auto source = ReadSource(wem);
+    REQUIRE(source.packets.size() == source.mod_packets.size());
+
+    for (const auto& variant : Variants())
+    {
+        INFO(variant.Name());
+        CHECK(Convert(BuildWem(source, variant), variant.Force()) == expected);
+    }
+}
+
+// Ogg2Wem is the inverse of the converter: every WEM it writes has to convert back to the packets
+// the OGG came from, and to the very same OGG when no granules are stored.
+TEST_CASE("OGG to WEM round trip", "[ww2ogg]")
+{
+    const auto wem = ReadFile("testdata/wem/test1.wem");
+    const auto ogg = Convert(wem, ww2ogg::K_NO_FORCE_PACKET_FORMAT);
+    const auto packets = RebuildPackets(wem);
+
+    for (const auto& variant : WritableVariants())
+    {
+        INFO(variant.Name());
+        const auto converted = ToWem(ogg, variant);
+        CHECK(RebuildPackets(converted) == packets);
+        if (variant.headers == PacketHeaders::NoGranule)
+        {
+            CHECK(Convert(converted, ww2ogg::K_NO_FORCE_PACKET_FORMAT) == ogg);
+        }
+    }
+
+    CHECK_THROWS_AS(ToWem(ogg, {PacketHeaders::Standard, true, std::endian::little}),
+                    ww2ogg::ArgumentError);
+
+    // A damaged page fails its checksum
+    auto damaged = ogg;
+    damaged[damaged.size() / 2] ^= 1;
+    CHECK_THROWS_AS(ToWem(damaged, {PacketHeaders::NoGranule, true, std::endian::little}),
+                    ww2ogg::ParseError);
+}
+
+// A prefetch stub may be cut anywhere in its data chunk, but never in its headers: a 0x28 fmt
+// chunk running past the end of the file is rejected before its signature is read.
+TEST_CASE("A WEM cut inside its fmt chunk is rejected", "[ww2ogg]")
+{
+    Bytes fmt(std::endian::little);
+    fmt.U16(0xFFFF).U16(1).U32(48000).U32(0).U16(0).U16(0).U16(0x28 - 0x12).U16(0).U32(0);
+    Bytes vorb(std::endian::little);
+    vorb.Zeros(0x2A);
+    Bytes wem(std::endian::little);
+    wem.Raw("RIFF").U32(0x1000).Raw("WAVE").Chunk("vorb", vorb);
+    wem.Raw("fmt ").U32(0x28).Raw(fmt.Str()).U32(1);
+
+    std::ostringstream out;
+    CHECK_THROWS_AS(ww2ogg::Ww2OggPrefix(wem.Str(), out), ww2ogg::ParseError);
+    CHECK_THROWS_AS(ww2ogg::Ww2Ogg(wem.Str(), out), ww2ogg::ParseError);
+}
+
+// Hidden; run with `ww2ogg_tests "[benchmark]"`.
+TEST_CASE("WEM to OGG benchmarks per packet framing", "[.][benchmark]")
+{
+    const auto source = ReadSource(ReadFile("testdata/wem/test1.wem"));
+
+    for (const auto& variant : Variants())
+    {
+        const auto wem = BuildWem(source, variant);
+        BENCHMARK(variant.Name())
+        {
+            return Convert(wem, variant.Force()).size();
+        };
+    }
+}
+
+// Hidden; run with `ww2ogg_tests "[benchmark]"`.
+TEST_CASE("OGG to WEM benchmarks per packet framing", "[.][benchmark]")
+{
+    const auto ogg = Convert(ReadFile("testdata/wem/test1.wem"), ww2ogg::K_NO_FORCE_PACKET_FORMAT);
+    static_cast<void>(Codebooks());
+
+    for (const auto& variant : WritableVariants())
+    {
+        BENCHMARK(variant.Name())
+        {
+            return ToWem(ogg, variant).size();
+        };
+    }
+}